@@ -0,0 +1,12 @@
+function accumulate(n: number) {
+    let a: any = 0;
+    let b: any = 1.5;
+    for (let i = 0; i < n; i++) {
+        a = a + b * (i % 10);
+        b = b * 1 + 0.25 - 0.25;
+    }
+
+    return a;
+}
+
+console.log(accumulate(20000000));
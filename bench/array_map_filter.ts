@@ -0,0 +1,18 @@
+function pipeline(n: number) {
+    const values: number[] = [];
+    for (let i = 0; i < n; i++) {
+        values.push(i);
+    }
+
+    let sum = 0;
+    for (let r = 0; r < 10; r++) {
+        const picked = values.map(x => x * 2 + r).filter(x => x % 3 === 0);
+        for (const v of picked) {
+            sum += v;
+        }
+    }
+
+    return sum;
+}
+
+console.log(pipeline(200000));
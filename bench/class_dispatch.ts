@@ -0,0 +1,51 @@
+abstract class Shape {
+    public abstract area(): number;
+}
+
+class Square extends Shape {
+    constructor(private side: number) {
+        super();
+    }
+
+    public area() {
+        return this.side * this.side;
+    }
+}
+
+class Rect extends Shape {
+    constructor(private w: number, private h: number) {
+        super();
+    }
+
+    public area() {
+        return this.w * this.h;
+    }
+}
+
+class Triangle extends Shape {
+    constructor(private b: number, private h: number) {
+        super();
+    }
+
+    public area() {
+        return this.b * this.h / 2;
+    }
+}
+
+function totalArea(n: number) {
+    const shapes: Shape[] = [];
+    for (let i = 0; i < 1000; i++) {
+        shapes.push(i % 3 === 0 ? new Square(i % 10) : i % 3 === 1 ? new Rect(i % 10, 2) : new Triangle(i % 10, 4));
+    }
+
+    let sum = 0;
+    for (let r = 0; r < n; r++) {
+        for (const s of shapes) {
+            sum += s.area();
+        }
+    }
+
+    return sum;
+}
+
+console.log(totalArea(30000));
@@ -0,0 +1,20 @@
+function makeCounter(step: number) {
+    let count = 0;
+    return () => {
+        count += step;
+        return count;
+    };
+}
+
+function applyAll(n: number) {
+    const counters = [makeCounter(1), makeCounter(2), makeCounter(3)];
+    let sum = 0;
+    for (let i = 0; i < n; i++) {
+        const add = (x: number) => x + counters.length;
+        sum = add(sum) - counters.length + counters[i % 3]() % 11;
+    }
+
+    return sum;
+}
+
+console.log(applyAll(3000000));
@@ -0,0 +1,2 @@
+// startup cost of the runtime, subtracted from the other timings
+console.log(0);
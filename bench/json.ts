@@ -0,0 +1,17 @@
+function roundTrip(n: number) {
+    const items: any[] = [];
+    for (let i = 0; i < 200; i++) {
+        items.push({ id: i, name: 'item' + i, price: i * 1.25, tags: ['a', 'b', 'c'], nested: { ok: i % 2 === 0 } });
+    }
+
+    let size = 0;
+    for (let r = 0; r < n; r++) {
+        const text = JSON.stringify(items);
+        const back = JSON.parse(text);
+        size += text.length + back.length;
+    }
+
+    return size;
+}
+
+console.log(roundTrip(200));
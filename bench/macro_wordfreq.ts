@@ -0,0 +1,37 @@
+// tokenizing and counting generated text: strings, regex split, objects used as maps and for/in
+const words = ['lorem', 'ipsum', 'dolor', 'sit', 'amet', 'consectetur', 'adipiscing', 'elit', 'sed', 'do'];
+
+function generate(n: number) {
+    let text = '';
+    for (let i = 0; i < n; i++) {
+        text += words[(i * 7 + (i >> 3)) % words.length] + (i % 13 === 0 ? '. ' : i % 5 === 0 ? ', ' : ' ');
+    }
+
+    return text;
+}
+
+function count(text: string) {
+    const counts: any = {};
+    for (const w of text.split(/[\s,.]+/)) {
+        if (w.length === 0) {
+            continue;
+        }
+
+        const key = w.toUpperCase();
+        counts[key] = counts[key] ? counts[key] + 1 : 1;
+    }
+
+    let checksum = 0;
+    for (const k in counts) {
+        checksum += k.length * counts[k];
+    }
+
+    return checksum;
+}
+
+let total = 0;
+for (let r = 0; r < 10; r++) {
+    total += count(generate(50000));
+}
+
+console.log(total);
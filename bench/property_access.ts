@@ -0,0 +1,13 @@
+function touch(n: number) {
+    const o: any = { x: 1, y: 2, z: 3, name: 'point' };
+    let sum = 0;
+    for (let i = 0; i < n; i++) {
+        o.x = o.y + i % 7;
+        o.y = o.z - o.x % 5;
+        sum += o.x + o.y;
+    }
+
+    return sum;
+}
+
+console.log(touch(10000000));
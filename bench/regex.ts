@@ -0,0 +1,15 @@
+function scan(n: number) {
+    const line = 'id=42, from 10-20 to 30-40, tag: alpha_beta';
+    const range = /(\d+)-(\d+)/;
+    let sum = 0;
+    for (let i = 0; i < n; i++) {
+        const m = range.exec(line);
+        sum += parseInt(m[2]) - parseInt(m[1]);
+        sum += line.replace(/(\d+)-(\d+)/g, '$2:$1').length;
+        sum += line.split(/,\s*/).length;
+    }
+
+    return sum;
+}
+
+console.log(scan(100000));
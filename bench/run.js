@@ -0,0 +1,137 @@
+// Runs every benchmark as a transpiled binary and under Node and prints one JSON document with the timings.
+//   node run.js -bin=<folder with the bench_* binaries> [-runs=5] [-filter=regex] [-out=file.json] [-compiler=id]
+// Each benchmark prints a checksum, both runs must agree on it. Timings are wall clock of the whole process,
+// the 'empty' benchmark measures startup and is subtracted in the 'adjusted' columns.
+const fs = require('fs');
+const path = require('path');
+const os = require('os');
+const { spawnSync } = require('child_process');
+const ts = require('typescript');
+
+function parseOptions(argv) {
+    const options = { runs: '5', filter: '', bin: '.', out: '', compiler: '' };
+    argv.slice(2).filter(a => a[0] === '-').forEach(a => {
+        const separator = a.indexOf('=');
+        options[a.substring(1, separator === -1 ? a.length : separator)] = separator === -1 ? true : a.substring(separator + 1);
+    });
+
+    return options;
+}
+
+function exeName(name) {
+    return 'bench_' + name + (process.platform === 'win32' ? '.exe' : '');
+}
+
+function gitCommit() {
+    const result = spawnSync('git', ['rev-parse', 'HEAD'], { cwd: __dirname });
+    return result.status === 0 ? result.stdout.toString().trim() : '';
+}
+
+function median(values) {
+    const sorted = values.slice().sort((a, b) => a - b);
+    const middle = sorted.length >> 1;
+    return sorted.length % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+}
+
+function measure(command, args, runs) {
+    const times = [];
+    let output = '';
+    for (let i = 0; i < runs; i++) {
+        const start = process.hrtime.bigint();
+        const result = spawnSync(command, args, { maxBuffer: 64 * 1024 * 1024 });
+        const elapsed = Number(process.hrtime.bigint() - start) / 1e6;
+        if (result.error || result.status !== 0) {
+            return { error: result.error ? result.error.message : (result.stderr || '').toString().trim() || 'exit code ' + result.status };
+        }
+
+        output = result.stdout.toString().replace(/\r\n/g, '\n').trim();
+        times.push(elapsed);
+    }
+
+    return { median: median(times), min: Math.min.apply(null, times), output };
+}
+
+// Node runs exactly the source, emitted as ES2017 so that no downlevel helpers are measured
+function transpile(name, folder) {
+    const source = fs.readFileSync(path.join(__dirname, name + '.ts')).toString();
+    const js = ts.transpileModule(source, { compilerOptions: { target: ts.ScriptTarget.ES2017, module: ts.ModuleKind.CommonJS } });
+    const fileName = path.join(folder, name + '.js');
+    fs.writeFileSync(fileName, js.outputText);
+    return fileName;
+}
+
+function round(value) {
+    return value === undefined ? null : Math.round(value * 1000) / 1000;
+}
+
+function main() {
+    const options = parseOptions(process.argv);
+    const runs = Math.max(1, parseInt(options.runs, 10) || 1);
+    const filter = new RegExp(options.filter || '.');
+    const folder = fs.mkdtempSync(path.join(os.tmpdir(), 'tsc-cxx-bench-'));
+
+    const names = fs.readdirSync(__dirname)
+        .filter(f => f.endsWith('.ts'))
+        .map(f => f.substring(0, f.length - 3))
+        .filter(n => n === 'empty' || filter.test(n))
+        .sort((a, b) => (a === 'empty' ? -1 : b === 'empty' ? 1 : a.localeCompare(b)));
+
+    const results = [];
+    let failed = false;
+    for (const name of names) {
+        const cxx = measure(path.resolve(options.bin, exeName(name)), [], runs);
+        const node = measure(process.execPath, [transpile(name, folder)], runs);
+        results.push({ name, kind: name.startsWith('macro_') ? 'macro' : name === 'empty' ? 'startup' : 'micro', cxx, node });
+    }
+
+    const startup = results.find(r => r.name === 'empty');
+    const report = {
+        commit: gitCommit(),
+        date: new Date().toISOString(),
+        platform: process.platform + '-' + process.arch,
+        compiler: options.compiler || '',
+        node: process.version,
+        runs,
+        results: results.map(r => {
+            const entry = { name: r.name, kind: r.kind };
+            for (const side of ['cxx', 'node']) {
+                const m = r[side];
+                const base = startup && !startup[side].error && r !== startup ? startup[side].median : 0;
+                entry[side] = m.error
+                    ? { error: m.error }
+                    : { median_ms: round(m.median), min_ms: round(m.min), adjusted_ms: round(Math.max(0, m.median - base)) };
+            }
+
+            if (!r.cxx.error && !r.node.error) {
+                entry.outputs_match = r.cxx.output === r.node.output;
+                entry.ratio = entry.node.adjusted_ms > 0 ? round(entry.cxx.adjusted_ms / entry.node.adjusted_ms) : null;
+            }
+
+            failed = failed || !!r.cxx.error || !!r.node.error || entry.outputs_match === false;
+            return entry;
+        })
+    };
+
+    const text = JSON.stringify(report, null, 2);
+    if (options.out) {
+        fs.writeFileSync(options.out, text + '\n');
+    }
+
+    console.log(text);
+
+    // the side by side table goes to stderr, stdout stays machine readable
+    const cell = (m) => (m.error ? 'error' : m.adjusted_ms.toFixed(1)).padStart(12);
+    console.error('benchmark'.padEnd(20) + 'c++ ms'.padStart(12) + 'node ms'.padStart(12) + 'ratio'.padStart(10));
+    report.results.forEach(r => console.error(
+        r.name.padEnd(20) + cell(r.cxx) + cell(r.node)
+        + (r.ratio === undefined || r.ratio === null ? '-' : r.ratio.toFixed(2)).padStart(10)
+        + (r.outputs_match === false ? '  output differs' : '')));
+
+    if (fs.rmSync) {
+        fs.rmSync(folder, { recursive: true, force: true });
+    }
+
+    process.exitCode = failed ? 1 : 0;
+}
+
+main();
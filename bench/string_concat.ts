@@ -0,0 +1,15 @@
+function build(n: number) {
+    let s = '';
+    for (let i = 0; i < n; i++) {
+        s += 'item' + i + ';';
+    }
+
+    return s.length;
+}
+
+let total = 0;
+for (let r = 0; r < 20; r++) {
+    total += build(100000);
+}
+
+console.log(total);
@@ -0,0 +1,24 @@
+// declarations of the runtime functions cpplib/core.h offers to TypeScript code beyond the standard library;
+// reference it with /// <reference path="core.d.ts" />
+
+// runs callback with every allocation of generated code on this thread (new, array and object storage) in one
+// arena, released when callback returns. Nothing allocated inside may be kept after it.
+declare function withArena(callback: () => void): void;
+
+// the callback runs on chunks of the array in the shared thread pool, results keep the order of the elements.
+// It must not depend on the order of the calls; parallelReduce's must be associative
+interface Array<T> {
+    parallelMap<U>(callback: (value: T, index: number) => U): U[];
+    parallelFilter(callback: (value: T, index: number) => boolean): T[];
+    parallelForEach(callback: (value: T, index: number) => void): void;
+    parallelReduce(callback: (accumulator: T, value: T, index: number) => T, initial: T): T;
+    parallelEvery(callback: (value: T, index: number) => boolean): boolean;
+    parallelSome(callback: (value: T, index: number) => boolean): boolean;
+}
+
+// not in JavaScript: seed makes Math.random repeatable (0 goes back to a random seed), fillRandom fills every
+// element with Math.random in one call and returns the array
+interface Math {
+    seed(value: number): void;
+    fillRandom(values: Float64Array): Float64Array;
+}
@@ -1,9 +1,16 @@
 #ifndef CORE_H
 #define CORE_H
 
+#include <atomic>
+#include <bit>
 #include <cinttypes>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <type_traits>
 #include <vector>
@@ -18,15 +25,36 @@
 #include <iomanip>
 #include <cmath>
 #include <algorithm>
+#include <charconv>
 #include <random>
 #include <regex>
 #include <limits>
 #include <algorithm>
 #include <numeric>
+#include <optional>
 #include <variant>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
 #include <future>
+#include <coroutine>
+#include <map>
+#include <list>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define JS_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define JS_SIMD_NEON
+#include <arm_neon.h>
+#endif
 
 namespace js
 {
@@ -108,6 +136,8 @@ concept can_cast_to_size_t = requires(T t) { static_cast<size_t>(t); };
 template<typename T>
 concept has_exists_member = requires { T::exists; };
 
+struct property_key;
+
 template <class _Ty>
 struct is_stringish : 
     std::bool_constant<std::is_same_v<_Ty, const char_t *> 
@@ -116,6 +146,7 @@ struct is_stringish :
     || std::is_same_v<_Ty, std::string_view> 
     || std::is_same_v<_Ty, std::wstring_view> 
     || std::is_same_v<_Ty, string> 
+    || std::is_same_v<_Ty, property_key> 
     || std::is_same_v<_Ty, any>>
 {
 };
@@ -139,22 +170,198 @@ static std::ostream &operator<<(std::ostream &os, std::nullptr_t ptr)
     return os << "null";
 }
 
+#ifdef JS_STATS
+namespace utils
+{
+
+// hot path counters, only compiled in with JS_STATS. Every thread counts into its own block; blocks are linked
+// into a lock-free list once and never freed, so the counts of finished threads survive and a report just sums
+struct stats
+{
+    enum counter
+    {
+        string_allocations,
+        string_bytes,
+        any_copies,
+        any_conversions,
+        object_lookups,
+        object_rehashes,
+        array_grows,
+        function_invokes,
+        dynamic_casts,
+        counters_count
+    };
+
+    struct block
+    {
+        std::atomic<std::uint64_t> values[counters_count] = {};
+        block *next = nullptr;
+    };
+
+    static std::atomic<block *> &head()
+    {
+        static std::atomic<block *> first{nullptr};
+        return first;
+    }
+
+    static block &local()
+    {
+        thread_local block *current = [] {
+            auto created = new block();
+            auto &first = head();
+            created->next = first.load(std::memory_order_relaxed);
+            while (!first.compare_exchange_weak(created->next, created, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+
+            return created;
+        }();
+        return *current;
+    }
+
+    // only the owning thread writes its block: a relaxed load and store, no locked instruction
+    static void add(counter id, std::uint64_t count = 1)
+    {
+        auto &value = local().values[id];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    static std::uint64_t total(counter id)
+    {
+        std::uint64_t sum = 0;
+        for (auto current = head().load(std::memory_order_acquire); current; current = current->next)
+        {
+            sum += current->values[id].load(std::memory_order_relaxed);
+        }
+
+        return sum;
+    }
+
+    static void report(std::ostream &out)
+    {
+        constexpr const char *names[counters_count] = {
+            "string allocations", "string bytes", "any copies", "any conversions", "object lookups",
+            "object rehashes", "array grows", "function invokes", "dynamic casts"};
+        out << "js stats:" << std::endl;
+        for (auto i = 0; i < counters_count; i++)
+        {
+            out << "  " << std::left << std::setw(20) << names[i] << total(static_cast<counter>(i)) << std::endl;
+        }
+    }
+};
+
+} // namespace utils
+
+#define JS_STAT(id) js::utils::stats::add(js::utils::stats::id)
+#define JS_STAT_ADD(id, count) js::utils::stats::add(js::utils::stats::id, (count))
+#define JS_STATS_REPORT() js::utils::stats::report(std::cerr)
+#else
+#define JS_STAT(id) ((void)0)
+#define JS_STAT_ADD(id, count) ((void)0)
+#define JS_STATS_REPORT() ((void)0)
+#endif
+
+#if defined(_MSC_VER)
+#define JS_FUNCTION_SIGNATURE __FUNCSIG__
+#else
+#define JS_FUNCTION_SIGNATURE __PRETTY_FUNCTION__
+#endif
+
+// id of a class: FNV-1a of a signature naming the fully qualified type, template arguments included. Every module
+// computes the same id, while each DLL gets its own copy of a function-local static such as _class()
+template <typename T>
+constexpr std::uint32_t class_id()
+{
+    std::uint32_t hash = 2166136261u;
+    for (auto c = JS_FUNCTION_SIGNATURE; *c; c++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    }
+
+    return hash;
+}
+
+// identity of an emitted class, for instanceof and downcasts without RTTI: a stable id, the ids along the first
+// base by depth (a display: one compare decides) and, once a second base shows up in the hierarchy, every ancestor
+struct class_info
+{
+    std::uint32_t id;
+    std::vector<std::uint32_t> display;
+    std::vector<std::uint32_t> ancestors;
+
+    explicit class_info(std::uint32_t id_) : id(id_), display{id_}
+    {
+    }
+
+    class_info(std::uint32_t id_, std::initializer_list<const class_info *> bases) : id(id_)
+    {
+        display = (*bases.begin())->display;
+        display.push_back(id);
+        if (bases.size() > 1 || !(*bases.begin())->ancestors.empty())
+        {
+            for (auto base : bases)
+            {
+                ancestors.insert(ancestors.end(), base->display.begin(), base->display.end());
+                ancestors.insert(ancestors.end(), base->ancestors.begin(), base->ancestors.end());
+            }
+
+            ancestors.push_back(id);
+            std::sort(ancestors.begin(), ancestors.end());
+            ancestors.erase(std::unique(ancestors.begin(), ancestors.end()), ancestors.end());
+        }
+    }
+
+    bool derives(const class_info &base) const
+    {
+        auto depth = base.display.size() - 1;
+        if (depth < display.size() && display[depth] == base.id)
+        {
+            return true;
+        }
+
+        return !ancestors.empty() && std::binary_search(ancestors.begin(), ancestors.end(), base.id);
+    }
+};
+
+// classes declaring their own class_info; the others (and classes inheriting one) are checked with dynamic_cast
+template <typename T>
+concept has_class_info = requires { typename T::_class_type; } && std::is_same_v<typename T::_class_type, T>;
+
 template <typename I, typename T>
 inline bool is(T *t)
 {
-    return dynamic_cast<I *>(t) != nullptr;
+    if constexpr (std::is_base_of_v<I, T>)
+    {
+        return t != nullptr;
+    }
+    else if constexpr (has_class_info<I> && requires { t->_instance_class(); })
+    {
+        return t != nullptr && t->_instance_class().derives(I::_class());
+    }
+    else
+    {
+        JS_STAT(dynamic_casts);
+        return dynamic_cast<I *>(t) != nullptr;
+    }
 }
 
 template <typename I, typename T>
 inline bool is(const std::shared_ptr<T> &t)
 {
-    return std::dynamic_pointer_cast<I>(t) != nullptr;
+    return is<I>(t.get());
 }
 
 template <typename I, typename T>
 inline bool __is(T *t)
 {
-    return std::type_index(typeid(I *)) == std::type_index(typeid(t)) || is<I>(t);
+    if constexpr (std::is_same_v<I, T>)
+    {
+        return true;
+    }
+    else
+    {
+        return is<I>(t);
+    }
 }
 
 template <typename I, typename T>
@@ -166,13 +373,37 @@ inline I as(T t)
 template <typename I, typename T>
 inline I *as(T *t)
 {
-    return dynamic_cast<I *>(t);
+    if constexpr (std::is_base_of_v<I, T>)
+    {
+        return t;
+    }
+    else if constexpr (std::is_base_of_v<T, I> && has_class_info<I> && requires { t->_instance_class(); })
+    {
+        return is<I>(t) ? static_cast<I *>(t) : nullptr;
+    }
+    else
+    {
+        JS_STAT(dynamic_casts);
+        return dynamic_cast<I *>(t);
+    }
 }
 
 template <typename I, typename T, class = std::enable_if_t<!std::is_same_v<I, any>>>
 inline std::shared_ptr<I> as(const std::shared_ptr<T> &t)
 {
-    return std::dynamic_pointer_cast<I>(t);
+    if constexpr (std::is_base_of_v<I, T>)
+    {
+        return t;
+    }
+    else if constexpr (std::is_base_of_v<T, I> && has_class_info<I> && requires { t->_instance_class(); })
+    {
+        return is<I>(t) ? std::static_pointer_cast<I>(t) : nullptr;
+    }
+    else
+    {
+        JS_STAT(dynamic_casts);
+        return std::dynamic_pointer_cast<I>(t);
+    }
 }
 
 template <typename I, typename T, class = std::enable_if_t<std::is_same_v<I, any>>>
@@ -253,43 +484,123 @@ constexpr auto keys_(T &t)
 
 namespace bitwise
 {
+// ECMAScript ToInt32/ToUint32: values already in range are a plain conversion, the rest wrap modulo 2^32
+inline std::uint32_t to_uint32(double value)
+{
+    if (value >= 0 && value <= 4294967295.0)
+    {
+        return static_cast<std::uint32_t>(value);
+    }
+
+    if (!std::isfinite(value))
+    {
+        return 0;
+    }
+
+    auto wrapped = std::fmod(std::trunc(value), 4294967296.0);
+    return static_cast<std::uint32_t>(wrapped < 0 ? wrapped + 4294967296.0 : wrapped);
+}
+
+inline std::int32_t to_int32(double value)
+{
+    if (value >= -2147483648.0 && value <= 2147483647.0)
+    {
+        return static_cast<std::int32_t>(value);
+    }
+
+    return static_cast<std::int32_t>(to_uint32(value));
+}
+
+template <typename T>
+inline std::uint32_t to_uint32(T value)
+{
+    if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+    {
+        return static_cast<std::uint32_t>(value);
+    }
+    else
+    {
+        return to_uint32(static_cast<double>(value));
+    }
+}
+
+template <typename T>
+inline std::int32_t to_int32(T value)
+{
+    return static_cast<std::int32_t>(to_uint32(value));
+}
+
 template <typename T1, typename T2>
 constexpr auto rshift(T1 op1, T2 op2)
 {
-    auto op1ll = static_cast<long long>(op1);
-    auto op1l = static_cast<long>(op1ll);
-    auto op2ll = static_cast<long long>(op2);
-    auto op2ul = static_cast<unsigned long>(op2ll);
-    auto op2ul32 = op2ul & 0x1f;
-    auto r = op1l >> op2ul32;
-    auto rl = static_cast<long>(r);
-    return static_cast<T1>(rl);
+    return static_cast<T1>(to_int32(op1) >> (to_uint32(op2) & 0x1f));
+}
+
+// JS operators on plain C++ operands, number and other types keep their own operators
+template <typename T1, typename T2>
+constexpr auto bit_and(T1 op1, T2 op2)
+{
+    if constexpr (std::is_arithmetic_v<T1> && std::is_arithmetic_v<T2>)
+    {
+        return to_int32(op1) & to_int32(op2);
+    }
+    else
+    {
+        return op1 & op2;
+    }
+}
+
+template <typename T1, typename T2>
+constexpr auto bit_or(T1 op1, T2 op2)
+{
+    if constexpr (std::is_arithmetic_v<T1> && std::is_arithmetic_v<T2>)
+    {
+        return to_int32(op1) | to_int32(op2);
+    }
+    else
+    {
+        return op1 | op2;
+    }
+}
+
+template <typename T1, typename T2>
+constexpr auto bit_xor(T1 op1, T2 op2)
+{
+    if constexpr (std::is_arithmetic_v<T1> && std::is_arithmetic_v<T2>)
+    {
+        return to_int32(op1) ^ to_int32(op2);
+    }
+    else
+    {
+        return op1 ^ op2;
+    }
+}
+
+template <typename T>
+constexpr auto bit_not(T op)
+{
+    if constexpr (std::is_arithmetic_v<T>)
+    {
+        return ~to_int32(op);
+    }
+    else
+    {
+        return ~op;
+    }
 }
 
+// the result is unsigned 32 bits, an int operand widens so it is not read back as negative
 template <typename T1, typename T2>
 constexpr auto rshift_nosign(T1 op1, T2 op2)
 {
-    auto op1ll = static_cast<long long>(op1);
-    auto op1ul = static_cast<unsigned long>(op1ll);
-    auto op2ll = static_cast<long long>(op2);
-    auto op2ul = static_cast<unsigned long>(op2ll);
-    auto op2ul32 = op2ul & 0x1f;
-    auto r = op1ul >> op2ul32;
-    auto rul = static_cast<unsigned long>(r);
-    return static_cast<T1>(rul);
+    using result_t = std::conditional_t<std::is_integral_v<T1>, std::int64_t, T1>;
+    return static_cast<result_t>(to_uint32(op1) >> (to_uint32(op2) & 0x1f));
 }
 
 template <typename T1, typename T2>
 constexpr auto lshift(T1 op1, T2 op2)
 {
-    auto op1ll = static_cast<long long>(op1);
-    auto op1l = static_cast<long>(op1ll);
-    auto op2ll = static_cast<long long>(op2);
-    auto op2ul = static_cast<unsigned long>(op2ll);
-    auto op2ul32 = op2ul & 0x1f;
-    auto r = op1l << op2ul32;
-    auto rl = static_cast<long>(r);
-    return static_cast<T1>(rl);
+    return static_cast<T1>(static_cast<std::int32_t>(to_uint32(op1) << (to_uint32(op2) & 0x1f)));
 }
 
 } // namespace bitwise
@@ -654,117 +965,477 @@ struct boolean
 static struct boolean true_t(true);
 static struct boolean false_t(false);
 
-namespace tmpl
+namespace utils
 {
-template <typename V>
-struct number
+
+// hash for keys, most of them short: one multiply per 8 bytes; tails are read as overlapping fixed size words,
+// with no per-byte loop and no variable length copy
+static std::uint64_t hash_bytes(const void *data, size_t size)
 {
-    using number_t = number<V>;
-    V _value;
+    auto bytes = static_cast<const unsigned char *>(data);
+    auto read64 = [](const unsigned char *p) { std::uint64_t word; std::memcpy(&word, p, 8); return word; };
+    auto read32 = [](const unsigned char *p) { std::uint32_t word; std::memcpy(&word, p, 4); return static_cast<std::uint64_t>(word); };
+    auto hash = 0x9e3779b97f4a7c15ull ^ (size * 0xff51afd7ed558ccdull);
+    auto mix = [&](std::uint64_t word) {
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 29;
+    };
 
-    number() : _value{-std::numeric_limits<V>::quiet_NaN()}
+    if (size >= 8)
     {
-    }
+        for (; size > 8; size -= 8, bytes += 8)
+        {
+            mix(read64(bytes));
+        }
 
-    number(const number &value) : _value{value._value}
+        mix(read64(bytes + size - 8));
+    }
+    else if (size >= 4)
     {
+        mix((read32(bytes) << 32) | read32(bytes + size - 4));
     }
-
-    template <typename T = void> requires ArithmeticOrEnum<T>
-    number(T initValue) : _value{static_cast<V>(initValue)}
+    else if (size > 0)
     {
+        mix((static_cast<std::uint64_t>(bytes[0]) << 16) | (static_cast<std::uint64_t>(bytes[size >> 1]) << 8) | bytes[size - 1]);
     }
 
-    template <typename T = void> requires ArithmeticOrEnum<T>
-    number(const shared<T>& initValue) : _value{static_cast<V>(initValue.get())}
+    hash ^= hash >> 32;
+    hash *= 0x94d049bb133111ebull;
+    return hash ^ (hash >> 29);
+}
+
+// Number.prototype.toString: shortest round-trip digits, laid out the way JS does it, appended to out
+static void append_number(tstring &out, double value)
+{
+    if (std::isnan(value))
     {
+        out += TXT("NaN");
+        return;
     }
 
-    number(js::pointer_t p) : _value{p._ptr != nullptr ? static_cast<V>(intptr_t(p._ptr)) : -std::numeric_limits<V>::quiet_NaN()}
+    if (std::isinf(value))
     {
+        out += value < 0 ? TXT("-Infinity") : TXT("Infinity");
+        return;
     }
 
-    number(const undefined_t &undef) : _value{-std::numeric_limits<V>::quiet_NaN()}
+    if (value == 0)
     {
+        out += TXT("0");
+        return;
     }
 
-    inline bool is_undefined()
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific);
+    auto first = buffer;
+    auto last = result.ptr;
+
+    if (*first == '-')
     {
-        return std::signbit(_value) && std::isnan(_value);
+        out += TXT('-');
+        first++;
     }
 
-    constexpr operator size_t()
+    // d.ddde[+-]xx
+    char digits[24];
+    auto k = 0;
+    auto exp = first;
+    for (; exp != last && *exp != 'e'; exp++)
     {
-        return static_cast<size_t>(_value);
+        if (*exp != '.')
+        {
+            digits[k++] = *exp;
+        }
     }
 
-    constexpr operator bool()
+    auto e = 0;
+    std::from_chars(exp + 1 + (exp[1] == '+' ? 1 : 0), last, e);
+    auto n = e + 1;
+
+    if (k <= n && n <= 21)
     {
-        return std::isnormal(_value);
+        out.append(digits, digits + k);
+        out.append(n - k, TXT('0'));
+    }
+    else if (0 < n && n <= 21)
+    {
+        out.append(digits, digits + n);
+        out += TXT('.');
+        out.append(digits + n, digits + k);
+    }
+    else if (-6 < n && n <= 0)
+    {
+        out += TXT("0.");
+        out.append(-n, TXT('0'));
+        out.append(digits, digits + k);
     }
+    else
+    {
+        out += digits[0];
+        if (k > 1)
+        {
+            out += TXT('.');
+            out.append(digits + 1, digits + k);
+        }
 
-    template <typename T = void> requires ArithmeticOrEnum<T>
-    constexpr operator T() {
-        return static_cast<T>(_value);
+        out += TXT('e');
+        out += n - 1 < 0 ? TXT('-') : TXT('+');
+        char exponent[8];
+        auto exponentResult = std::to_chars(exponent, exponent + sizeof(exponent), n - 1 < 0 ? 1 - n : n - 1);
+        out.append(exponent, exponentResult.ptr);
     }
+}
 
-    constexpr number_t *operator->()
+static tstring number_to_tstring(double value)
+{
+    tstring out;
+    append_number(out, value);
+    return out;
+}
+
+static tstring number_to_tstring(double value, int radix)
+{
+    if (radix == 10 || radix < 2 || radix > 36 || !std::isfinite(value))
     {
-        return this;
+        return number_to_tstring(value);
     }
 
-    operator tstring() const
+    constexpr auto chars = "0123456789abcdefghijklmnopqrstuvwxyz";
+    auto negative = value < 0;
+    auto integer = std::floor(std::abs(value));
+    auto fraction = std::abs(value) - integer;
+
+    tstring out;
+    do
     {
-        tostringstream streamObj2;
-        streamObj2 << _value;
-        return streamObj2.str();
+        out += chars[static_cast<int>(std::fmod(integer, radix))];
+        integer = std::floor(integer / radix);
+    } while (integer > 0);
+
+    if (negative)
+    {
+        out += TXT('-');
     }
 
-    operator tstring()
+    std::reverse(out.begin(), out.end());
+
+    if (fraction > 0)
     {
-        tostringstream streamObj2;
-        streamObj2 << _value;
-        return streamObj2.str();
+        out += TXT('.');
+        // 52 bits of mantissa are all the precision there is
+        for (auto bits = 0; fraction > 0 && bits < 52; bits += static_cast<int>(std::log2(radix)))
+        {
+            fraction *= radix;
+            auto digit = static_cast<int>(fraction);
+            out += chars[digit];
+            fraction -= digit;
+        }
     }
 
-    operator js::string();
+    return out;
+}
 
-    inline bool operator==(undefined_t)
+template <typename C>
+static bool is_js_whitespace(C c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f' || c == 0xa0 || c == 0xfeff;
+}
+
+// longest prefix of [first, last) that is a decimal literal, "Infinity" included; nullptr when there is none
+template <typename C>
+static const C *parse_decimal(const C *first, const C *last, double &value)
+{
+    auto pos = first;
+    auto negative = false;
+    if (pos != last && (*pos == '+' || *pos == '-'))
     {
-        return is_undefined();
+        negative = *pos++ == '-';
     }
 
-    inline bool operator!=(undefined_t)
+    constexpr char infinity[] = "Infinity";
+    if (last - pos >= 8 && std::equal(infinity, infinity + 8, pos))
     {
-        return !is_undefined();
+        value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return pos + 8;
     }
 
-    inline friend bool operator==(const undefined_t, number_t other)
+    auto is_digit = [](C c) { return c >= '0' && c <= '9'; };
+    auto end = pos;
+    auto digits = 0;
+    for (; end != last && is_digit(*end); end++, digits++);
+    if (end != last && *end == '.')
     {
-        return other.is_undefined();
+        for (end++; end != last && is_digit(*end); end++, digits++);
     }
 
-    inline friend bool operator!=(const undefined_t, number_t other)
+    if (digits == 0)
     {
-        return !other.is_undefined();
+        return nullptr;
     }
 
-    inline friend bool operator==(const number_t n, js::pointer_t p)
+    if (end != last && (*end == 'e' || *end == 'E'))
     {
-        return mutable_(n).is_undefined() == p.isUndefined && false;
+        auto exp = end + 1;
+        if (exp != last && (*exp == '+' || *exp == '-'))
+        {
+            exp++;
+        }
+
+        if (exp != last && is_digit(*exp))
+        {
+            for (; exp != last && is_digit(*exp); exp++);
+            end = exp;
+        }
     }
 
-    inline friend bool operator!=(const number_t n, js::pointer_t p)
+    // from_chars takes char only, no leading '+' and no ".5"
+    char local[64];
+    std::string heap;
+    // sign, leading '0', the digits and the terminator strtod needs
+    auto size = static_cast<size_t>(end - pos) + 3;
+    auto buffer = size <= sizeof(local) ? local : (heap.resize(size), heap.data());
+    auto out = buffer;
+    if (negative)
     {
-        return mutable_(n).is_undefined() != p.isUndefined || true;
+        *out++ = '-';
     }
 
-    number_t operator+()
+    *out++ = '0';
+    for (auto it = pos; it != end; it++)
     {
-        return +_value;
+        *out++ = static_cast<char>(*it);
     }
 
-    number_t &operator++()
+    auto result = std::from_chars(buffer, out, value, std::chars_format::general);
+    if (result.ec == std::errc::result_out_of_range)
+    {
+        *out = 0;
+        value = std::strtod(buffer, nullptr);
+    }
+
+    return end;
+}
+
+template <typename C>
+static double parse_int(const C *first, const C *last, int radix)
+{
+    while (first != last && is_js_whitespace(*first))
+    {
+        first++;
+    }
+
+    auto negative = false;
+    if (first != last && (*first == '+' || *first == '-'))
+    {
+        negative = *first++ == '-';
+    }
+
+    if (radix == 0 || radix == 16)
+    {
+        if (last - first >= 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X'))
+        {
+            first += 2;
+            radix = 16;
+        }
+    }
+
+    if (radix == 0)
+    {
+        radix = 10;
+    }
+
+    if (radix < 2 || radix > 36)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    auto value = 0.0;
+    auto any = false;
+    for (; first != last; first++)
+    {
+        auto c = *first;
+        auto digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'z' ? c - 'a' + 10 : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : 36;
+        if (digit >= radix)
+        {
+            break;
+        }
+
+        value = value * radix + digit;
+        any = true;
+    }
+
+    if (!any)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return negative ? -value : value;
+}
+
+template <typename C>
+static double parse_float(const C *first, const C *last)
+{
+    while (first != last && is_js_whitespace(*first))
+    {
+        first++;
+    }
+
+    double value;
+    return parse_decimal(first, last, value) ? value : std::numeric_limits<double>::quiet_NaN();
+}
+
+// Number(string): the whole string, trimmed, must be a numeric literal
+template <typename C>
+static double string_to_number(const C *first, const C *last)
+{
+    while (first != last && is_js_whitespace(*first))
+    {
+        first++;
+    }
+
+    while (first != last && is_js_whitespace(*(last - 1)))
+    {
+        last--;
+    }
+
+    if (first == last)
+    {
+        return 0;
+    }
+
+    if (last - first > 2 && first[0] == '0')
+    {
+        auto radix = first[1] == 'x' || first[1] == 'X' ? 16 : first[1] == 'o' || first[1] == 'O' ? 8 : first[1] == 'b' || first[1] == 'B' ? 2 : 0;
+        if (radix)
+        {
+            for (auto it = first + 2; it != last; it++)
+            {
+                auto c = *it;
+                auto digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'z' ? c - 'a' + 10 : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : 36;
+                if (digit >= radix)
+                {
+                    return std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+
+            return parse_int(first + 2, last, radix);
+        }
+    }
+
+    double value;
+    auto end = parse_decimal(first, last, value);
+    return end == last ? value : std::numeric_limits<double>::quiet_NaN();
+}
+
+} // namespace utils
+
+namespace tmpl
+{
+template <typename V>
+struct number
+{
+    using number_t = number<V>;
+    V _value;
+
+    number() : _value{-std::numeric_limits<V>::quiet_NaN()}
+    {
+    }
+
+    number(const number &value) : _value{value._value}
+    {
+    }
+
+    template <typename T = void> requires ArithmeticOrEnum<T>
+    number(T initValue) : _value{static_cast<V>(initValue)}
+    {
+    }
+
+    template <typename T = void> requires ArithmeticOrEnum<T>
+    number(const shared<T>& initValue) : _value{static_cast<V>(initValue.get())}
+    {
+    }
+
+    number(js::pointer_t p) : _value{p._ptr != nullptr ? static_cast<V>(intptr_t(p._ptr)) : -std::numeric_limits<V>::quiet_NaN()}
+    {
+    }
+
+    number(const undefined_t &undef) : _value{-std::numeric_limits<V>::quiet_NaN()}
+    {
+    }
+
+    inline bool is_undefined()
+    {
+        return std::signbit(_value) && std::isnan(_value);
+    }
+
+    constexpr operator size_t()
+    {
+        return static_cast<size_t>(_value);
+    }
+
+    constexpr operator bool()
+    {
+        return std::isnormal(_value);
+    }
+
+    template <typename T = void> requires ArithmeticOrEnum<T>
+    constexpr operator T() {
+        return static_cast<T>(_value);
+    }
+
+    constexpr number_t *operator->()
+    {
+        return this;
+    }
+
+    operator tstring() const
+    {
+        return utils::number_to_tstring(static_cast<double>(_value));
+    }
+
+    operator tstring()
+    {
+        return utils::number_to_tstring(static_cast<double>(_value));
+    }
+
+    operator js::string();
+
+    inline bool operator==(undefined_t)
+    {
+        return is_undefined();
+    }
+
+    inline bool operator!=(undefined_t)
+    {
+        return !is_undefined();
+    }
+
+    inline friend bool operator==(const undefined_t, number_t other)
+    {
+        return other.is_undefined();
+    }
+
+    inline friend bool operator!=(const undefined_t, number_t other)
+    {
+        return !other.is_undefined();
+    }
+
+    inline friend bool operator==(const number_t n, js::pointer_t p)
+    {
+        return mutable_(n).is_undefined() == p.isUndefined && false;
+    }
+
+    inline friend bool operator!=(const number_t n, js::pointer_t p)
+    {
+        return mutable_(n).is_undefined() != p.isUndefined || true;
+    }
+
+    number_t operator+()
+    {
+        return +_value;
+    }
+
+    number_t &operator++()
     {
         _value += 1;
         return *this;
@@ -894,108 +1565,108 @@ struct number
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     friend number_t operator^(const number_t n, T value)
     {
-        return static_cast<long>(n._value) ^ static_cast<long>(static_cast<V>(value));
+        return bitwise::to_int32(n._value) ^ bitwise::to_int32(value);
     }
 
     template <typename T = void> requires ArithmeticOrEnum<T>
     friend number_t operator^(T value, const number_t n)
     {
-        return static_cast<long>(static_cast<V>(value)) ^ static_cast<long>(n._value);
+        return bitwise::to_int32(value) ^ bitwise::to_int32(n._value);
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t &operator^=(T value)
     {
-        _value = static_cast<long>(_value) ^ static_cast<long>(static_cast<V>(value));
+        _value = bitwise::to_int32(_value) ^ bitwise::to_int32(value);
         return *this;
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     friend number_t operator|(const number_t n, T value)
     {
-        return static_cast<long>(n._value) | static_cast<long>(static_cast<V>(value));
+        return bitwise::to_int32(n._value) | bitwise::to_int32(value);
     }
 
     template <typename T = void> requires ArithmeticOrEnum<T>
     friend T operator|(T value, const number_t n)
     {
-        return static_cast<long>(static_cast<V>(value)) | static_cast<long>(n._value);
+        return bitwise::to_int32(value) | bitwise::to_int32(n._value);
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t &operator|=(T value)
     {
-        _value = static_cast<long>(_value) | static_cast<long>(static_cast<V>(value));
+        _value = bitwise::to_int32(_value) | bitwise::to_int32(value);
         return *this;
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     friend number_t operator&(const number_t n, T value)
     {
-        return static_cast<long>(n._value) & static_cast<long>(static_cast<V>(value));
+        return bitwise::to_int32(n._value) & bitwise::to_int32(value);
     }
 
     template <typename T = void> requires ArithmeticOrEnum<T>
     friend T operator&(T value, const number_t n)
     {
-        return static_cast<long>(static_cast<V>(value)) & static_cast<long>(n._value);
+        return bitwise::to_int32(value) & bitwise::to_int32(n._value);
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t &operator&=(T value)
     {
-        _value = static_cast<long>(_value) & static_cast<long>(static_cast<V>(value));
+        _value = bitwise::to_int32(_value) & bitwise::to_int32(value);
         return *this;
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     friend number_t operator%(const number_t n, T value)
     {
-        return number_t(static_cast<long>(n._value) % static_cast<long>(static_cast<V>(value)));
+        return std::fmod(n._value, static_cast<V>(value));
     }
 
     template <typename T = void> requires ArithmeticOrEnum<T>
-    friend T operator%(T value, const number_t n)
+    friend number_t operator%(T value, const number_t n)
     {
-        return static_cast<long>(static_cast<V>(value)) % static_cast<long>(n._value);
+        return std::fmod(static_cast<V>(value), n._value);
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t &operator%=(T value)
     {
-        _value = static_cast<long>(_value) % static_cast<long>(static_cast<V>(value));
+        _value = std::fmod(_value, static_cast<V>(value));
         return *this;
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t operator<<(T value)
     {
-        return number_t(static_cast<long>(_value) << static_cast<long>(static_cast<V>(value)));
+        return number_t(bitwise::lshift(_value, value));
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t &operator<<=(T value)
     {
-        _value = static_cast<long>(_value) << static_cast<long>(static_cast<V>(value));
+        _value = bitwise::lshift(_value, value);
         return *this;
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t operator>>(T value)
     {
-        return number_t(static_cast<long>(_value) >> static_cast<long>(static_cast<V>(value)));
+        return number_t(bitwise::rshift(_value, value));
     }
 
     template <typename T = void> requires ArithmeticOrEnumOrNumber<T>
     number_t &operator>>=(T value)
     {
-        _value = static_cast<long>(_value) >> static_cast<long>(static_cast<V>(value));
+        _value = bitwise::rshift(_value, value);
         return *this;
     }
 
     number_t operator~()
     {
-        return ~static_cast<long>(_value);
+        return ~bitwise::to_int32(_value);
     }
 
     template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
@@ -1080,12 +1751,7 @@ struct number
             return os << TXT("undefined");
         }
 
-        if (std::isnan(static_cast<double>(val)))
-        {
-            return os << TXT("NaN");
-        }
-
-        return os << val._value;
+        return os << utils::number_to_tstring(static_cast<double>(val._value));
     }
 };
 
@@ -1140,176 +1806,522 @@ template <typename T>
 struct string
 {
     using string_t = string<T>;
+    using char_type = typename T::value_type;
+    using view_type = ::std::basic_string_view<char_type>;
+    using buffer_type = ::std::shared_ptr<T>;
 
-    enum
+    // short runtime strings are kept inline, the terminator included
+    static constexpr size_t sso_capacity = 24 / sizeof(char_type) - 1;
+
+    enum : unsigned char
     {
         string_defined = 0,
         string_null = 1,
         string_undefined = 2
     } _control;
-    T _value;
 
-    string() : _value(), _control(string_undefined)
+    // storage_literal: view into static storage of a literal, shared by every use, never freed
+    // storage_shared: whole _buffer
+    // storage_view: slice of a _buffer
+    // a _buffer may be referenced by several strings, on several threads; it is only changed in place
+    // (grown, or written through str()) by a string holding the only reference to it
+    enum : unsigned char
     {
-    }
+        storage_inline = 0,
+        storage_literal = 1,
+        storage_shared = 2,
+        storage_view = 3
+    } _storage;
 
-    string(const string &value) : _value(value._value), _control(value._control)
+    struct slice_t
     {
-    }
+        size_t offset;
+        size_t length;
+    };
 
-    string(js::pointer_t v) : _value(v ? static_cast<const char_t *>(v) : TXT("")), _control(v ? string_defined : string_null)
-    {
-    }
+    unsigned char _inline_size;
+    // hash of the contents, 0 until hash() is first called; anything that changes the contents clears it.
+    // Relaxed atomic: strings shared between threads may compute it at the same time, both store the same value
+    mutable std::atomic<std::uint32_t> _hash{0};
+    buffer_type _buffer;
+    union {
+        view_type _view;
+        slice_t _slice;
+        char_type _inline[sso_capacity + 1];
+    };
 
-    string(tstring value) : _value(value), _control(string_defined)
+    string() : _control(string_undefined), _storage(storage_inline), _inline_size(0), _inline{}
     {
     }
 
-    string(const char_t *value) : _value(value == nullptr ? TXT("") : value), _control(value == nullptr ? string_null : string_defined)
+    string(const string &value) : _control(value._control), _storage(storage_inline), _inline_size(0), _inline{}
     {
+        copy_from(value);
     }
 
-    string(const char_t value) : _value(1, value), _control(string_defined)
+    string(string &&value) noexcept : _control(value._control), _storage(storage_inline), _inline_size(0), _inline{}
     {
+        move_from(value);
     }
 
-    string(const undefined_t &) : _control(string_undefined)
+    string(js::pointer_t v) : string(v ? static_cast<const char_t *>(v) : nullptr)
     {
     }
 
-    inline operator const char_t *()
+    string(tstring value) : _control(string_defined), _storage(storage_inline), _inline_size(0), _inline{}
     {
-        return _value.c_str();
-    }
+        if (value.size() <= sso_capacity)
+        {
+            assign_inline(value);
+            return;
+        }
 
-    inline operator bool()
-    {
-        return _control == 0 && !_value.empty();
+        _buffer = make_buffer(std::move(value));
+        _storage = storage_shared;
     }
 
-    inline operator int()
+    string(const char_t *value) : _control(value == nullptr ? string_null : string_defined), _storage(storage_inline), _inline_size(0), _inline{}
     {
-        return !(*this) ? 0 : std::stoi(_value);
+        if (value != nullptr)
+        {
+            assign(view_type(value));
+        }
     }
 
-    inline operator double()
+    string(const char_t value) : _control(string_defined), _storage(storage_inline), _inline_size(1), _inline{value}
     {
-        return !(*this) ? 0 : std::stod(_value);
     }
 
-    inline operator T &()
+    string(const undefined_t &) : _control(string_undefined), _storage(storage_inline), _inline_size(0), _inline{}
     {
-        return _value;
     }
 
-    inline operator size_t()
+    string(const buffer_type &buffer, size_t offset, size_t length) : _control(string_defined), _storage(storage_view), _inline_size(0), _buffer(buffer), _slice{offset, length}
     {
-        return _value.size();
     }
 
-    inline bool is_null() const
+    // used by operator""_S: literals are not copied, every evaluation points at the same static storage
+    static string_t literal(const char_type *value, size_t size)
     {
-        return _control == string_null;
+        string_t result;
+        result._control = string_defined;
+        result._storage = storage_literal;
+        result._view = view_type(value, size);
+        return result;
     }
 
-    inline bool is_undefined() const
+    string &operator=(const string &value)
     {
-        return _control == string_undefined;
-    }
+        if (this != &value)
+        {
+            _control = value._control;
+            copy_from(value);
+        }
 
-    js::number get_length()
-    {
-        return js::number(_value.size());
+        return *this;
     }
 
-    constexpr string *operator->()
+    string &operator=(string &&value) noexcept
     {
-        return this;
+        if (this != &value)
+        {
+            _control = value._control;
+            move_from(value);
+        }
+
+        return *this;
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    string_t operator[](N n) const
+    // takes over the storage of value, which is left an empty inline string
+    void move_from(string &value) noexcept
     {
-        return string(_value[n]);
+        _buffer = std::move(value._buffer);
+        _storage = value._storage;
+        _hash.store(value._hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _inline_size = value._inline_size;
+        switch (_storage)
+        {
+        case storage_inline:
+            std::copy(value._inline, value._inline + sso_capacity + 1, _inline);
+            break;
+        case storage_literal:
+            _view = value._view;
+            break;
+        default:
+            _slice = value._slice;
+            break;
+        }
+
+        value._buffer.reset();
+        value.assign_inline(view_type());
+        value._control = string_undefined;
     }
 
-    template <typename B = void> requires BoolOrBoolean<B>
-    string_t operator+(B b)
+    void copy_from(const string &value)
     {
-        return string(_value + (b ? "true" : "false"));
+        _buffer = value._buffer;
+        _storage = value._storage;
+        _hash.store(value._hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _inline_size = value._inline_size;
+        switch (_storage)
+        {
+        case storage_inline:
+            std::copy(value._inline, value._inline + sso_capacity + 1, _inline);
+            break;
+        case storage_literal:
+            _view = value._view;
+            break;
+        default:
+            _slice = value._slice;
+            break;
+        }
     }
 
-    template <typename N = void> requires ArithmeticOrEnum<N>
-    string_t operator+(N value)
+    // the buffer may be changed in place: nobody else references it and this string reaches its end
+    inline bool owns_tail() const
     {
-        return string(_value + to_tstring(value));
+        if ((_storage != storage_shared && _storage != storage_view) || _buffer.use_count() != 1)
+        {
+            return false;
+        }
+
+        return _storage == storage_shared || _slice.offset + _slice.length == _buffer->size();
     }
 
-    string_t operator+(js::number value)
+    inline view_type view() const
     {
-        return string(_value + value.operator tstring());
+        switch (_storage)
+        {
+        case storage_inline:
+            return view_type(_inline, _inline_size);
+        case storage_literal:
+            return _view;
+        case storage_shared:
+            return view_type(*_buffer);
+        default:
+            return view_type(_buffer->data() + _slice.offset, _slice.length);
+        }
     }
 
-    string_t operator+(string value)
+    template <typename V>
+    static buffer_type make_buffer(V &&value)
     {
-        return string(_value + value._value);
+        auto buffer = std::make_shared<T>(std::forward<V>(value));
+        JS_STAT(string_allocations);
+        JS_STAT_ADD(string_bytes, buffer->size() * sizeof(char_type));
+        return buffer;
     }
 
-    friend string_t operator+(const string &value, string other)
+    static buffer_type reserve_buffer(size_t size)
     {
-        return mutable_(value) + other;
+        auto buffer = std::make_shared<T>();
+        buffer->reserve(size);
+        JS_STAT(string_allocations);
+        JS_STAT_ADD(string_bytes, size * sizeof(char_type));
+        return buffer;
     }
 
-    string_t operator+(js::pointer_t ptr)
+    T &str()
     {
-        return string(_value + ((!ptr) ? TXT("null") : to_tstring(static_cast<size_t>(ptr))));
-    }
+        // the caller may change the contents through the reference
+        _hash.store(0, std::memory_order_relaxed);
+        if (_storage == storage_shared && _buffer.use_count() == 1)
+        {
+            return *_buffer;
+        }
 
-    string_t operator+(any value);
+        if (_storage == storage_view && _slice.offset == 0 && _buffer.use_count() == 1)
+        {
+            _buffer->resize(_slice.length);
+        }
+        else
+        {
+            _buffer = make_buffer(view());
+        }
 
-    string_t &operator+=(char_t c)
-    {
-        _control = string_defined;
-        _value.append(string(c)._value);
-        return *this;
+        _storage = storage_shared;
+        return *_buffer;
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    string_t &operator+=(N n)
+    void assign_inline(view_type value)
     {
-        auto value = t_tostring(n);
-        _control = string_defined;
-        _value.append(value);
-        return *this;
+        _hash.store(0, std::memory_order_relaxed);
+        std::copy(value.begin(), value.end(), _inline);
+        _inline[value.size()] = 0;
+        _inline_size = static_cast<unsigned char>(value.size());
+        _storage = storage_inline;
     }
 
-    string_t &operator+=(string value)
+    void assign(view_type value)
     {
-        _control = string_defined;
-        _value.append(value._value);
-        return *this;
+        _hash.store(0, std::memory_order_relaxed);
+        if (value.size() <= sso_capacity)
+        {
+            auto keep = std::move(_buffer);
+            assign_inline(value);
+            return;
+        }
+
+        _buffer = make_buffer(value);
+        _storage = storage_shared;
     }
 
-    string_t &operator+=(any value);
+    void append(view_type value)
+    {
+        _control = string_defined;
+        _hash.store(0, std::memory_order_relaxed);
+        if (_storage == storage_inline && _inline_size + value.size() <= sso_capacity)
+        {
+            std::copy(value.begin(), value.end(), _inline + _inline_size);
+            _inline_size += static_cast<unsigned char>(value.size());
+            _inline[_inline_size] = 0;
+            return;
+        }
+
+        if (owns_tail())
+        {
+            append_buffer(value);
+            if (_storage == storage_view)
+            {
+                _slice.length += value.size();
+            }
+
+            return;
+        }
+
+        // value may point into the storage being replaced; the new buffer gets room to grow,
+        // so a string that is shared once in a while still appends in amortized O(1)
+        auto current = view();
+        auto buffer = reserve_buffer((current.size() + value.size()) * 2);
+        buffer->append(current.data(), current.size());
+        buffer->append(value.data(), value.size());
+        _buffer = std::move(buffer);
+        _storage = storage_shared;
+    }
+
+    void append_buffer(view_type value)
+    {
+#ifdef JS_STATS
+        auto capacity = _buffer->capacity();
+        _buffer->append(value.data(), value.size());
+        if (_buffer->capacity() != capacity)
+        {
+            JS_STAT(string_allocations);
+            JS_STAT_ADD(string_bytes, _buffer->capacity() * sizeof(char_type));
+        }
+#else
+        _buffer->append(value.data(), value.size());
+#endif
+    }
+
+    // this + value as a new string; this keeps its buffer untouched, other strings may be reading it
+    string_t append_copy(view_type value)
+    {
+        return concat(view(), value);
+    }
+
+    static string_t concat(view_type left, view_type right)
+    {
+        string_t result;
+        result._control = string_defined;
+        if (left.size() + right.size() <= sso_capacity)
+        {
+            result.assign_inline(left);
+            result.append(right);
+            return result;
+        }
+
+        auto buffer = reserve_buffer(left.size() + right.size());
+        buffer->append(left.data(), left.size());
+        buffer->append(right.data(), right.size());
+        result._buffer = std::move(buffer);
+        result._storage = storage_shared;
+        return result;
+    }
+
+    string_t sub(size_t pos, size_t count) const
+    {
+        auto value = view().substr(pos, count);
+        if (value.size() <= sso_capacity)
+        {
+            string_t result;
+            result._control = string_defined;
+            result.assign_inline(value);
+            return result;
+        }
+
+        if (_storage == storage_literal)
+        {
+            return literal(value.data(), value.size());
+        }
+
+        return string_t(_buffer, value.data() - _buffer->data(), value.size());
+    }
+
+    inline operator const char_t *()
+    {
+        // literals, inline strings and buffers are terminated right behind the view only when it reaches their end
+        auto value = view();
+        if (value.data() != nullptr && value.data()[value.size()] == 0)
+        {
+            return value.data();
+        }
+
+        return str().c_str();
+    }
+
+    inline operator bool()
+    {
+        return _control == 0 && !view().empty();
+    }
+
+    inline operator int()
+    {
+        auto value = static_cast<double>(*this);
+        return std::isnan(value) ? 0 : static_cast<int>(value);
+    }
+
+    inline operator double()
+    {
+        auto value = view();
+        return !(*this) ? 0 : utils::string_to_number(value.data(), value.data() + value.size());
+    }
+
+    inline operator T &()
+    {
+        return str();
+    }
+
+    inline operator size_t()
+    {
+        return view().size();
+    }
+
+    inline bool is_null() const
+    {
+        return _control == string_null;
+    }
+
+    inline bool is_undefined() const
+    {
+        return _control == string_undefined;
+    }
+
+    js::number get_length()
+    {
+        return js::number(view().size());
+    }
+
+    constexpr string *operator->()
+    {
+        return this;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    string_t operator[](N n) const
+    {
+        return string(view()[n]);
+    }
+
+    template <typename B = void> requires BoolOrBoolean<B>
+    string_t operator+(B b)
+    {
+        return append_copy(b ? TXT("true") : TXT("false"));
+    }
+
+    template <typename N = void> requires ArithmeticOrEnum<N>
+    string_t operator+(N value)
+    {
+        return append_copy(to_tstring(value));
+    }
+
+    string_t operator+(js::number value)
+    {
+        return append_copy(value.operator tstring());
+    }
+
+    string_t operator+(const string &value) &
+    {
+        return append_copy(value.view());
+    }
+
+    // the left side is a temporary, as in every link of a + b + c after the first: grow it and hand it on
+    string_t operator+(const string &value) &&
+    {
+        append(value.view());
+        return std::move(*this);
+    }
+
+    friend string_t operator+(const string &value, const string &other)
+    {
+        return mutable_(value) + other;
+    }
+
+    string_t operator+(js::pointer_t ptr)
+    {
+        return append_copy((!ptr) ? TXT("null") : to_tstring(static_cast<size_t>(ptr)));
+    }
+
+    string_t operator+(const any &value);
+
+    string_t &operator+=(char_t c)
+    {
+        append(view_type(&c, 1));
+        return *this;
+    }
+
+    template <typename B = void> requires BoolOrBoolean<B>
+    string_t &operator+=(B b)
+    {
+        append(b ? TXT("true") : TXT("false"));
+        return *this;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnum<N>
+    string_t &operator+=(N n)
+    {
+        append(to_tstring(n));
+        return *this;
+    }
+
+    string_t &operator+=(js::number value)
+    {
+        append(value.operator tstring());
+        return *this;
+    }
+
+    string_t &operator+=(js::pointer_t ptr)
+    {
+        append((!ptr) ? TXT("null") : to_tstring(static_cast<size_t>(ptr)));
+        return *this;
+    }
+
+    string_t &operator+=(const string &value)
+    {
+        append(value.view());
+        return *this;
+    }
+
+    string_t &operator+=(const any &value);
 
     bool operator==(const string_t &other) const
     {
-        return _control == string_defined && _value.compare(other._value) == 0;
+        return _control == string_defined && view() == other.view();
     }
 
     bool operator==(const string_t &other)
     {
-        return _control == string_defined && _value.compare(other._value) == 0;
+        return _control == string_defined && view() == other.view();
     }
 
     bool operator!=(const string_t &other) const
     {
-        return _control == string_defined && _value.compare(other._value) != 0;
+        return _control == string_defined && view() != other.view();
     }
 
     bool operator!=(const string_t &other)
     {
-        return _control == string_defined && _value.compare(other._value) != 0;
+        return _control == string_defined && view() != other.view();
     }
 
     bool operator==(undefined_t)
@@ -1352,21 +2364,21 @@ struct string
         return other._control == string_defined && (!ptr);
     }
 
-    string_t concat(string value)
+    string_t concat(const string &value)
     {
-        return _value + value._value;
+        return append_copy(value.view());
     }
 
     template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
     string_t charAt(N n) const
     {
-        return _value[n];
+        return view()[n];
     }
 
     template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
     js::number charCodeAt(N n) const
     {
-        return static_cast<size_t>(_value[n]);
+        return static_cast<size_t>(view()[n]);
     }
 
     template <typename N = void> requires can_cast_to_size_t<N>
@@ -1377,7 +2389,7 @@ struct string
 
     string_t toUpperCase()
     {
-        std::string result(this->operator std::string &());
+        T result(view());
         for (auto &c : result)
         {
             c = toupper(c);
@@ -1388,7 +2400,7 @@ struct string
 
     string_t toLowerCase()
     {
-        std::string result(this->operator std::string &());
+        T result(view());
         for (auto &c : result)
         {
             c = tolower(c);
@@ -1400,13 +2412,13 @@ struct string
     template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
     string_t substring(N begin, N end)
     {
-        return _value.substr(begin, end - begin);
+        return sub(begin, end - begin);
     }
 
     template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
     string_t slice(N begin)
     {
-        return _value.substr(begin < js::number(0) ? get_length() + begin : begin, get_length() - begin);
+        return sub(begin < js::number(0) ? get_length() + begin : begin, get_length() - begin);
     }
 
     template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
@@ -1414,17 +2426,95 @@ struct string
     {
         auto endStart = end < js::number(0) ? get_length() + end : end;
         auto endPosition = begin < js::number(0) ? get_length() + begin : begin;
-        return _value.substr(begin < js::number(0) ? get_length() + begin : begin, (endStart >= endPosition) ? endStart - endPosition : js::number(0));
+        return sub(begin < js::number(0) ? get_length() + begin : begin, (endStart >= endPosition) ? endStart - endPosition : js::number(0));
     }
 
-    auto begin()
+    // the regular expression overloads forward to RegExp, which is declared later
+    template <typename R>
+    auto match(const std::shared_ptr<R> &re) const
     {
-        return _value.begin();
+        return re->match_string(*this);
     }
 
-    auto end()
+    template <typename R>
+    js::number search(const std::shared_ptr<R> &re) const
+    {
+        return re->search_string(*this);
+    }
+
+    template <typename R, typename W>
+    string_t replace(const std::shared_ptr<R> &re, W replacement) const
+    {
+        return re->replace_string(*this, replacement);
+    }
+
+    template <typename R>
+    array<string_t> split(const std::shared_ptr<R> &re) const
+    {
+        return re->split_string(*this);
+    }
+
+    // first occurrence only, like String.prototype.replace with a string pattern
+    string_t replace(string_t pattern, string_t replacement) const
+    {
+        auto value = view();
+        auto found = value.find(pattern.view());
+        if (found == view_type::npos)
+        {
+            return *this;
+        }
+
+        string_t result(sub(0, found));
+        result.append(replacement.view());
+        result.append(value.substr(found + pattern.view().size()));
+        return result;
+    }
+
+    array<string_t> split() const
+    {
+        return array<string_t>(std::vector<string_t>{*this});
+    }
+
+    // the parts are slices sharing the buffer of this string
+    array<string_t> split(string_t separator, js::number limit = js::number(-1)) const
+    {
+        auto value = view();
+        auto needle = separator.view();
+        auto max = limit < js::number(0) ? std::numeric_limits<size_t>::max() : static_cast<size_t>(limit);
+        std::vector<string_t> parts;
+        if (needle.empty())
+        {
+            for (size_t index = 0; index < value.size() && parts.size() < max; index++)
+            {
+                parts.push_back(sub(index, 1));
+            }
+
+            return array<string_t>(parts);
+        }
+
+        size_t last = 0;
+        for (auto found = value.find(needle); found != view_type::npos && parts.size() < max; found = value.find(needle, last))
+        {
+            parts.push_back(sub(last, found - last));
+            last = found + needle.size();
+        }
+
+        if (parts.size() < max)
+        {
+            parts.push_back(sub(last, value.size() - last));
+        }
+
+        return array<string_t>(parts);
+    }
+
+    auto begin() const
     {
-        return _value.end();
+        return view().begin();
+    }
+
+    auto end() const
+    {
+        return view().end();
     }
 
     friend tostream &operator<<(tostream &os, string val)
@@ -1434,12 +2524,29 @@ struct string
             return os << "undefined";
         }
 
-        return os << val._value;
+        return os << val.view();
     }
 
     size_t hash(void) const noexcept
     {
-        return std::hash<T>{}(_value);
+        auto cached = _hash.load(std::memory_order_relaxed);
+        if (cached == 0)
+        {
+            auto value = view();
+            auto hash = static_cast<std::uint32_t>(utils::hash_bytes(value.data(), value.size() * sizeof(char_type)));
+            cached = hash == 0 ? 1 : hash;
+            _hash.store(cached, std::memory_order_relaxed);
+        }
+
+        return cached;
+    }
+
+    // different cached hashes prove the contents differ without comparing them
+    bool hash_differs(const string_t &other) const noexcept
+    {
+        auto hash = _hash.load(std::memory_order_relaxed);
+        auto other_hash = other._hash.load(std::memory_order_relaxed);
+        return hash != 0 && other_hash != 0 && hash != other_hash;
     }
 };
 
@@ -1453,11 +2560,11 @@ string toString(const T& val) {
   return string(os.str());
 }
 
-static string string_empty(TXT(""));
+static string string_empty = string::literal(TXT(""), 0);
 
 static js::string operator""_S(const char_t *s, std::size_t size)
 {
-    return js::string(s);
+    return js::string::literal(s, size);
 }
 
 static js::number operator""_N(long double value)
@@ -1510,6 +2617,7 @@ template <typename Rx, typename _Cls, typename... Args>
 struct _Deduction_MethodPtr<Rx (__thiscall _Cls::*)(Args...) const>
 {
     using _ReturnType = Rx;
+    using _Signature = Rx(Args...);
     const static size_t _CountArgs = sizeof...(Args);
 };
 
@@ -1517,6 +2625,7 @@ template <typename Rx, typename _Cls, typename... Args>
 struct _Deduction_MethodPtr<Rx (__thiscall _Cls::*)(Args...)>
 {
     using _ReturnType = Rx;
+    using _Signature = Rx(Args...);
     const static size_t _CountArgs = sizeof...(Args);
 };
 
@@ -1524,6 +2633,7 @@ template <typename Rx, typename... Args>
 struct _Deduction_MethodPtr<Rx(__cdecl *)(Args...)>
 {
     using _ReturnType = Rx;
+    using _Signature = Rx(Args...);
     const static size_t _CountArgs = sizeof...(Args);
 };
 
@@ -1533,43 +2643,78 @@ struct _Deduction
     using type = _type;
 };
 
-template <typename F, typename Array, std::size_t... I>
-auto invoke_seq_impl(const F &f, Array &a, std::index_sequence<I...>)
+// every parameter gets its own copy of the caller's argument (the initializer_list is const), missing ones a
+// fresh undefined. A is deduced so the copy is only compiled where any is complete
+template <std::size_t I, typename A>
+inline A invoke_arg(const A *args, std::size_t count)
 {
-    return std::invoke(f, a[I]...);
+    return I < count ? A(args[I]) : A();
 }
 
-template <std::size_t N, typename F, typename Array, typename Indices = std::make_index_sequence<N>>
-auto invoke_seq(const F &f, Array &a)
+template <typename F, std::size_t... I>
+auto invoke_args_impl(F &f, const any *args, std::size_t count, std::index_sequence<I...>)
 {
-    return invoke_seq_impl(f, a, Indices{});
+    return std::invoke(f, invoke_arg<I>(args, count)...);
 }
 
-template <typename F, typename Array, std::size_t... I>
-auto invoke_seq_impl(F &f, Array &a, std::index_sequence<I...>)
+template <std::size_t N, typename F, typename Indices = std::make_index_sequence<N>>
+auto invoke_args(F &f, const any *args, std::size_t count)
 {
-    return std::invoke(f, a[I]...);
+    return invoke_args_impl(f, args, count, Indices{});
 }
 
-template <std::size_t N, typename F, typename Array, typename Indices = std::make_index_sequence<N>>
-auto invoke_seq(F &f, Array &a)
+template <typename S>
+struct typed_function;
+
+template <typename Rx, typename... Args>
+struct typed_function<Rx(Args...)>
 {
-    return invoke_seq_impl(f, a, Indices{});
-}
+    virtual Rx call(Args... args) = 0;
+};
+
+template <typename D, typename S>
+struct typed_function_t;
+
+template <typename D, typename Rx, typename... Args>
+struct typed_function_t<D, Rx(Args...)> : typed_function<Rx(Args...)>
+{
+    virtual Rx call(Args... args) override
+    {
+        return std::invoke(static_cast<D *>(this)->_f, args...);
+    }
+};
 
 struct function
 {
     virtual any invoke(std::initializer_list<any> args_) = 0;
 
+    // one address per signature, compared instead of std::type_info
+    template <typename S>
+    static const void *signature_id()
+    {
+        static const char id = 0;
+        return &id;
+    }
+
+    // typed_function<S> * when the callable has exactly the signature S, nullptr otherwise
+    virtual void *signature_cast(const void *signature) = 0;
+
+    template <typename S>
+    typed_function<S> *as_typed()
+    {
+        return static_cast<typed_function<S> *>(signature_cast(signature_id<S>()));
+    }
+
     template <typename... Args>
     auto operator()(Args... args);
 };
 
 template <typename F, typename _MethodType = typename _Deduction<F>::type>
-struct function_t : function
+struct function_t : function, typed_function_t<function_t<F, _MethodType>, typename _Deduction_MethodPtr<_MethodType>::_Signature>
 {
     using _MethodPtr = _Deduction_MethodPtr<_MethodType>;
     using _ReturnType = typename _MethodPtr::_ReturnType;
+    using _Signature = typename _MethodPtr::_Signature;
 
     F _f;
 
@@ -1578,6 +2723,12 @@ struct function_t : function
     }
 
     virtual any invoke(std::initializer_list<any> args_) override;
+
+    virtual void *signature_cast(const void *signature) override
+    {
+        return signature == signature_id<_Signature>() ? static_cast<typed_function<_Signature> *>(this) : nullptr;
+    }
+
 };
 
 template <typename T>
@@ -1619,2668 +2770,9354 @@ struct ArrayKeys
     }
 };
 
-namespace tmpl
+namespace utils
 {
 
-template <typename E>
-struct array
+// runtime-owned workers: one deque per worker, a worker takes its newest task first and steals the oldest ones of
+// the others when it runs dry. Tasks submitted from outside are spread over the deques. Used by js::thread, the
+// parallel array methods and js::offload. The thread that waits for a parallel job works on it as well, so a job
+// started from inside another job cannot deadlock
+struct thread_pool
 {
-    using array_type_base = std::vector<E>;
-    //using array_type = array_type_base; // array_type_base - value type, std::shared_ptr<array_type_base> - reference type
-    using array_type = std::shared_ptr<array_type_base>; // array_type_base - value type, std::shared_ptr<array_type_base> - reference type
-    using array_type_ref = array_type_base &;
-
-    template <typename _Ty> 
-    struct array_traits {
-        template<class... _Types>
-	    static _Ty create(_Types&&... _Args) {
-            return array_type_base(_Args...);
-        }
-
-        static constexpr _Ty& access(std::remove_reference_t<_Ty>& _Arg)
-        {	
-            return (static_cast<_Ty&>(_Arg));
-        }
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
     };
 
-    template <>
-    struct array_traits<std::shared_ptr<array_type_base>> {
-        template<class... _Types>
-	    static inline auto create(_Types&&... _Args) {
-            return std::make_shared<array_type_base>(_Args...);
-        }        
-
-        static inline array_type_ref access(array_type& _Arg)
-        {	
-            return (static_cast<array_type_ref>(*_Arg));
-        }
-    };
+    std::vector<std::unique_ptr<task_queue>> _queues;
+    std::vector<std::thread> _workers;
+    std::mutex _sleep_mutex;
+    std::condition_variable _ready;
+    std::atomic<size_t> _queued;
+    std::atomic<size_t> _next_queue;
+    std::atomic<bool> _stopping;
 
-    bool isUndefined;
-    array_type _values;
+    static inline thread_local thread_pool *_current_pool = nullptr;
+    static inline thread_local size_t _current_index = 0;
 
-    array() : _values(array_traits<array_type>::create()), isUndefined(false)
+    thread_pool(size_t count) : _queued(0), _next_queue(0), _stopping(false)
     {
-    }
+        for (size_t i = 0; i < std::max<size_t>(1, count); i++)
+        {
+            _queues.push_back(std::make_unique<task_queue>());
+        }
 
-    array(const array &value) : _values(value._values), isUndefined(value.isUndefined)
-    {
+        for (size_t i = 0; i < count; i++)
+        {
+            _workers.emplace_back([this, i]() { work(i); });
+        }
     }
 
-    array(std::initializer_list<E> values) : _values(array_traits<array_type>::create(values)), isUndefined(false)
+    ~thread_pool()
     {
+        shutdown();
     }
 
-    array(std::vector<E> values) : _values(array_traits<array_type>::create(values)), isUndefined(false)
+    static thread_pool &shared()
     {
+        static thread_pool pool(concurrency() - 1);
+        return pool;
     }
 
-    array(const undefined_t &undef) : _values(array_traits<array_type>::create()), isUndefined(true)
+    static size_t concurrency()
     {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
     }
 
-    constexpr operator bool()
+    // after shutdown the task runs on the calling thread
+    void submit(std::function<void()> task)
     {
-        return !isUndefined;
-    }
+        if (_stopping || _workers.empty())
+        {
+            task();
+            return;
+        }
 
-    constexpr array *operator->()
-    {
-        return this;
-    } 
+        // counted before it is published: a thief taking it first would otherwise wrap _queued below zero
+        auto index = _current_pool == this ? _current_index : _next_queue++ % _queues.size();
+        _queued++;
+        try
+        {
+            std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+            _queues[index]->tasks.push_back(std::move(task));
+        }
+        catch (...)
+        {
+            _queued--;
+            throw;
+        }
 
-    constexpr array_type_ref get() const
-    {
-        return array_traits<array_type>::access(mutable_(_values));
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+        }
+
+        _ready.notify_one();
     }
 
-    constexpr array_type_ref get()
+    // join handle for the result of f()
+    template <typename F>
+    auto async(F f) -> std::future<decltype(f())>
     {
-        return array_traits<array_type>::access(_values);
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+        auto result = task->get_future();
+        submit([task]() { (*task)(); });
+        return result;
     }
 
-    size_t get_length()
+    // runs what is queued and joins the workers, MAIN calls it before returning
+    void shutdown()
     {
-        return get().size();
+        if (_stopping.exchange(true))
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+        }
+
+        _ready.notify_all();
+        for (auto &worker : _workers)
+        {
+            worker.join();
+        }
     }
 
-    template <typename N = void> requires can_cast_to_size_t<N>
-    E &operator[](N i) const
+    // calls body(first, last) for consecutive chunks of [0, count) and returns when all of them are done
+    template <typename F>
+    void for_chunks(size_t count, size_t min_chunk, F &&body)
     {
-        if (static_cast<size_t>(i) >= get().size())
-        {                        
-            if constexpr (std::is_same_v<decltype(E{undefined}), E>) {
-                static E empty{undefined};
-                return empty;
-            } else {
-                static E empty;
-                return empty;
+        auto chunks = std::min(count / std::max<size_t>(1, min_chunk), concurrency() * 4);
+        if (chunks < 2 || _workers.empty())
+        {
+            if (count > 0)
+            {
+                body(size_t(0), count);
             }
+
+            return;
+        }
+
+        struct job
+        {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            size_t chunks;
+            size_t count;
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr error;
+            std::remove_reference_t<F> *body;
+        };
+
+        auto state = std::make_shared<job>();
+        state->chunks = chunks;
+        state->count = count;
+        state->body = &body;
+
+        // late helpers find no chunk left and never touch body
+        auto run = [state]() {
+            size_t chunk;
+            while ((chunk = state->next++) < state->chunks)
+            {
+                try
+                {
+                    (*state->body)(chunk * state->count / state->chunks, (chunk + 1) * state->count / state->chunks);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (!state->error)
+                    {
+                        state->error = std::current_exception();
+                    }
+                }
+
+                if (++state->done == state->chunks)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+
+        for (size_t i = 0, helpers = std::min(_workers.size(), chunks - 1); i < helpers; i++)
+        {
+            submit(run);
         }
 
-        return mutable_(get())[static_cast<size_t>(i)];
+        run();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&]() { return state->done == state->chunks; });
+        if (state->error)
+        {
+            std::rethrow_exception(state->error);
+        }
     }
 
-    template <typename N = void> requires can_cast_to_size_t<N>
-    E &operator[](N i)
+private:
+    bool take(size_t index, std::function<void()> &task)
     {
-        while (static_cast<size_t>(i) >= get().size())
         {
-            if constexpr (std::is_same_v<decltype(E{undefined}), E>) {
-                get().push_back(E{undefined});
-            } else {
-                get().push_back(E{});
-            }            
+            auto &own = *_queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                _queued--;
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < _queues.size(); i++)
+        {
+            auto &other = *_queues[(index + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (!other.tasks.empty())
+            {
+                task = std::move(other.tasks.front());
+                other.tasks.pop_front();
+                _queued--;
+                return true;
+            }
         }
 
-        return get()[static_cast<size_t>(i)];
+        return false;
     }
 
-    ArrayKeys<size_t> keys()
+    void work(size_t index)
     {
-        return ArrayKeys<size_t>(get().size());
+        _current_pool = this;
+        _current_index = index;
+        while (true)
+        {
+            std::function<void()> task;
+            if (take(index, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _ready.wait(lock, [this]() { return _stopping || _queued > 0; });
+            if (_stopping && _queued == 0)
+            {
+                return;
+            }
+        }
     }
+};
 
-    void push(E t)
+// bump allocation for request-scoped work. While an arena_scope is active on a thread, js::make and the storage of
+// new arrays and objects are carved out of its blocks, and the blocks are released all at once when the scope ends.
+// deallocate() frees nothing; in debug builds the arena counts live allocations and checks none survive the release
+struct arena
+{
+    static constexpr size_t block_size = 64 * 1024;
+
+    struct block
     {
-        get().push_back(t);
-    }
+        block *next;
+        size_t size;
+    };
 
-    template <typename... Args>
-    void push(Args... args)
+    block *_blocks = nullptr;
+    char *_next = nullptr;
+    char *_end = nullptr;
+#ifndef NDEBUG
+    std::atomic<size_t> _live{0};
+#endif
+
+    arena() = default;
+
+    arena(const arena &) = delete;
+
+    arena &operator=(const arena &) = delete;
+
+    ~arena()
     {
-        for (const auto &item : {args...})
+        release();
+        if (_blocks)
         {
-            get().push_back(item);
+            std::free(_blocks);
         }
     }
 
-    E pop()
+    static arena *&current()
     {
-        return get().pop_back();
+        thread_local arena *value = nullptr;
+        return value;
     }
 
-    template <typename... Args>
-    void splice(size_t position, size_t size, Args... args)
+    void *allocate(size_t size, size_t alignment)
     {
-        get().erase(get().cbegin() + position, get().cbegin() + position + size);
-        get().insert(get().cbegin() + position, {args...});
+        auto address = (reinterpret_cast<std::uintptr_t>(_next) + alignment - 1) & ~(alignment - 1);
+        if (!_next || address + size > reinterpret_cast<std::uintptr_t>(_end))
+        {
+            grow(size + alignment);
+            address = (reinterpret_cast<std::uintptr_t>(_next) + alignment - 1) & ~(alignment - 1);
+        }
+
+        _next = reinterpret_cast<char *>(address + size);
+#ifndef NDEBUG
+        _live.fetch_add(1, std::memory_order_relaxed);
+#endif
+        return reinterpret_cast<void *>(address);
     }
 
-    array slice(size_t first, size_t last)
+    void deallocate(void *, size_t)
     {
-        return array(std::vector<E>(get().cbegin() + first, get().cbegin() + last + 1));
+#ifndef NDEBUG
+        _live.fetch_sub(1, std::memory_order_relaxed);
+#endif
     }
 
-    js::number indexOf(const E &e)
+    // keeps the first block for the next round of allocations
+    void release()
     {
-        return get().cend() - std::find(get().cbegin(), get().cend(), e) - 1;
+#ifndef NDEBUG
+        if (_live.load(std::memory_order_relaxed) != 0)
+        {
+            std::cerr << "arena released while " << _live.load() << " allocations are still referenced" << std::endl;
+            std::abort();
+        }
+#endif
+
+        if (!_blocks)
+        {
+            return;
+        }
+
+        while (_blocks->next)
+        {
+            auto next = _blocks->next;
+            std::free(_blocks);
+            _blocks = next;
+        }
+
+        _next = reinterpret_cast<char *>(_blocks + 1);
+        _end = _next + _blocks->size;
     }
 
-    js::boolean removeElement(const E &e)
+    void grow(size_t minimum)
     {
-        return get().erase(std::find(get().cbegin(), get().cend(), e)) != get().cend();
+        auto size = (std::max)(minimum, _blocks ? _blocks->size * 2 : block_size);
+        auto fresh = static_cast<block *>(std::malloc(sizeof(block) + size));
+        if (!fresh)
+        {
+            throw std::bad_alloc();
+        }
+
+        // the newest block is last in the list, so release() ends up keeping the first and smallest one
+        fresh->next = nullptr;
+        fresh->size = size;
+        if (_blocks)
+        {
+            auto last = _blocks;
+            while (last->next)
+            {
+                last = last->next;
+            }
+
+            last->next = fresh;
+        }
+        else
+        {
+            _blocks = fresh;
+        }
+
+        _next = reinterpret_cast<char *>(fresh + 1);
+        _end = _next + size;
     }
+};
 
-    auto begin()
+template <typename T>
+struct arena_allocator
+{
+    using value_type = T;
+
+    arena *_arena;
+
+    arena_allocator(arena *owner) : _arena(owner)
     {
-        return get().begin();
     }
 
-    auto end()
+    template <typename U>
+    arena_allocator(const arena_allocator<U> &other) : _arena(other._arena)
     {
-        return get().end();
     }
 
-    friend std::ostream &operator<<(std::ostream &os, array val)
+    T *allocate(size_t count)
     {
-        if (val.isUndefined)
-        {
-            return os << "undefined";
-        }
-
-        return os << "[array]";
+        return static_cast<T *>(_arena->allocate(count * sizeof(T), alignof(T)));
     }
 
-    template <typename N = void> requires can_cast_to_size_t<N>
-    bool exists(N n) const
+    void deallocate(T *pointer, size_t count)
     {
-        return static_cast<size_t>(n) < get().size();
+        _arena->deallocate(pointer, count * sizeof(T));
     }
 
-    template <class T>
-    bool exists(T) const
+    template <typename U>
+    bool operator==(const arena_allocator<U> &other) const
     {
-        return false;
+        return _arena == other._arena;
     }
 
-    array filter(std::function<bool(E)> p)
+    template <typename U>
+    bool operator!=(const arena_allocator<U> &other) const
     {
-        std::vector<E> result;
-        std::copy_if(get().begin(), get().end(), std::back_inserter(result), p);
-        return result;
+        return _arena != other._arena;
     }
+};
+
+// everything js::make allocates on this thread until the scope ends lives in one arena; nothing allocated inside
+// may be kept after it (timers, globals, values returned out of the scope)
+struct arena_scope
+{
+    arena _arena;
+    arena *_previous;
 
-    array filter(std::function<bool(E, size_t)> p)
+    arena_scope() : _previous(arena::current())
     {
-        std::vector<E> result;
-        auto first = &(get())[0];
-        std::copy_if(get().begin(), get().end(), std::back_inserter(result), [=](auto &v) {
-            auto index = &v - first;
-            return p(v, index);
-        });
-        return result;
+        arena::current() = &_arena;
     }
 
-    template <typename F, class = decltype(F()())>
-    auto map(F p) -> array< undefined_t >
-    {        
-        std::vector< undefined_t > result;
-        std::transform(get().begin(), get().end(), std::back_inserter(result), [=](auto &v) {
-            mutable_(p)(v);
-            return undefined;
-        });
+    arena_scope(const arena_scope &) = delete;
 
-        return array< undefined_t > (result);
+    ~arena_scope()
+    {
+        arena::current() = _previous;
     }
+};
 
-    template <typename F, class = decltype(F()(E()))>
-    auto map(F p) -> array< decltype(p(E())) >
-    {        
-        std::vector< decltype(p(E())) > result;
-        std::transform(get().begin(), get().end(), std::back_inserter(result), [=](auto &v) {
-            return mutable_(p)(v);
-        });
+} // namespace utils
 
-        return array< decltype(p(E())) >(result);
+// all shared allocations of generated code: new, array and object storage. They come from the thread's arena inside an
+// arena_scope, from the heap otherwise
+template <typename T, class... Args>
+inline std::shared_ptr<T> make(Args &&...args)
+{
+    if (auto owner = utils::arena::current())
+    {
+        return std::allocate_shared<T>(utils::arena_allocator<T>(owner), std::forward<Args>(args)...);
     }
 
-    template <typename F, class = decltype(F()(E(), 0))>
-    auto map(F p) -> array< decltype(p(E(), 0)) >
-    {        
-        std::vector< decltype(p(E(), 0)) > result;
-        auto first = &(get())[0];
-        std::transform(get().begin(), get().end(), std::back_inserter(result), [=](auto &v) {
-            auto index = &v - first;
-            return mutable_(p)(v, index);
-        });
+    return std::make_shared<T>(std::forward<Args>(args)...);
+}
 
-        return array< decltype(p(E(), 0)) >(result);
-    }
+// for TS code, declared in cpplib/core.d.ts
+template <typename F>
+inline void withArena(F callback)
+{
+    utils::arena_scope scope;
+    callback();
+}
 
-    template <typename P>
-    auto reduce(P p)
+// storage for JS_COW_STORAGE: arrays and objects become values that share their data until one of the copies
+// writes to it. The refcount is not atomic, do not share such values between threads.
+template <typename T>
+struct cow_ptr
+{
+    struct block
     {
-        return std::reduce(get().begin(), get().end(), 0, p);
-    }
+        std::size_t _refs;
+        T _value;
 
-    template <typename P, typename I>
-    auto reduce(P p, I initial)
+        template <class... Args>
+        block(Args &&... args) : _refs(1), _value(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+    block *_block;
+
+    cow_ptr() : _block(nullptr)
     {
-        return std::reduce(get().begin(), get().end(), initial, p);
     }
 
-    template <typename P>
-    boolean every(P p)
+    cow_ptr(const cow_ptr &other) : _block(other._block)
     {
-        return std::all_of(get().begin(), get().end(), p);
+        if (_block)
+        {
+            _block->_refs++;
+        }
     }
 
-    template <typename P>
-    boolean some(P p)
+    cow_ptr(cow_ptr &&other) noexcept : _block(other._block)
     {
-        return std::any_of(get().begin(), get().end(), p);
+        other._block = nullptr;
     }
 
-    js::string join(js::string s)
+    ~cow_ptr()
     {
-        return std::accumulate(get().begin(), get().end(), js::string{}, [&](auto &res, auto &piece) {
-            return res += (res) ? s + piece : piece;
-        });
+        release();
     }
 
-    void forEach(std::function<void(E)> p)
+    template <class... Args>
+    static cow_ptr make(Args &&... args)
     {
-        std::for_each(get().begin(), get().end(), p);
+        cow_ptr result;
+        result._block = new block(std::forward<Args>(args)...);
+        return result;
     }
 
-    void forEach(std::function<void(E, size_t)> p)
+    cow_ptr &operator=(const cow_ptr &other)
     {
-        auto first = &(*_values.get())[0];
-        std::result(get().begin(), get().end(), [=](auto &v) {
-            auto index = &v - first;
-            return p(v, index);
-        });
-    }
-};
+        if (_block != other._block)
+        {
+            release();
+            _block = other._block;
+            if (_block)
+            {
+                _block->_refs++;
+            }
+        }
 
-} // namespace tmpl
+        return *this;
+    }
 
-template <typename TKey, typename TMap>
-struct ObjectKeys
-{
-    typedef ObjectKeys<TKey, TMap> iterator;
-    typedef decltype(((TMap *)nullptr)->begin()) TIterator_map;
+    cow_ptr &operator=(cow_ptr &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            _block = other._block;
+            other._block = nullptr;
+        }
 
-    TIterator_map _index;
-    const TIterator_map _end;
+        return *this;
+    }
 
-    ObjectKeys(TMap &values_) : _index(values_.begin()), _end(values_.end())
+    inline T &read() const
     {
+        return _block->_value;
     }
 
-    iterator &begin()
+    // the only owner afterwards
+    inline T &write()
     {
-        return *this;
+        if (_block->_refs > 1)
+        {
+            auto copy = new block(_block->_value);
+            _block->_refs--;
+            _block = copy;
+        }
+
+        return _block->_value;
     }
 
-    iterator &end()
+    inline T *get() const
     {
-        return *this;
+        return &_block->_value;
     }
 
-    const TKey &operator*()
+    inline T &operator*() const
     {
-        return _index->first;
+        return _block->_value;
     }
 
-    bool operator!=(const iterator &rhs)
+    inline std::size_t use_count() const
     {
-        return _index != rhs._end;
+        return _block ? _block->_refs : 0;
     }
 
-    iterator &operator++()
+private:
+    void release()
     {
-        ++_index;
-        return *this;
+        if (_block && --_block->_refs == 0)
+        {
+            delete _block;
+        }
+
+        _block = nullptr;
     }
 };
 
 namespace tmpl
 {
 
-template <typename K, typename V>
-struct object
+template <typename E, typename G>
+struct array_pipeline;
+
+template <typename P, typename V>
+inline decltype(auto) invoke_callback(P &p, V &v, size_t index)
 {
-    struct K_hash
+    if constexpr (std::is_invocable_v<P &, V &, size_t>)
     {
-        typedef K argument_type;
-        typedef std::size_t result_type;
-        result_type operator()(argument_type const &value) const
-        {
-            return value.hash();
-        }
-    };
+        return p(v, index);
+    }
+    else if constexpr (std::is_invocable_v<P &, V &>)
+    {
+        return p(v);
+    }
+    else
+    {
+        return p();
+    }
+}
 
-    struct K_equal_to
+template <typename P, typename A, typename V>
+inline decltype(auto) invoke_reducer(P &p, A &accumulator, V &v, size_t index)
+{
+    if constexpr (std::is_invocable_v<P &, A &, V &, size_t>)
     {
-        typedef K argument_type;
-        bool operator()(argument_type const &value, argument_type const &other) const
-        {
-            return value == other;
-        }
-    };
+        return p(accumulator, v, index);
+    }
+    else
+    {
+        return p(accumulator, v);
+    }
+}
 
-    using object_type_base = std::unordered_map<K, V, K_hash, K_equal_to>;
-    //using object_type = object_type_base; // object_type_base - value type, std::shared_ptr<object_type_base> - reference type
-    using object_type = std::shared_ptr<object_type_base>; // object_type_base - value type, std::shared_ptr<object_type_base> - reference type
-    using object_type_ref = object_type_base &;
-    using pair = std::pair<const K, V>;
+// elements of an array: a dense vector, with a bitmap of the deleted elements inside it, plus a sparse index for
+// the elements past a large hole. Whole array operations work on the vector only, densify() moves the sparse part
+// back into it and turns the deleted elements into plain undefined ones
+template <typename E>
+struct array_storage : public std::vector<E>
+{
+    using base = std::vector<E>;
+    using sparse_values = std::map<size_t, E>;
+    using base::base;
+    using base::operator=;
 
-    template <typename _Ty> 
-    struct object_traits {
-        template<class... _Types>
-	    static _Ty create(_Types&&... _Args) {
-            return object_type_base(_Args...);
-        }
+    // a write leaving a hole up to this size (or up to the current size) fills it in instead
+    static constexpr size_t dense_gap = 1024;
 
-        static constexpr _Ty& access(std::remove_reference_t<_Ty>& _Arg)
-        {	
-            return (static_cast<_Ty&>(_Arg));
-        }
+    struct sparse_part
+    {
+        sparse_values values;
+        size_t length;
     };
 
-    template <>
-    struct object_traits<std::shared_ptr<object_type_base>> {
-        template<class... _Types>
-	    static inline auto create(_Types&&... _Args) {
-            return std::make_shared<object_type_base>(_Args...);
-        }        
+    std::unique_ptr<sparse_part> _sparse;
+    // deleted dense elements, empty when there are none; indices past its size are not deleted
+    std::vector<bool> _holes;
 
-        static inline object_type_ref access(object_type& _Arg)
-        {	
-            return (static_cast<object_type_ref>(*_Arg));
+    // the existing indices: the dense ones (deleted ones skipped), then the sparse ones in order
+    struct keys_iterator
+    {
+        size_t _key;
+        size_t _dense;
+        const std::vector<bool> *_holes;
+        const sparse_values *_values;
+        typename sparse_values::const_iterator _it;
+
+        keys_iterator(const array_storage &storage)
+            : _key(0), _dense(storage.size()), _holes(&storage._holes), _values(storage._sparse ? &storage._sparse->values : nullptr)
+        {
+            if (_values)
+            {
+                _it = _values->begin();
+            }
+
+            settle();
         }
-    };
 
+        // onto the first existing index at or after _key
+        void settle()
+        {
+            while (_key < _dense && _key < _holes->size() && (*_holes)[_key])
+            {
+                _key++;
+            }
 
-    bool isUndefined;
-    object_type _values;
+            if (_key >= _dense && _values && _it != _values->end())
+            {
+                _key = _it->first;
+            }
+        }
 
-    object();
+        keys_iterator &begin()
+        {
+            return *this;
+        }
 
-    object(const object &value);
+        keys_iterator &end()
+        {
+            return *this;
+        }
 
-    object(std::initializer_list<pair> values);
+        const size_t &operator*() const
+        {
+            return _key;
+        }
 
-    object(const undefined_t &);
+        bool operator!=(const keys_iterator &) const
+        {
+            return _key < _dense || (_values && _it != _values->end());
+        }
 
-    virtual ~object()
-    {
-    }
+        keys_iterator &operator++()
+        {
+            if (_key >= _dense)
+            {
+                if (++_it != _values->end())
+                {
+                    _key = _it->first;
+                }
+            }
+            else
+            {
+                _key++;
+                settle();
+            }
 
-    constexpr operator bool()
+            return *this;
+        }
+    };
+
+    array_storage() = default;
+
+    array_storage(const base &values) : base(values)
     {
-        return !isUndefined;
     }
 
-    constexpr object_type_ref get() const
+    array_storage(base &&values) : base(std::move(values))
     {
-        return object_traits<object_type>::access(mutable_(_values));
     }
 
-    constexpr object_type_ref get()
+    array_storage(const array_storage &other)
+        : base(other), _sparse(other._sparse ? std::make_unique<sparse_part>(*other._sparse) : nullptr), _holes(other._holes)
     {
-        return object_traits<object_type>::access(_values);
     }
 
-    static ObjectKeys<js::string, object_type_base> keys(const object &);
-
-    ObjectKeys<js::string, object_type_base> keys();
+    array_storage(array_storage &&other) = default;
 
-    constexpr object *operator->()
+    array_storage &operator=(const array_storage &other)
     {
-        return this;
+        base::operator=(other);
+        _sparse = other._sparse ? std::make_unique<sparse_part>(*other._sparse) : nullptr;
+        _holes = other._holes;
+        return *this;
     }
 
-    any &operator[](js::number n) const;
-
-    any &operator[](const char_t *s) const;
-
-    any &operator[](std::string s) const;
-
-    any &operator[](js::string s) const;
-
-    any &operator[](js::number n);
-
-    any &operator[](const char_t *s);
-
-    any &operator[](std::string s);
-
-    any &operator[](js::string s);
+    array_storage &operator=(array_storage &&other) = default;
 
-    any &operator[](undefined_t undef);
-
-    inline bool operator==(const object &other) const
+    static E hole()
     {
-        // TODO - finish it
-        return isUndefined == other.isUndefined && isUndefined == true;
+        if constexpr (std::is_same_v<decltype(E{undefined}), E>) {
+            return E{undefined};
+        } else {
+            return E{};
+        }
     }
 
-    void Delete(js::number field)
-    {
-        get().erase(field.operator std::string &());
-    }    
-
-    void Delete(js::string field)
+    size_t length() const
     {
-        get().erase(field.operator std::string &());
+        return _sparse ? _sparse->length : this->size();
     }
 
-    void Delete(js::any field)
+    bool is_hole(size_t index) const
     {
-        get().erase(field.operator std::string &());
+        return index < _holes.size() && _holes[index];
     }
 
-    void Delete(js::undefined_t)
+    // needs densify() before the vector is used as a whole
+    bool is_sparse() const
     {
-        get().erase("undefined");
-    }    
+        return _sparse || !_holes.empty();
+    }
 
-    void Delete(const char_t *field)
+    bool has(size_t index) const
     {
-        get().erase(field);
+        return index < this->size() ? !is_hole(index) : (_sparse && _sparse->values.find(index) != _sparse->values.end());
     }
 
-    template <typename N = void> requires ArithmeticOrEnum<N>
-    bool exists(N n) const
+    // nullptr for a hole or an index past the end
+    const E *find(size_t index) const
     {
-        return get().find(js::string(to_tstring(n))) != get().end();
+        if (index < this->size())
+        {
+            return is_hole(index) ? nullptr : this->data() + index;
+        }
+
+        if (_sparse)
+        {
+            auto it = _sparse->values.find(index);
+            if (it != _sparse->values.end())
+            {
+                return &it->second;
+            }
+        }
+
+        return nullptr;
     }
 
-    template <class T>
-    bool exists(T i) const
+    E &write(size_t index)
     {
-        if constexpr (is_stringish_v<T>)
+        auto size = this->size();
+        if (index < size)
         {
-            return get().find(i) != get().end();
+            if (is_hole(index))
+            {
+                _holes[index] = false;
+            }
+
+            return (*this)[index];
         }
 
-        return false;
+        if (!_sparse)
+        {
+            if (index - size > std::max(dense_gap, size))
+            {
+                _sparse = std::make_unique<sparse_part>(sparse_part{{}, size});
+            }
+            else
+            {
+                // one resize, however far past the end
+                JS_STAT(array_grows);
+                this->resize(index + 1, hole());
+                return (*this)[index];
+            }
+        }
+
+        _sparse->length = std::max(_sparse->length, index + 1);
+        if (index > size)
+        {
+            return _sparse->values[index];
+        }
+
+        // appended to the dense part, which takes over the sparse elements that follow it without a hole
+        this->push_back(hole());
+        auto &values = _sparse->values;
+        while (!values.empty() && values.begin()->first == this->size())
+        {
+            this->push_back(std::move(values.begin()->second));
+            values.erase(values.begin());
+        }
+
+        if (values.empty() && _sparse->length == this->size())
+        {
+            _sparse.reset();
+        }
+
+        return (*this)[index];
     }
 
-    virtual js::string toString()
+    // delete a[index]: the length stays, the element becomes a hole
+    void remove(size_t index)
     {
-        tostringstream streamObj2;
-        streamObj2 << *this;
-        return streamObj2.str();
+        auto size = this->size();
+        if (index >= size)
+        {
+            if (_sparse)
+            {
+                _sparse->values.erase(index);
+            }
+
+            return;
+        }
+
+        // the element stays in place as a hole, nothing after it moves
+        if (_holes.size() <= index)
+        {
+            _holes.resize(index + 1, false);
+        }
+
+        _holes[index] = true;
+        (*this)[index] = hole();
     }
 
-    friend tostream &operator<<(tostream &os, object val)
+    void densify()
     {
-        if (val.isUndefined)
+        _holes.clear();
+        if (!_sparse)
         {
-            return os << TXT("undefined");
+            return;
         }
 
-        return os << TXT("[object]");
+        auto sparse = std::move(_sparse);
+        JS_STAT(array_grows);
+        this->resize(sparse->length, hole());
+        for (auto &item : sparse->values)
+        {
+            (*this)[item.first] = std::move(item.second);
+        }
     }
 };
 
-} // namespace tmpl
+template <typename E>
+struct array
+{
+    using array_type_base = array_storage<E>;
+    //using array_type = array_type_base; // array_type_base - value type, std::shared_ptr<array_type_base> - reference type
+#ifdef JS_COW_STORAGE
+    using array_type = cow_ptr<array_type_base>; // cow_ptr<array_type_base> - value type, copied on write
+#else
+    using array_type = std::shared_ptr<array_type_base>; // array_type_base - value type, std::shared_ptr<array_type_base> - reference type
+#endif
+    using array_type_ref = array_type_base &;
 
-typedef tmpl::object<string, any> object;
+    // smallest number of elements worth handing to another thread
+    static constexpr size_t parallel_chunk = 1024;
 
-struct any
-{
-    struct any_hash
-    {
-        typedef js::any argument_type;
-        typedef std::size_t result_type;
-        result_type operator()(argument_type const &value) const
-        {
-            return value.hash();
+    template <typename _Ty> 
+    struct array_traits {
+        template<class... _Types>
+	    static _Ty create(_Types&&... _Args) {
+            return array_type_base(std::forward<_Types>(_Args)...);
         }
-    };
 
-    struct any_equal_to
-    {
-        typedef js::any argument_type;
-        bool operator()(argument_type const &value, argument_type const &other) const
-        {
-            return value == other;
+        static constexpr _Ty& access(std::remove_reference_t<_Ty>& _Arg)
+        {	
+            return (static_cast<_Ty&>(_Arg));
+        }
+
+        static constexpr _Ty& read(const std::remove_reference_t<_Ty>& _Arg)
+        {	
+            return (mutable_(_Arg));
         }
     };
 
-    enum anyTypeId
-    {
-        undefined_type = 0,
-        boolean_type,
-        pointer_type,
-        number_type,
-        string_type,
-        array_type,
-        object_type,
-        function_type,
-        class_type
+    template <>
+    struct array_traits<std::shared_ptr<array_type_base>> {
+        template<class... _Types>
+	    static inline auto create(_Types&&... _Args) {
+            return js::make<array_type_base>(std::forward<_Types>(_Args)...);
+        }        
+
+        static inline array_type_ref access(array_type& _Arg)
+        {	
+            return (static_cast<array_type_ref>(*_Arg));
+        }
+
+        static inline array_type_ref read(const array_type& _Arg)
+        {	
+            return (static_cast<array_type_ref>(*_Arg));
+        }
     };
 
-    using any_value_type = std::variant<
-        js::undefined_t,
-        js::boolean,
-        js::pointer_t,
-        js::number,
-        js::string,
-        js::array_any,
-        js::object,
-        std::shared_ptr<js::function>,
-        std::shared_ptr<js::object>>;
+    template <>
+    struct array_traits<cow_ptr<array_type_base>> {
+        template<class... _Types>
+	    static inline auto create(_Types&&... _Args) {
+            return cow_ptr<array_type_base>::make(std::forward<_Types>(_Args)...);
+        }        
 
-    any_value_type _value;
+        static inline array_type_ref access(array_type& _Arg)
+        {	
+            return _Arg.write();
+        }
 
-    any() : _value(undefined)
-    {
-    }
+        static inline array_type_ref read(const array_type& _Arg)
+        {	
+            return _Arg.read();
+        }
+    };
 
-    any(const any &other) : _value(other._value)
+    bool isUndefined;
+    array_type _values;
+
+    array() : _values(array_traits<array_type>::create()), isUndefined(false)
     {
     }
 
-    any(void_t) : _value(undefined)
+    array(const array &value) : _values(value._values), isUndefined(value.isUndefined)
     {
     }
 
-    any(undefined_t) : _value(undefined)
+    array(array &&value) : _values(std::move(value._values)), isUndefined(value.isUndefined)
     {
     }
 
-    any(pointer_t v) : _value(v)
+    array &operator=(const array &value) = default;
+
+    array &operator=(array &&value) = default;
+
+    array(std::initializer_list<E> values) : _values(array_traits<array_type>::create(values)), isUndefined(false)
     {
     }
 
-    any(bool value) : _value(js::boolean(value))
+    array(std::vector<E> values) : _values(array_traits<array_type>::create(std::move(values))), isUndefined(false)
     {
     }
 
-    template <typename N = void> requires ArithmeticOrEnum<N>
-    any(N value) : _value(js::number(value))
+    array(const undefined_t &undef) : _values(array_traits<array_type>::create()), isUndefined(true)
     {
     }
 
-    any(char_t value) : _value(js::string(value))
+    constexpr operator bool()
     {
+        return !isUndefined;
     }
 
-    any(js::boolean value) : _value(value)
+    constexpr array *operator->()
+    {
+        return this;
+    } 
+
+    // reading does not unshare copy-on-write storage, get() on a non-const array does.
+    // Both hand out the dense vector, a sparse array is filled up first
+    array_type_ref get() const
     {
+        auto &values = storage();
+        if (values.is_sparse())
+        {
+            values.densify();
+        }
+
+        return values;
     }
 
-    any(js::number value) : _value(value)
+    array_type_ref get()
     {
+        auto &values = storage();
+        if (values.is_sparse())
+        {
+            values.densify();
+        }
+
+        return values;
     }
 
-    any(const tstring &value) : _value(js::string(value))
+    // the storage as it is, sparse part included
+    constexpr array_type_ref storage() const
     {
+        return array_traits<array_type>::read(_values);
     }
 
-    any(const js::string &value) : _value(value)
+    constexpr array_type_ref storage()
     {
+        return array_traits<array_type>::access(_values);
     }
 
-    any(const js::array_any &value) : _value(value)
+    size_t get_length()
     {
+        return storage().length();
     }
 
-    any(const js::object &value) : _value(value)
+    // holes and reads past the end give undefined, an immutable value no write can reach
+    template <typename N = void> requires can_cast_to_size_t<N>
+    const E &operator[](N i) const
     {
+        auto &values = storage();
+        if (static_cast<size_t>(i) < values.size())
+        {
+            return values[static_cast<size_t>(i)];
+        }
+
+        if (auto found = values.find(static_cast<size_t>(i)))
+        {
+            return *found;
+        }
+
+        static const E hole = array_type_base::hole();
+        return hole;
     }
 
-    template <typename F, class = std::enable_if_t<std::is_member_function_pointer_v<typename _Deduction<F>::type>>>
-    any(const F &value) : _value(std::shared_ptr<js::function>(((js::function *)new js::function_t<F>(value))))
+    template <typename N = void> requires can_cast_to_size_t<N>
+    E &operator[](N i)
     {
+        auto &values = storage();
+        if (static_cast<size_t>(i) < values.size() && values._holes.empty())
+        {
+            return values[static_cast<size_t>(i)];
+        }
+
+        return values.write(static_cast<size_t>(i));
     }
 
-    template <typename Rx, typename... Args>
-    any(Rx(__cdecl *value)(Args...)) : _value(std::shared_ptr<js::function>((js::function *)new js::function_t<Rx(__cdecl *)(Args...), Rx(__cdecl *)(Args...)>(value)))
+    typename array_type_base::keys_iterator keys()
     {
+        return typename array_type_base::keys_iterator(storage());
     }
 
-    template <typename C>
-    any(std::shared_ptr<C> value) : _value(std::shared_ptr<js::object>(value))
+    template <typename N = void> requires can_cast_to_size_t<N>
+    void Delete(N n)
     {
+        storage().remove(static_cast<size_t>(n));
     }
 
-    constexpr any *operator->()
+    void push(const E &t)
     {
-        return this;
+        get().push_back(t);
     }
 
-    inline anyTypeId get_type() const
+    void push(E &&t)
     {
-        return static_cast<anyTypeId>(_value.index());
+        get().push_back(std::move(t));
     }
 
-    template <typename T>
-    inline const T &get() const
+    template <typename... Args>
+    void push(Args &&...args)
     {
-        return std::get<T>(_value);
+        auto &values = get();
+        (values.emplace_back(std::forward<Args>(args)), ...);
     }
 
-    template <typename T>
-    inline std::shared_ptr<T> get_ptr() const
+    E pop()
     {
-        return std::dynamic_pointer_cast<T>(mutable_(std::get<std::shared_ptr<js::object>>(_value)));
+        return get().pop_back();
     }
 
-    template <typename T>
-    inline T &get()
+    template <typename... Args>
+    void splice(size_t position, size_t size, Args... args)
     {
-        return std::get<T>(_value);
+        get().erase(get().cbegin() + position, get().cbegin() + position + size);
+        get().insert(get().cbegin() + position, {args...});
     }
 
-    template <typename T>
-    inline std::shared_ptr<T> get_ptr()
+    array slice(size_t first, size_t last)
     {
-        return std::dynamic_pointer_cast<T>(std::get<std::shared_ptr<js::object>>(_value));
+        return array(std::vector<E>(get().cbegin() + first, get().cbegin() + last + 1));
     }
 
-    inline const js::boolean &boolean_ref_const() const
+    js::number indexOf(const E &e)
     {
-        return get<js::boolean>();
+        return get().cend() - std::find(get().cbegin(), get().cend(), e) - 1;
     }
 
-    inline js::boolean &boolean_ref()
+    js::boolean removeElement(const E &e)
     {
-        return get<js::boolean>();
+        return get().erase(std::find(get().cbegin(), get().cend(), e)) != get().cend();
     }
 
-    inline const js::number &number_ref_const() const
+    auto begin()
     {
-        return get<js::number>();
+        return get().begin();
     }
 
-    inline js::number &number_ref()
+    auto end()
     {
-        return get<js::number>();
+        return get().end();
     }
 
-    inline const js::string &string_ref_const() const
+    friend std::ostream &operator<<(std::ostream &os, array val)
     {
-        return get<js::string>();
+        if (val.isUndefined)
+        {
+            return os << "undefined";
+        }
+
+        return os << "[array]";
     }
 
-    inline js::string &string_ref()
+    template <typename N = void> requires can_cast_to_size_t<N>
+    bool exists(N n) const
     {
-        return get<js::string>();
+        return storage().has(static_cast<size_t>(n));
     }
 
-    inline std::shared_ptr<function> function_ptr()
+    template <class T>
+    bool exists(T) const
     {
-        return get<std::shared_ptr<function>>();
+        return false;
     }
 
-    inline const array_any &array_ref_const() const
+    template <typename P>
+    array filter(P p)
     {
-        return get<array_any>();
+        return lazy().filter(std::move(p)).toArray();
     }
 
-    inline array_any &array_ref()
+    template <typename F>
+    auto map(F p)
     {
-        return get<array_any>();
+        return lazy().map(std::move(p)).toArray();
     }
 
-    inline const object &object_ref_const() const
+    // left to right, without an initial value the first element is the seed
+    template <typename P>
+    auto reduce(P p)
     {
-        return get<object>();
+        return lazy().reduce(p);
     }
 
-    inline object &object_ref()
+    template <typename P, typename I>
+    auto reduce(P p, I initial)
     {
-        return get<object>();
+        return lazy().reduce(p, initial);
     }
 
-    inline const std::shared_ptr<js::object> &class_ref_const() const
+    template <typename P>
+    boolean every(P p)
     {
-        return get<std::shared_ptr<js::object>>();
+        return lazy().every(p);
     }
 
-    inline std::shared_ptr<js::object> &class_ref()
+    template <typename P>
+    boolean some(P p)
     {
-        return get<std::shared_ptr<js::object>>();
+        return lazy().some(p);
     }
 
-    any &operator=(const any &other)
+    js::string join(js::string s)
     {
-        _value = other._value;
-        return *this;
+        return std::accumulate(get().begin(), get().end(), js::string{}, [&](auto &res, auto &piece) {
+            return res += (res) ? s + piece : piece;
+        });
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any &operator=(N other)
+    template <typename P>
+    void forEach(P p)
     {
-        _value = js::number(other);
-        return *this;
+        lazy().forEach(p);
     }
 
-    template <class T>
-    any &operator[](T t) const
+    // parallel variants run the callback on chunks of the array in the shared thread pool, results keep the
+    // order of the elements. The callback must not depend on the order of the calls
+    template <typename F>
+    auto parallelMap(F p)
     {
-        if constexpr (std::is_same_v<T, js::number>)
-        {
-            if (get_type() == anyTypeId::array_type)
-            {
-                return mutable_(array_ref())[t];
-            }
-        }
+        using R = std::decay_t<decltype(invoke_callback(p, std::declval<E &>(), size_t()))>;
+        // bool results go to js::boolean: the bits of a std::vector<bool> share words, so chunks would race
+        using T = std::conditional_t<std::is_void_v<R>, undefined_t, std::conditional_t<std::is_same_v<R, bool>, js::boolean, R>>;
 
-        if constexpr (is_stringish_v<T>)
-        {
-            if (get_type() == anyTypeId::object_type)
+        auto &values = get();
+        std::vector<T> result(values.size());
+        utils::thread_pool::shared().for_chunks(values.size(), parallel_chunk, [&](size_t first, size_t last) {
+            for (auto index = first; index < last; index++)
             {
-                return (object_ref())[t];
+                if constexpr (std::is_void_v<R>)
+                {
+                    invoke_callback(p, values[index], index);
+                }
+                else
+                {
+                    result[index] = invoke_callback(p, values[index], index);
+                }
             }
-        }
+        });
 
-        throw "wrong type";
+        return array<T>(result);
     }
 
-    template <class T>
-    any &operator[](T t)
+    template <typename P>
+    array parallelFilter(P p)
     {
-        if constexpr (std::is_same_v<T, js::number>)
-        {
-            if (get_type() == anyTypeId::array_type)
+        auto &values = get();
+        std::vector<char> keep(values.size());
+        utils::thread_pool::shared().for_chunks(values.size(), parallel_chunk, [&](size_t first, size_t last) {
+            for (auto index = first; index < last; index++)
             {
-                return (array_ref())[t];
+                keep[index] = static_cast<bool>(invoke_callback(p, values[index], index));
             }
-        }
+        });
 
-        if constexpr (is_stringish_v<T>)
+        std::vector<E> result;
+        for (size_t index = 0; index < values.size(); index++)
         {
-            if (get_type() == anyTypeId::object_type)
+            if (keep[index])
             {
-                return (object_ref())[t];
+                result.push_back(values[index]);
             }
         }
 
-        throw "wrong type";
+        return array(result);
     }
 
-    operator js::pointer_t()
+    template <typename P>
+    void parallelForEach(P p)
     {
-        if (get_type() == anyTypeId::string_type && string_ref().is_null())
-        {
-            return null;
-        }
+        auto &values = get();
+        utils::thread_pool::shared().for_chunks(values.size(), parallel_chunk, [&](size_t first, size_t last) {
+            for (auto index = first; index < last; index++)
+            {
+                invoke_callback(p, values[index], index);
+            }
+        });
+    }
 
-        if (get_type() == anyTypeId::number_type)
-        {
-            return pointer_t(number_ref());
-        }
+    // p must be associative: every chunk is reduced on its own and the partial results are combined left to right.
+    // Each chunk starts from its first element, so p has to reduce elements to the element type
+    template <typename P, typename I>
+    auto parallelReduce(P p, I initial)
+    {
+        using R = std::decay_t<decltype(invoke_reducer(p, std::declval<I &>(), std::declval<E &>(), size_t()))>;
+        static_assert(std::is_same_v<R, E>, "parallelReduce: the callback must return the element type");
 
-        if (get_type() == anyTypeId::class_type)
+        auto &values = get();
+        std::mutex mutex;
+        std::vector<std::pair<size_t, R>> partials;
+        utils::thread_pool::shared().for_chunks(values.size(), parallel_chunk, [&](size_t first, size_t last) {
+            R accumulator = values[first];
+            for (auto index = first + 1; index < last; index++)
+            {
+                accumulator = invoke_reducer(p, accumulator, values[index], index);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            partials.emplace_back(first, accumulator);
+        });
+
+        std::sort(partials.begin(), partials.end(), [](auto &left, auto &right) { return left.first < right.first; });
+
+        R accumulator = initial;
+        for (auto &partial : partials)
         {
-            return pointer_t(class_ref().get());
+            accumulator = invoke_reducer(p, accumulator, partial.second, partial.first);
         }
 
-        return pointer_t(0xffffffff);
+        return accumulator;
     }
 
-    operator js::boolean()
+    template <typename P>
+    boolean parallelEvery(P p)
     {
-        if (get_type() == anyTypeId::boolean_type)
-        {
-            return boolean_ref();
-        }
+        auto &values = get();
+        std::atomic<bool> result{true};
+        utils::thread_pool::shared().for_chunks(values.size(), parallel_chunk, [&](size_t first, size_t last) {
+            for (auto index = first; index < last && result; index++)
+            {
+                if (!static_cast<bool>(invoke_callback(p, values[index], index)))
+                {
+                    result = false;
+                }
+            }
+        });
 
-        throw "wrong type";
+        return result.load();
     }
 
-    operator js::number()
+    template <typename P>
+    boolean parallelSome(P p)
     {
-        if (get_type() == anyTypeId::number_type)
-        {
-            return number_ref();
-        }
-
-        if (get_type() == anyTypeId::string_type)
-        {
-            char_t* end;
-            #ifdef UNICODE
-            return js::number(std::wcstof(string_ref().operator const char_t *(), &end));
-            #else
-            return js::number(std::strtof(string_ref().operator const char_t *(), &end));
-            #endif
-        }
+        auto &values = get();
+        std::atomic<bool> result{false};
+        utils::thread_pool::shared().for_chunks(values.size(), parallel_chunk, [&](size_t first, size_t last) {
+            for (auto index = first; index < last && !result; index++)
+            {
+                if (static_cast<bool>(invoke_callback(p, values[index], index)))
+                {
+                    result = true;
+                }
+            }
+        });
 
-        throw "wrong type";
+        return result.load();
     }
 
-    operator js::string()
+    // start of a fused filter/map/reduce chain, see array_pipeline
+    auto lazy() const
     {
-        /*
-            // String
-            template <typename T>
-            string<T>::string(any val) : _value(val != null ? val.operator std::string() : string_empty._value), _control(val != null ? string_defined : string_null)
+        // a sparse array is filled in once here, the chain reads the storage itself
+        get();
+        auto generate = [values = _values](auto &&sink) {
+            for (auto &v : array_traits<array_type>::read(values))
             {
-            }    
-        */
-
-        if (get_type() == anyTypeId::undefined_type)
-        {
-            return js::string();
-        }
+                if (!sink(v))
+                {
+                    break;
+                }
+            }
+        };
 
-        if (get_type() == anyTypeId::string_type)
-        {
-            return string_ref();
-        }
+        return array_pipeline<E, decltype(generate)>(generate);
+    }
+};
 
-        if (get_type() == anyTypeId::number_type)
-        {
-            return js::string(number_ref().operator tstring());
-        }
+// lazy chain of filter/map stages over an array: elements go through all stages one by one and nothing is
+// stored until the chain ends in toArray(). _generate(sink) calls sink(element) in order until sink returns false
+template <typename E, typename G>
+struct array_pipeline
+{
+    G _generate;
 
-        if (get_type() == anyTypeId::pointer_type)
-        {
-            return js::string(get<js::pointer_t>());
-        }        
+    array_pipeline(G generate) : _generate(std::move(generate))
+    {
+    }
 
-        throw "wrong type";
+    constexpr array_pipeline *operator->()
+    {
+        return this;
     }
 
-    operator js::object()
+    template <typename P>
+    auto filter(P p)
     {
-        if (get_type() == anyTypeId::object_type)
-        {
-            return object_ref();
-        }
+        auto generate = [source = _generate, p = std::move(p)](auto &&sink) mutable {
+            size_t index = 0;
+            source([&](E &v) {
+                return static_cast<bool>(invoke_callback(p, v, index++)) ? sink(v) : true;
+            });
+        };
 
-        throw "wrong type";
+        return array_pipeline<E, decltype(generate)>(generate);
     }
 
-    operator js::array_any()
-    {
-        if (get_type() == anyTypeId::array_type)
-        {
-            return array_ref();
-        }
+    template <typename P>
+    auto map(P p)
+    {
+        using R = std::decay_t<decltype(invoke_callback(p, std::declval<E &>(), size_t()))>;
+        using T = std::conditional_t<std::is_void_v<R>, undefined_t, R>;
+
+        auto generate = [source = _generate, p = std::move(p)](auto &&sink) mutable {
+            size_t index = 0;
+            source([&](E &v) {
+                if constexpr (std::is_void_v<R>)
+                {
+                    invoke_callback(p, v, index++);
+                    T result = undefined;
+                    return sink(result);
+                }
+                else
+                {
+                    T result = invoke_callback(p, v, index++);
+                    return sink(result);
+                }
+            });
+        };
 
-        throw "wrong type";
+        return array_pipeline<T, decltype(generate)>(generate);
     }
 
-    operator bool()
+    template <typename P>
+    void forEach(P p)
     {
-        switch (get_type())
-        {
-        case anyTypeId::undefined_type:
-            return false;
-        case anyTypeId::boolean_type:
-            return boolean_ref();
-        case anyTypeId::number_type:
-            return number_ref();
-        case anyTypeId::string_type:
-            return string_ref()._value.length() > 0;
-        case anyTypeId::object_type:
-            return object_ref()->get().size() > 0;
-        case anyTypeId::array_type:
-            return array_ref()->get().size() > 0;
-        case anyTypeId::pointer_type:
-            return get<pointer_t>();
-        case anyTypeId::class_type:
+        size_t index = 0;
+        _generate([&](E &v) {
+            invoke_callback(p, v, index++);
             return true;
-        default:
-            break;
-        }
-
-        return false;
+        });
     }
 
-    template <typename N = void> requires ArithmeticOrEnum<N>
-    operator N()
+    template <typename P>
+    auto reduce(P p)
     {
-        switch (get_type())
+        using R = std::decay_t<decltype(invoke_reducer(p, std::declval<E &>(), std::declval<E &>(), size_t()))>;
+
+        std::optional<R> accumulator;
+        size_t index = 0;
+        _generate([&](E &v) {
+            if (!accumulator)
+            {
+                accumulator.emplace(v);
+            }
+            else
+            {
+                accumulator.emplace(invoke_reducer(p, *accumulator, v, index));
+            }
+
+            index++;
+            return true;
+        });
+
+        if (!accumulator)
         {
-        case anyTypeId::undefined_type:
-            return 0;
-        case anyTypeId::boolean_type:
-            return boolean_ref() ? 1 : 0;
-        case anyTypeId::number_type:
-            return number_ref();
-        case anyTypeId::string_type:
-            char_t* end;
-            #ifdef UNICODE
-            return static_cast<N>(std::wcstof(string_ref().operator const char_t *(), &end));
-            #else
-            return static_cast<N>(std::strtof(string_ref().operator const char_t *(), &end));
-            #endif
+            throw "reduce of empty array with no initial value";
         }
 
-        throw "wrong type";
+        return *accumulator;
     }
 
-    template <typename T>
-    operator std::shared_ptr<T>()
+    template <typename P, typename I>
+    auto reduce(P p, I initial)
     {
-        if (get_type() == anyTypeId::class_type)
-        {
-            return std::dynamic_pointer_cast<T>(std::get<std::shared_ptr<js::object>>(_value));
-        }
+        using R = std::decay_t<decltype(invoke_reducer(p, std::declval<I &>(), std::declval<E &>(), size_t()))>;
 
-        throw "wrong type";
+        R accumulator = initial;
+        size_t index = 0;
+        _generate([&](E &v) {
+            accumulator = invoke_reducer(p, accumulator, v, index++);
+            return true;
+        });
+
+        return accumulator;
     }
 
-    template <typename Rx, typename... Args>
-    operator std::function<Rx(Args...)>()
+    template <typename P>
+    boolean every(P p)
     {
-        if (get_type() == anyTypeId::function_type)
-        {
-            auto func = function_ptr();
-            return std::function<Rx(Args...)>([=](Args... args) -> Rx {
-                return func->invoke({args...});
-            });
-        }
+        auto result = true;
+        size_t index = 0;
+        _generate([&](E &v) {
+            return result = static_cast<bool>(invoke_callback(p, v, index++));
+        });
 
-        throw "wrong type";
+        return result;
     }
 
-    operator tstring()
+    template <typename P>
+    boolean some(P p)
     {
-        tostringstream streamObj2;
-        streamObj2 << *this;
-        return streamObj2.str();
+        auto result = false;
+        size_t index = 0;
+        _generate([&](E &v) {
+            result = static_cast<bool>(invoke_callback(p, v, index++));
+            return !result;
+        });
+
+        return result;
     }
 
-    bool operator==(const js::any &other) const
+    array<E> toArray()
     {
-        if (get_type() != other.get_type())
-        {
-            return false;
-        }
-
-        switch (get_type())
-        {
-        case anyTypeId::undefined_type:
+        std::vector<E> result;
+        _generate([&](E &v) {
+            result.push_back(v);
             return true;
-        case anyTypeId::boolean_type:
-            return boolean_ref_const() == mutable_(other).boolean_ref_const();
-        case anyTypeId::number_type:
-            return number_ref_const() == mutable_(other).number_ref_const();
-        case anyTypeId::string_type:
-            return string_ref_const() == mutable_(other).string_ref_const();
-        case anyTypeId::object_type:
-            return object_ref_const() == mutable_(other).object_ref_const();
-        }
+        });
 
-        throw "not implemented";
+        return array<E>(result);
     }
+};
 
-    bool operator!=(const js::any &other) const
-    {
-        return !(*this == other);
-    }
+} // namespace tmpl
 
-    bool operator==(const js::undefined_t &) const
-    {
-        return get_type() == anyTypeId::undefined_type;
-    }
+template <typename TKey, typename TMap>
+struct ObjectKeys
+{
+    typedef ObjectKeys<TKey, TMap> iterator;
+    typedef decltype(((TMap *)nullptr)->begin()) TIterator_map;
 
-    bool operator!=(const js::undefined_t &) const
+    TIterator_map _index;
+    const TIterator_map _end;
+
+    ObjectKeys(TMap &values_) : _index(values_.begin()), _end(values_.end())
     {
-        return get_type() != anyTypeId::undefined_type;
     }
 
-    bool operator==(const pointer_t &other) const
+    iterator &begin()
     {
-        switch (get_type())
-        {
-        case anyTypeId::undefined_type:
-        case anyTypeId::boolean_type:
-        case anyTypeId::number_type:
-            return false;
-        case anyTypeId::string_type:
-            return string_ref_const().is_null() && other._ptr == nullptr;
-        case anyTypeId::object_type:
-        case anyTypeId::class_type:
-        case anyTypeId::pointer_type:
-            return get<pointer_t>()._ptr == other._ptr;
-        }
-
-        throw "not implemented";
+        return *this;
     }
 
-    bool operator!=(const pointer_t &other) const
+    iterator &end()
     {
-        return !operator==(other);
+        return *this;
     }
 
-    bool operator==(const js::boolean &other) const
+    const TKey &operator*()
     {
-        return static_cast<js::boolean>(*mutable_(this)) == other;
+        return _index->first;
     }
 
-    bool operator!=(const js::boolean &other) const
+    bool operator!=(const iterator &rhs)
     {
-        return static_cast<js::boolean>(*mutable_(this)) != other;
+        return _index != rhs._end;
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    bool operator==(const N &n) const
+    iterator &operator++()
     {
-        return static_cast<js::number>(*mutable_(this)) == n;
+        ++_index;
+        return *this;
     }
+};
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend bool operator==(const N &n, const any& val)
+// per call site cache for constant key property access, see PROP
+struct property_cache
+{
+    // shape id in the high half, slot in the low half, 0 when empty
+    std::atomic<std::uint64_t> _entry{0};
+};
+
+struct property_key
+{
+    const js::string &name;
+    property_cache &cache;
+
+    property_key(const js::string &name_, property_cache &cache_) : name(name_), cache(cache_)
     {
-        return n == static_cast<js::number>(mutable_(val));
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    bool operator!=(const N &n) const
+    operator const js::string &() const
     {
-        return static_cast<js::number>(*mutable_(this)) != n;
+        return name;
     }
+};
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend bool operator!=(const N &n, const any& val)
+#define PROP(quote) js::property_key(STR(quote), []() -> js::property_cache & { static js::property_cache cache; return cache; }())
+
+namespace tmpl
+{
+
+// hidden class: the keys of an object in insertion order, shared by every object that got the same keys in
+// the same order. Shapes are never freed, the transition tree from the root keeps them all alive; only constant
+// keys (literals, PROP) add transitions, so the tree is bounded by the program text.
+template <typename K, typename K_hash, typename K_equal_to>
+struct object_shape
+{
+    using shape_type = object_shape<K, K_hash, K_equal_to>;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t linear_search_keys = 8;
+
+    std::uint32_t _id;
+    std::vector<K> _keys;
+    std::unordered_map<K, size_t, K_hash, K_equal_to> _slots;
+    std::unordered_map<K, std::shared_ptr<shape_type>, K_hash, K_equal_to> _transitions;
+    std::mutex _transitions_mutex;
+
+    object_shape() : _id(next_id())
     {
-        return n != static_cast<js::number>(mutable_(val));
     }
 
-    bool operator==(const js::string &other) const
+    static std::uint32_t next_id()
     {
-        return static_cast<js::string>(*mutable_(this)) == other;
+        static std::atomic<std::uint32_t> id{0};
+        return ++id;
     }
 
-    bool operator!=(const js::string &other) const
+    static const std::shared_ptr<shape_type> &root()
     {
-        return static_cast<js::string>(*mutable_(this)) != other;
+        static auto empty = std::make_shared<shape_type>();
+        return empty;
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any operator+(N n)
+    size_t find(const K &key) const
     {
-        switch (get_type())
+        if (_keys.size() <= linear_search_keys)
         {
-        case anyTypeId::number_type:
-            return number_ref() + n;
+            for (size_t i = 0; i < _keys.size(); i++)
+            {
+                if (K_equal_to{}(_keys[i], key))
+                {
+                    return i;
+                }
+            }
+
+            return npos;
         }
 
-        throw "not implemented";
+        auto it = _slots.find(key);
+        return it != _slots.end() ? it->second : npos;
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend N operator+(N n, const any& val)
+    std::shared_ptr<shape_type> add(const K &key)
     {
-        switch (val.get_type())
+        std::lock_guard<std::mutex> lock(_transitions_mutex);
+        auto &next = _transitions[key];
+        if (!next)
         {
-        case anyTypeId::number_type:
-            return n + mutable_(val).number_ref();
+            next = std::make_shared<shape_type>();
+            next->_keys.reserve(_keys.size() + 1);
+            next->_keys = _keys;
+            next->_keys.push_back(key);
+            if (next->_keys.size() > linear_search_keys)
+            {
+                for (size_t i = 0; i < next->_keys.size(); i++)
+                {
+                    next->_slots[next->_keys[i]] = i;
+                }
+            }
         }
 
-        throw "not implemented";
+        return next;
     }
+};
+
+// object storage: values in a slot vector laid out by a shared shape, or indexed by a hash map of their own
+// ("dictionary mode") once a key was deleted or there are too many keys. Both modes keep the slots in insertion
+// order, so iteration follows JS property order. Looks like the std::unordered_map it replaces.
+template <typename K, typename V, typename K_hash, typename K_equal_to>
+struct object_storage
+{
+    using shape_type = object_shape<K, K_hash, K_equal_to>;
+    using pair = std::pair<const K, V>;
 
-    any operator+(string s)
+    static constexpr size_t max_shape_keys = 64;
+    static constexpr size_t npos = shape_type::npos;
+
+    // keys parallel to the slots; an erased slot stays as a hole until holes are the majority
+    struct dictionary_type
     {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            return number_ref().operator js::string() + s;
-        case anyTypeId::string_type:
-            return any(string_ref() + s);
-        }
+        std::unordered_map<K, size_t, K_hash, K_equal_to> _index;
+        std::vector<K> _keys;
+        std::vector<bool> _erased;
+        size_t _holes = 0;
+    };
 
-        throw "not implemented";
-    }
+    std::shared_ptr<shape_type> _shape;
+    std::vector<V> _slots;
+    std::unique_ptr<dictionary_type> _dictionary;
 
-    inline any operator+(any t) const
+    struct entry
     {
-        return mutable_(this)->operator+(t);
-    }
+        const K &first;
+        V &second;
+    };
 
-    any operator+(any t)
+    struct iterator
     {
-        switch (get_type())
+        struct arrow
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
-            {
-            case anyTypeId::number_type:
-                return number_ref() + t.number_ref();
-            case anyTypeId::string_type:
-                return number_ref().operator js::string() + t.string_ref();
-            }
-            break;
-        case anyTypeId::string_type:
-            switch (t.get_type())
+            entry _entry;
+
+            entry *operator->()
             {
-            case anyTypeId::string_type:
-                return string_ref() + t.string_ref();
+                return &_entry;
             }
-            break;
+        };
+
+        object_storage *_storage;
+        size_t _index;
+
+        entry operator*() const
+        {
+            return entry{_storage->key_at(_index), _storage->_slots[_index]};
         }
 
-        throw "not implemented";
-    }
+        arrow operator->() const
+        {
+            return arrow{**this};
+        }
 
-    any &operator++()
-    {
-        switch (get_type())
+        iterator &operator++()
         {
-        case anyTypeId::number_type:
-            number_ref()++;
+            _index = _storage->next_slot(_index + 1);
             return *this;
         }
 
-        throw "not implemented";
-    }
+        bool operator==(const iterator &other) const
+        {
+            return _index == other._index;
+        }
 
-    any operator++(int)
-    {
-        switch (get_type())
+        bool operator!=(const iterator &other) const
         {
-        case anyTypeId::number_type:
-            any tmp(number_ref());
-            operator++();
-            return tmp;
+            return !(*this == other);
         }
+    };
 
-        throw "not implemented";
+    object_storage() : _shape(shape_type::root())
+    {
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any &operator+=(N n)
+    object_storage(std::initializer_list<pair> values) : _shape(shape_type::root())
     {
-        switch (get_type())
+        reserve(values.size());
+        for (auto &item : values)
         {
-        case anyTypeId::number_type:
-            number_ref() += n;
-            return *this;
+            (*this)[item.first] = item.second;
         }
+    }
 
-        throw "not implemented";
+    object_storage(const object_storage &other)
+        : _shape(other._shape), _slots(other._slots), _dictionary(other._dictionary ? std::make_unique<dictionary_type>(*other._dictionary) : nullptr)
+    {
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend N operator+=(N &n, any value)
+    object_storage &operator=(const object_storage &other)
     {
-        switch (value.get_type())
-        {
-        case anyTypeId::number_type:
-            return n += value.number_ref();
-        }
+        _shape = other._shape;
+        _slots = other._slots;
+        _dictionary = other._dictionary ? std::make_unique<dictionary_type>(*other._dictionary) : nullptr;
+        return *this;
+    }
 
-        throw "not implemented";
+    size_t size() const
+    {
+        return _dictionary ? _dictionary->_index.size() : _slots.size();
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any operator-(N n)
+    // room for count keys; more than a shape holds goes straight to dictionary mode
+    void reserve(size_t count)
     {
-        switch (get_type())
+        if (!_dictionary && count > max_shape_keys)
         {
-        case anyTypeId::number_type:
-            return number_ref() - n;
+            to_dictionary();
         }
 
-        throw "not implemented";
-    }
-
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend N operator-(N n, const any& val)
-    {
-        switch (val.get_type())
+        if (_dictionary)
         {
-        case anyTypeId::number_type:
-            return n - mutable_(val).number_ref();
+            _dictionary->_index.reserve(count);
+            _dictionary->_keys.reserve(count);
+            _dictionary->_erased.reserve(count);
         }
 
-        throw "not implemented";
-    }    
+        _slots.reserve(count);
+    }
 
-    any operator-(any t)
+    const K &key_at(size_t slot) const
     {
-        switch (get_type())
+        return _dictionary ? _dictionary->_keys[slot] : _shape->_keys[slot];
+    }
+
+    // first live slot at or after slot
+    size_t next_slot(size_t slot) const
+    {
+        if (_dictionary && _dictionary->_holes)
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
+            while (slot < _slots.size() && _dictionary->_erased[slot])
             {
-            case anyTypeId::number_type:
-                return number_ref() - t.number_ref();
+                slot++;
             }
-            break;
         }
 
-        throw "not implemented";
+        return slot;
     }
 
-    any &operator--()
+    iterator begin()
     {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            number_ref() -= 1;
-            return *this;
-        }
-
-        throw "not implemented";
+        return iterator{this, next_slot(0)};
     }
 
-    any operator--(int)
+    iterator end()
     {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            any tmp(number_ref());
-            operator--();
-            return tmp;
-        }
-
-        throw "not implemented";
+        return iterator{this, _slots.size()};
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any &operator-=(N n)
+    iterator begin() const
     {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            number_ref() -= n;
-            return *this;
-        }
+        return mutable_(this)->begin();
+    }
 
-        throw "not implemented";
+    iterator end() const
+    {
+        return mutable_(this)->end();
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend N operator-=(N &n, any value)
+    size_t slot_of(const K &key) const
     {
-        switch (value.get_type())
+        if (_dictionary)
         {
-        case anyTypeId::number_type:
-            return n -= value.number_ref();
+            auto it = _dictionary->_index.find(key);
+            return it != _dictionary->_index.end() ? it->second : npos;
         }
 
-        throw "not implemented";
+        return _shape->find(key);
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any operator*(N n)
+    iterator find(const K &key)
     {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            return any(number_ref() * n);
-        }
+        JS_STAT(object_lookups);
+        auto slot = slot_of(key);
+        return slot == npos ? end() : iterator{this, slot};
+    }
 
-        throw "not implemented";
+    iterator find(const K &key) const
+    {
+        return mutable_(this)->find(key);
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend N operator*(N n, const any& val)
+    // reads never add a key: a missing one gives undefined, and storage shared by copies stays untouched
+    const V &read(const K &key) const
     {
-        switch (val.get_type())
+        JS_STAT(object_lookups);
+        auto slot = slot_of(key);
+        if (slot == npos)
         {
-        case anyTypeId::number_type:
-            return n * mutable_(val).number_ref();
+            static const V missing;
+            return missing;
         }
 
-        throw "not implemented";
-    }    
+        return _slots[slot];
+    }
 
-    any operator*(any t)
+    const V &read(const K &key, property_cache &cache) const
     {
-        switch (get_type())
+        if (!_dictionary)
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
+            auto entry = cache._entry.load(std::memory_order_relaxed);
+            if (static_cast<std::uint32_t>(entry >> 32) == _shape->_id)
             {
-            case anyTypeId::number_type:
-                return any(number_ref() * t.number_ref());
+                JS_STAT(object_lookups);
+                return _slots[static_cast<std::uint32_t>(entry)];
             }
-            break;
         }
 
-        throw "not implemented";
+        return read(key);
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any &operator*=(N n)
+    V &operator[](const K &key)
     {
-        switch (get_type())
+        JS_STAT(object_lookups);
+        if (_dictionary)
         {
-        case anyTypeId::number_type:
-            number_ref() *= n;
-            return *this;
+            return dictionary_at(key);
         }
 
-        throw "not implemented";
-    }
-
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any operator/(N n)
-    {
-        switch (get_type())
+        auto slot = _shape->find(key);
+        if (slot != npos)
         {
-        case anyTypeId::number_type:
-            return any(number_ref() / n);
+            return _slots[slot];
         }
 
-        throw "not implemented";
-    }
-
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend N operator/(N n, const any& val)
-    {
-        switch (val.get_type())
+        if (_slots.size() >= max_shape_keys)
         {
-        case anyTypeId::number_type:
-            return n / mutable_(val).number_ref();
+            to_dictionary();
+            return dictionary_at(key);
         }
 
-        throw "not implemented";
+        _shape = _shape->add(key);
+        _slots.emplace_back();
+        return _slots.back();
     }
 
-    any operator/(any t)
+    // access by a key computed at run time: a new key moves the object to dictionary mode instead of growing
+    // the transition tree
+    V &dynamic_at(const K &key)
     {
-        switch (get_type())
+        if (!_dictionary)
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
+            JS_STAT(object_lookups);
+            auto slot = _shape->find(key);
+            if (slot != npos)
             {
-            case anyTypeId::number_type:
-                return any(number_ref() / t.number_ref());
+                return _slots[slot];
             }
-            break;
+
+            to_dictionary();
         }
 
-        throw "not implemented";
+        return dictionary_at(key);
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any &operator/=(N n)
+    // constant key access through a per call site cache: one compare when the shape matches
+    V &at(const K &key, property_cache &cache)
     {
-        switch (get_type())
+        if (!_dictionary)
         {
-        case anyTypeId::number_type:
-            number_ref() /= n;
-            return *this;
+            auto entry = cache._entry.load(std::memory_order_relaxed);
+            if (static_cast<std::uint32_t>(entry >> 32) == _shape->_id)
+            {
+                JS_STAT(object_lookups);
+                return _slots[static_cast<std::uint32_t>(entry)];
+            }
         }
 
-        throw "not implemented";
-    }
-
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any operator%(N n)
-    {
-        switch (get_type())
+        auto &value = (*this)[key];
+        if (!_dictionary)
         {
-        case anyTypeId::number_type:
-            return any(number_ref() % n);
+            auto slot = static_cast<std::uint64_t>(&value - _slots.data());
+            cache._entry.store((static_cast<std::uint64_t>(_shape->_id) << 32) | slot, std::memory_order_relaxed);
         }
 
-        throw "not implemented";
+        return value;
     }
 
-    any operator%(any t)
+    size_t erase(const K &key)
     {
-        switch (get_type())
+        if (!_dictionary)
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
+            if (_shape->find(key) == npos)
             {
-            case anyTypeId::number_type:
-                return any(number_ref() % t.number_ref());
+                return 0;
             }
-            break;
-        }
 
-        throw "not implemented";
-    }
+            to_dictionary();
+        }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    friend any operator%(N n, any value)
-    {
-        switch (value.get_type())
+        auto &dictionary = *_dictionary;
+        auto it = dictionary._index.find(key);
+        if (it == dictionary._index.end())
         {
-        case anyTypeId::number_type:
-            return any(n % value.number_ref());
+            return 0;
         }
 
-        throw "not implemented";
-    }
-
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    any &operator%=(N other)
-    {
-        switch (get_type())
+        auto slot = it->second;
+        dictionary._index.erase(it);
+        dictionary._erased[slot] = true;
+        _slots[slot] = V();
+        if (++dictionary._holes > dictionary._index.size())
         {
-        case anyTypeId::number_type:
-            number_ref() %= other;
-            return *this;
+            compact();
         }
 
-        throw "not implemented";
+        return 1;
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    bool operator>(N n)
+    V &dictionary_at(const K &key)
     {
-        switch (get_type())
+        auto &dictionary = *_dictionary;
+#ifdef JS_STATS
+        auto buckets = dictionary._index.bucket_count();
+#endif
+        auto inserted = dictionary._index.try_emplace(key, _slots.size());
+#ifdef JS_STATS
+        if (dictionary._index.bucket_count() != buckets)
         {
-        case anyTypeId::number_type:
-            return number_ref() > n;
+            JS_STAT(object_rehashes);
         }
-
-        throw "not implemented";
-    }
-
-    any operator>(any t)
-    {
-        switch (get_type())
+#endif
+        if (inserted.second)
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
-            {
-            case anyTypeId::number_type:
-                return any(number_ref() > t.number_ref());
-            }
-            break;
+            dictionary._keys.push_back(key);
+            dictionary._erased.push_back(false);
+            _slots.emplace_back();
         }
 
-        throw "not implemented";
+        return _slots[inserted.first->second];
     }
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    bool operator>=(N n)
+    // the slots stay where they are, only the keys move out of the shared shape
+    void to_dictionary()
     {
-        switch (get_type())
+        JS_STAT(object_rehashes);
+        auto dictionary = std::make_unique<dictionary_type>();
+        dictionary->_keys = _shape->_keys;
+        dictionary->_erased.assign(_slots.size(), false);
+        dictionary->_index.reserve(_slots.size() + 1);
+        for (size_t i = 0; i < _slots.size(); i++)
         {
-        case anyTypeId::number_type:
-            return number_ref() >= n;
+            dictionary->_index.emplace(dictionary->_keys[i], i);
         }
 
-        throw "not implemented";
+        _dictionary = std::move(dictionary);
+        _shape.reset();
     }
 
-    any operator>=(any t)
+    // drops the holes left by erase, keeping the order of the live slots
+    void compact()
     {
-        switch (get_type())
+        auto &dictionary = *_dictionary;
+        size_t live = 0;
+        for (size_t i = 0; i < _slots.size(); i++)
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
+            if (dictionary._erased[i])
             {
-            case anyTypeId::number_type:
-                return any(number_ref() >= t.number_ref());
+                continue;
             }
-            break;
+
+            if (live != i)
+            {
+                _slots[live] = std::move(_slots[i]);
+                dictionary._keys[live] = std::move(dictionary._keys[i]);
+                dictionary._index[dictionary._keys[live]] = live;
+            }
+
+            live++;
         }
 
-        throw "not implemented";
+        _slots.resize(live);
+        dictionary._keys.resize(live);
+        dictionary._erased.assign(live, false);
+        dictionary._holes = 0;
     }
+};
 
-    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
-    bool operator<(N n)
+template <typename K, typename V>
+struct object
+{
+    struct K_hash
     {
-        switch (get_type())
+        typedef K argument_type;
+        typedef std::size_t result_type;
+        result_type operator()(argument_type const &value) const
         {
-        case anyTypeId::number_type:
-            return number_ref() < n;
+            return value.hash();
         }
+    };
 
-        throw "not implemented";
-    }
-
-    any operator<(any t)
+    struct K_equal_to
     {
-        switch (get_type())
+        typedef K argument_type;
+        bool operator()(argument_type const &value, argument_type const &other) const
         {
-        case anyTypeId::number_type:
-            switch (t.get_type())
+            if constexpr (requires { value.hash_differs(other); })
             {
-            case anyTypeId::number_type:
-                return any(number_ref() < t.number_ref());
+                if (value.hash_differs(other))
+                {
+                    return false;
+                }
             }
-            break;
+
+            return value == other;
         }
+    };
 
-        throw "not implemented";
-    }
+    using object_type_base = object_storage<K, V, K_hash, K_equal_to>;
+    //using object_type = object_type_base; // object_type_base - value type, std::shared_ptr<object_type_base> - reference type
+#ifdef JS_COW_STORAGE
+    using object_type = cow_ptr<object_type_base>; // cow_ptr<object_type_base> - value type, copied on write
+#else
+    using object_type = std::shared_ptr<object_type_base>; // object_type_base - value type, std::shared_ptr<object_type_base> - reference type
+#endif
+    using object_type_ref = object_type_base &;
+    using pair = std::pair<const K, V>;
 
-    bool operator<=(js::number n)
-    {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            return number_ref() <= n;
+    template <typename _Ty> 
+    struct object_traits {
+        template<class... _Types>
+	    static _Ty create(_Types&&... _Args) {
+            return object_type_base(std::forward<_Types>(_Args)...);
         }
 
-        throw "not implemented";
-    }
+        static constexpr _Ty& access(std::remove_reference_t<_Ty>& _Arg)
+        {	
+            return (static_cast<_Ty&>(_Arg));
+        }
 
-    any operator<=(any t)
-    {
-        switch (get_type())
-        {
-        case anyTypeId::number_type:
-            switch (t.get_type())
-            {
-            case anyTypeId::number_type:
-                return any(number_ref() <= t.number_ref());
-            }
-            break;
+        static constexpr _Ty& read(const std::remove_reference_t<_Ty>& _Arg)
+        {	
+            return (mutable_(_Arg));
         }
+    };
 
-        throw "not implemented";
-    }
+    template <>
+    struct object_traits<std::shared_ptr<object_type_base>> {
+        template<class... _Types>
+	    static inline auto create(_Types&&... _Args) {
+            return js::make<object_type_base>(std::forward<_Types>(_Args)...);
+        }        
 
-    template <typename... Args>
-    any operator()(Args... args) const
-    {
-        switch (get_type())
-        {
-        case anyTypeId::function_type:
-            return function_ptr()->invoke({args...});
+        static inline object_type_ref access(object_type& _Arg)
+        {	
+            return (static_cast<object_type_ref>(*_Arg));
         }
 
-        throw "not implemented";
-    }
+        static inline object_type_ref read(const object_type& _Arg)
+        {	
+            return (static_cast<object_type_ref>(*_Arg));
+        }
+    };
 
-    template <typename... Args>
-    any operator()(Args... args)
-    {
-        switch (get_type())
-        {
-        case anyTypeId::function_type:
-            return function_ptr()->invoke({args...});
+    template <>
+    struct object_traits<cow_ptr<object_type_base>> {
+        template<class... _Types>
+	    static inline auto create(_Types&&... _Args) {
+            return cow_ptr<object_type_base>::make(std::forward<_Types>(_Args)...);
+        }        
+
+        static inline object_type_ref access(object_type& _Arg)
+        {	
+            return _Arg.write();
         }
 
-        throw "not implemented";
-    }
+        static inline object_type_ref read(const object_type& _Arg)
+        {	
+            return _Arg.read();
+        }
+    };
 
-    js::string type_of()
-    {
-        switch (get_type())
-        {
-        case anyTypeId::undefined_type:
-            return TXT("undefined");
 
-        case anyTypeId::boolean_type:
-            return TXT("boolean");
+    bool isUndefined;
+    object_type _values;
 
-        case anyTypeId::number_type:
-            return TXT("number");
+    object();
 
-        case anyTypeId::string_type:
-            return TXT("string");
+    object(const object &value);
 
-        case anyTypeId::array_type:
-            return TXT("array");
+    object(object &&value);
 
-        case anyTypeId::object_type:
-            return TXT("object");
+    object &operator=(const object &value) = default;
 
-        default:
-            return TXT("error");
-        }
-    }
+    object &operator=(object &&value) = default;
 
-    void Delete(const char_t *field)
-    {
-        switch (get_type())
-        {
-        case anyTypeId::object_type:
-            object_ref().get().erase(field);
-            break;
+    object(std::initializer_list<pair> values);
 
-        default:
-            throw "wrong type";
-        }
-    }
+    object(const undefined_t &);
 
-    js::number get_length()
+    virtual ~object()
     {
-        switch (get_type())
-        {
-        case anyTypeId::string_type:
-            return string_ref().get_length();
-        case anyTypeId::array_type:
-            return array_ref().get_length();
-        default:
-            throw "wrong type";
-        }
     }
 
-    auto begin() -> decltype(array_ref().begin())
+    // root of the class ids of emitted classes, which declare the same three members
+    using _class_type = object;
+
+    static const class_info &_class()
     {
-        switch (get_type())
-        {
-        case anyTypeId::array_type:
-            return array_ref().begin();
-        default:
-            throw "wrong type";
-        }
+        static const class_info info{class_id<object>()};
+        return info;
     }
 
-    auto end() -> decltype(array_ref().end())
+    virtual const class_info &_instance_class() const
     {
-        switch (get_type())
-        {
-        case anyTypeId::array_type:
-            return array_ref().end();
-        default:
-            throw "wrong type";
-        }
+        return _class();
     }
 
-    size_t hash(void) const noexcept
+    constexpr operator bool()
     {
-        size_t const h1(std::hash<int>{}(static_cast<int>(get_type())));
-        size_t h2;
-
-        switch (get_type())
-        {
-        case anyTypeId::undefined_type:
-            h2 = 0;
-            break;
+        return !isUndefined;
+    }
 
-        case anyTypeId::boolean_type:
-            h2 = std::hash<bool>{}(static_cast<bool>(mutable_(boolean_ref_const())));
-            break;
+    // reading does not unshare copy-on-write storage, get() on a non-const object does
+    constexpr object_type_ref get() const
+    {
+        return object_traits<object_type>::read(_values);
+    }
 
-        case anyTypeId::number_type:
-            h2 = std::hash<double>{}(static_cast<double>(mutable_(number_ref_const())));
-            break;
+    constexpr object_type_ref get()
+    {
+        return object_traits<object_type>::access(_values);
+    }
 
-        case anyTypeId::string_type:
-            h2 = std::hash<tstring>{}(static_cast<tstring &>(mutable_(string_ref_const())));
-            break;
+    static ObjectKeys<js::string, object_type_base> keys(const object &);
 
-        default:
-            h2 = 0;
-        }
+    ObjectKeys<js::string, object_type_base> keys();
 
-        return hash_combine(h1, h2);
+    constexpr object *operator->()
+    {
+        return this;
     }
 
-    friend tostream &operator<<(tostream &os, any val)
-    {
-        switch (val.get_type())
-        {
-        case anyTypeId::undefined_type:
-            return os << TXT("undefined");
+    // reads: a missing key gives undefined and is not added
+    const any &operator[](js::number n) const;
 
-        case anyTypeId::boolean_type:
-            return os << val.boolean_ref();
+    const any &operator[](const char_t *s) const;
 
-        case anyTypeId::number_type:
-            return os << val.number_ref();
+    const any &operator[](std::string s) const;
 
-        case anyTypeId::pointer_type:
-            return os << TXT("null");
+    const any &operator[](const js::string &s) const;
 
-        case anyTypeId::string_type:
-            return os << val.string_ref();
+    any &operator[](js::number n);
 
-        case anyTypeId::function_type:
-            return os << TXT("[function]");
+    any &operator[](const char_t *s);
 
-        case anyTypeId::array_type:
-            return os << TXT("[array]");
+    any &operator[](std::string s);
 
-        case anyTypeId::object_type:
-            return os << TXT("[object]");
+    any &operator[](const js::string &s);
 
-        case anyTypeId::class_type:
-            return os << val.class_ref().get()->toString();
+    any &operator[](undefined_t undef);
 
-        default:
-            return os << TXT("[any]");
-        }
-    }
-};
+    const any &operator[](const property_key &key) const;
 
-template <typename... Args>
-auto function::operator()(Args... args)
-{
-    return invoke({args...});
-}
+    any &operator[](const property_key &key);
 
-template <typename F, typename _MethodType>
-any function_t<F, _MethodType>::invoke(std::initializer_list<any> args_)
-{
-    auto args_vector = std::vector<any>(args_);
-    if constexpr (std::is_void_v<_ReturnType>)
+    inline bool operator==(const object &other) const
     {
-        invoke_seq<_MethodPtr::_CountArgs>(_f, args_vector);
-        return any();
+        // TODO - finish it
+        return isUndefined == other.isUndefined && isUndefined == true;
     }
-    else
+
+    void Delete(js::number field)
+    {
+        get().erase(K(field.operator tstring()));
+    }    
+
+    void Delete(js::string field)
     {
-        return invoke_seq<_MethodPtr::_CountArgs>(_f, args_vector);
+        get().erase(field);
     }
-}
 
-template <typename T>
-struct shared;
+    void Delete(js::any field);
 
-template <class T1, class T2>
-concept NotShared = !std::is_same_v<T1, shared<T2>>;
+    void Delete(js::undefined_t)
+    {
+        get().erase("undefined");
+    }    
 
-template <typename T>
-struct shared
-{
-    using shared_type = shared<T>;
+    void Delete(const char_t *field)
+    {
+        get().erase(field);
+    }
 
-    std::shared_ptr<T> _value;
-
-    shared(T t) : _value(std::make_shared<T>(t)) {}
-    shared(std::shared_ptr<T> t) : _value(t) {}
-
-    template <typename V>
-    shared_type &operator=(const V &v)
+    template <typename N = void> requires ArithmeticOrEnum<N>
+    bool exists(N n) const
     {
-        *_value = mutable_(v);
-        return *this;
+        return get().find(js::string(to_tstring(n))) != get().end();
     }
 
-    T &operator*() const
-    {
-        return *_value.get();
-    }    
-
-    operator T() { return *_value.get(); }
-
-    // todo: memory leak here, improve it using any(shared_t<value> s)
-    operator any() { return *_value.get(); }
-
-    T &get() const { return *_value.get(); }
-
-    T *operator->() const
+    template <class T>
+    bool exists(T i) const
     {
-        return _value.get();
-    }
+        if constexpr (is_stringish_v<T>)
+        {
+            return get().find(i) != get().end();
+        }
 
-    template <class Tv>
-    auto &operator[](Tv t) const
-    {
-        return const_(get())[t];
+        return false;
     }
 
-    template <class Tv>
-    auto &operator[](Tv t)
+    virtual js::string toString()
     {
-        return get()[t];
+        tostringstream streamObj2;
+        streamObj2 << *this;
+        return streamObj2.str();
     }
 
-    auto &operator++()
+    friend tostream &operator<<(tostream &os, object val)
     {
-        return ++get();
-    }
+        if (val.isUndefined)
+        {
+            return os << TXT("undefined");
+        }
 
-    auto operator++(int)
-    {
-        return get()++;
+        return os << TXT("[object]");
     }
+};
 
-    template <class Tv>
-    auto operator+(Tv other) const
-    {
-        return get() + other;
-    }
+} // namespace tmpl
 
-    template <class Tv = void> requires NotShared<Tv, T>
-    friend auto operator+(Tv other, const shared_type &val)
-    {
-        return other + val.get();
-    }
+typedef tmpl::object<string, any> object;
 
-    template <class Tv>
-    auto operator+=(Tv other) const
-    {
-        return get() += other;
-    }    
+template <typename T, typename... Types>
+constexpr T &get_alternative(std::variant<Types...> &value)
+{
+    return std::get<T>(value);
+}
 
-    template <class Tv> requires NotShared<Tv, T>
-    friend auto operator+=(Tv& other, const shared_type &val)
-    {
-        return other += mutable_(val).get();
-    }    
+template <typename T, typename... Types>
+constexpr const T &get_alternative(const std::variant<Types...> &value)
+{
+    return std::get<T>(value);
+}
 
-    template <class Tv>
-    auto operator-(Tv other) const
+#ifdef JS_COMPACT_ANY
+// opt-in 16 byte storage for any: numbers and booleans inline, everything else in a refcounted cell.
+// Cells are shared between copies; the runtime mutates only numbers in place, and those are inline.
+// Under JS_COW_STORAGE arrays and objects are values rather than handles, so a write access to a shared
+// array or object cell copies the cell first.
+struct any_compact_value
+{
+    struct cell_base
     {
-        return get() - other;
-    }    
+        std::atomic<std::size_t> _refs{1};
 
-    template <class Tv = void> requires NotShared<Tv, T>
-    friend auto operator-(Tv other, const shared_type &val)
-    {
-        return other - val.get();
-    }
+        virtual ~cell_base() = default;
+    };
 
-    template <class Tv>
-    auto operator-=(Tv other) const
+    template <typename T>
+    struct cell : cell_base
     {
-        return get() -= other;
-    }    
+        T _value;
 
-    template <class Tv> requires NotShared<Tv, T>
-    friend auto operator-=(Tv& other, const shared_type &val)
-    {
-        return other -= mutable_(val).get();
-    }    
+        cell(const T &value) : _value(value)
+        {
+        }
+    };
 
-    template <class Tv>
-    auto operator*(Tv other) const
+    // same order as the alternatives of any::any_value_type
+    template <typename T>
+    static constexpr unsigned char index_of()
     {
-        return get() * other;
-    }    
+        if constexpr (std::is_same_v<T, js::undefined_t>) return 0;
+        else if constexpr (std::is_same_v<T, js::boolean>) return 1;
+        else if constexpr (std::is_same_v<T, js::pointer_t>) return 2;
+        else if constexpr (std::is_same_v<T, js::number>) return 3;
+        else if constexpr (std::is_same_v<T, js::string>) return 4;
+        else if constexpr (std::is_same_v<T, js::array_any>) return 5;
+        else if constexpr (std::is_same_v<T, js::object>) return 6;
+        else if constexpr (std::is_same_v<T, std::shared_ptr<js::function>>) return 7;
+        else if constexpr (std::is_same_v<T, std::shared_ptr<js::object>>) return 8;
+        else return 0xff;
+    }
 
-    template <class Tv = void> requires NotShared<Tv, T>
-    friend auto operator*(Tv other, const shared_type &val)
+    static constexpr bool is_inline(unsigned char index)
     {
-        return other * val.get();
+        return index <= 1 || index == 3;
     }
 
-    template <class Tv>
-    auto operator*=(Tv other) const
-    {
-        return get() *= other;
-    }    
+    union {
+        js::number _number;
+        js::boolean _boolean;
+        cell_base *_cell;
+    };
 
-    template <class Tv> requires NotShared<Tv, T>
-    friend auto operator*=(Tv& other, const shared_type &val)
-    {
-        return other *= mutable_(val).get();
-    }    
+    unsigned char _index;
 
-    template <class Tv>
-    auto operator/(Tv other) const
+    any_compact_value(const js::undefined_t &) : _cell(nullptr), _index(0)
     {
-        return get() / other;
-    }    
+    }
 
-    template <class Tv = void> requires NotShared<Tv, T>
-    friend auto operator/(Tv other, const shared_type &val)
+    any_compact_value(const js::boolean &value) : _boolean(value), _index(1)
     {
-        return other / val.get();
     }
 
-    template <class Tv>
-    auto operator/=(Tv other) const
+    any_compact_value(const js::number &value) : _number(value), _index(3)
     {
-        return get() /= other;
-    }        
+    }
 
-    template <class Tv> requires NotShared<Tv, T>
-    friend auto operator/=(Tv& other, const shared_type &val)
+    template <typename T> requires (index_of<T>() != 0xff)
+    any_compact_value(const T &value) : _cell(new cell<T>(value)), _index(index_of<T>())
     {
-        return other /= mutable_(val).get();
-    }    
+    }
 
-    template <class Tv>
-    friend bool operator==(const Tv &other, const shared_type &val)
+    any_compact_value(const any_compact_value &other) : _cell(nullptr), _index(0)
     {
-        return val.get() == other;
+        copy_from(other);
     }
 
-    template <class Tv>
-    friend bool operator!=(const Tv &other, const shared_type &val)
+    any_compact_value(any_compact_value &&other) noexcept : _cell(nullptr), _index(0)
     {
-        return val.get() != other;
+        std::memcpy(static_cast<void *>(this), &other, sizeof(any_compact_value));
+        other._index = 0;
     }
 
-    template <class Tv>
-    bool operator==(const Tv &other) const
+    ~any_compact_value()
     {
-        return get() == other;
+        release();
     }
 
-    template <class Tv>
-    bool operator!=(const Tv &other) const
+    any_compact_value &operator=(const any_compact_value &other)
     {
-        return get() != other;
-    }    
+        if (this != &other)
+        {
+            release();
+            copy_from(other);
+        }
 
-    template <class Tv>
-    friend bool operator==(const shared<Tv> &other, const shared_type &val)
+        return *this;
+    }
+
+    any_compact_value &operator=(any_compact_value &&other) noexcept
     {
-        return val.get() == other.get();
+        if (this != &other)
+        {
+            release();
+            std::memcpy(static_cast<void *>(this), &other, sizeof(any_compact_value));
+            other._index = 0;
+        }
+
+        return *this;
     }
 
-    template <class Tv>
-    friend bool operator!=(const shared<Tv> &other, const shared_type &val)
+    inline size_t index() const
     {
-        return val.get() != other.get();
+        return _index;
     }
 
-    template <class Tv>
-    bool operator==(const shared<Tv> &other) const
+    template <typename T>
+    T &get()
     {
-        return get() == other.get();
+#ifdef JS_COW_STORAGE
+        if constexpr (std::is_same_v<T, js::array_any> || std::is_same_v<T, js::object>)
+        {
+            if (_index == index_of<T>() && _cell->_refs.load(std::memory_order_acquire) > 1)
+            {
+                auto copy = new cell<T>(static_cast<cell<T> *>(_cell)->_value);
+                release();
+                _cell = copy;
+                _index = index_of<T>();
+            }
+        }
+#endif
+
+        return value_of<T>();
     }
 
-    template <class Tv>
-    bool operator!=(const shared<Tv> &other) const
+    template <typename T>
+    const T &get() const
     {
-        return get() != other.get();
-    } 
+        return value_of<T>();
+    }
 
-    number get_length()
+private:
+    template <typename T>
+    T &value_of() const
     {
-        return get()->get_length();
+        if (_index != index_of<T>())
+        {
+            throw std::bad_variant_access();
+        }
+
+        if constexpr (std::is_same_v<T, js::undefined_t>)
+        {
+            return mutable_(undefined);
+        }
+        else if constexpr (std::is_same_v<T, js::boolean>)
+        {
+            return mutable_(_boolean);
+        }
+        else if constexpr (std::is_same_v<T, js::number>)
+        {
+            return mutable_(_number);
+        }
+        else
+        {
+            return static_cast<cell<T> *>(_cell)->_value;
+        }
     }
 
-    auto begin()
+    void copy_from(const any_compact_value &other)
     {
-        return get()->begin();
+        std::memcpy(static_cast<void *>(this), &other, sizeof(any_compact_value));
+        if (!is_inline(_index))
+        {
+            _cell->_refs.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
-    auto end()
+    void release()
     {
-        return get()->end();
+        if (!is_inline(_index) && _cell->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete _cell;
+        }
+
+        _index = 0;
     }
 };
 
 template <typename T>
-shared(T t)->shared<T>;
-
-// TODO: put into class undefined
-static js::number operator+(const undefined_t &v)
+constexpr T &get_alternative(any_compact_value &value)
 {
-    return number(NAN);
+    return value.template get<T>();
 }
 
-// TODO: put into class boolean
-static js::number operator+(const boolean &v)
+template <typename T>
+constexpr const T &get_alternative(const any_compact_value &value)
 {
-    return number((mutable_(v)) ? 1 : 0);
+    return value.template get<T>();
 }
+#endif
 
-// typedefs
-typedef std::unordered_map<any, int, any::any_hash, any::any_equal_to> switch_type;
-
-// Number
-static js::number Infinity(std::numeric_limits<double>::infinity());
-static js::number NaN(std::numeric_limits<double>::quiet_NaN());
-
-namespace tmpl
+struct any
 {
+    struct any_hash
+    {
+        typedef js::any argument_type;
+        typedef std::size_t result_type;
+        result_type operator()(argument_type const &value) const
+        {
+            return value.hash();
+        }
+    };
 
-// Number
-template <typename V>
-number<V>::operator js::string()
-{
-    return js::string(static_cast<tstring>(*this));
-}
+    struct any_equal_to
+    {
+        typedef js::any argument_type;
+        bool operator()(argument_type const &value, argument_type const &other) const
+        {
+            if (value.get_type() == anyTypeId::string_type && other.get_type() == anyTypeId::string_type
+                && value.string_ref_const().hash_differs(other.string_ref_const()))
+            {
+                return false;
+            }
 
-template <typename V>
+            return value == other;
+        }
+    };
+
+    enum anyTypeId
+    {
+        undefined_type = 0,
+        boolean_type,
+        pointer_type,
+        number_type,
+        string_type,
+        array_type,
+        object_type,
+        function_type,
+        class_type
+    };
+
+#ifdef JS_COMPACT_ANY
+    using any_value_type = any_compact_value;
+#else
+    using any_value_type = std::variant<
+        js::undefined_t,
+        js::boolean,
+        js::pointer_t,
+        js::number,
+        js::string,
+        js::array_any,
+        js::object,
+        std::shared_ptr<js::function>,
+        std::shared_ptr<js::object>>;
+#endif
+
+    any_value_type _value;
+
+    any() : _value(undefined)
+    {
+    }
+
+    any(const any &other) : _value(other._value)
+    {
+        JS_STAT(any_copies);
+    }
+
+    any(any &&other) noexcept : _value(std::move(other._value))
+    {
+    }
+
+    any(void_t) : _value(undefined)
+    {
+    }
+
+    any(undefined_t) : _value(undefined)
+    {
+    }
+
+    any(pointer_t v) : _value(v)
+    {
+    }
+
+    any(bool value) : _value(js::boolean(value))
+    {
+    }
+
+    template <typename N = void> requires ArithmeticOrEnum<N>
+    any(N value) : _value(js::number(value))
+    {
+    }
+
+    any(char_t value) : _value(js::string(value))
+    {
+    }
+
+    any(js::boolean value) : _value(value)
+    {
+    }
+
+    any(js::number value) : _value(value)
+    {
+    }
+
+    any(const tstring &value) : _value(js::string(value))
+    {
+    }
+
+    any(tstring &&value) : _value(js::string(std::move(value)))
+    {
+    }
+
+    any(const js::string &value) : _value(value)
+    {
+    }
+
+    any(js::string &&value) : _value(std::move(value))
+    {
+    }
+
+    any(const js::array_any &value) : _value(value)
+    {
+    }
+
+    any(js::array_any &&value) : _value(std::move(value))
+    {
+    }
+
+    any(const js::object &value) : _value(value)
+    {
+    }
+
+    any(js::object &&value) : _value(std::move(value))
+    {
+    }
+
+    template <typename F, class = std::enable_if_t<std::is_member_function_pointer_v<typename _Deduction<F>::type>>>
+    any(const F &value) : _value(std::shared_ptr<js::function>(((js::function *)new js::function_t<F>(value))))
+    {
+    }
+
+    template <typename Rx, typename... Args>
+    any(Rx(__cdecl *value)(Args...)) : _value(std::shared_ptr<js::function>((js::function *)new js::function_t<Rx(__cdecl *)(Args...), Rx(__cdecl *)(Args...)>(value)))
+    {
+    }
+
+    template <typename C>
+    any(std::shared_ptr<C> value) : _value(std::shared_ptr<js::object>(value))
+    {
+    }
+
+    constexpr any *operator->()
+    {
+        return this;
+    }
+
+    inline anyTypeId get_type() const
+    {
+        return static_cast<anyTypeId>(_value.index());
+    }
+
+    template <typename T>
+    inline const T &get() const
+    {
+        return get_alternative<T>(_value);
+    }
+
+    template <typename T>
+    inline std::shared_ptr<T> get_ptr() const
+    {
+        return js::as<T>(mutable_(get_alternative<std::shared_ptr<js::object>>(_value)));
+    }
+
+    template <typename T>
+    inline T &get()
+    {
+        return get_alternative<T>(_value);
+    }
+
+    template <typename T>
+    inline std::shared_ptr<T> get_ptr()
+    {
+        return js::as<T>(get_alternative<std::shared_ptr<js::object>>(_value));
+    }
+
+    inline const js::boolean &boolean_ref_const() const
+    {
+        return get<js::boolean>();
+    }
+
+    inline js::boolean &boolean_ref()
+    {
+        return get<js::boolean>();
+    }
+
+    inline const js::number &number_ref_const() const
+    {
+        return get<js::number>();
+    }
+
+    inline js::number &number_ref()
+    {
+        return get<js::number>();
+    }
+
+    inline const js::string &string_ref_const() const
+    {
+        return get<js::string>();
+    }
+
+    inline js::string &string_ref()
+    {
+        return get<js::string>();
+    }
+
+    inline std::shared_ptr<function> function_ptr()
+    {
+        return get<std::shared_ptr<function>>();
+    }
+
+    inline const array_any &array_ref_const() const
+    {
+        return get<array_any>();
+    }
+
+    inline array_any &array_ref()
+    {
+        return get<array_any>();
+    }
+
+    inline const object &object_ref_const() const
+    {
+        return get<object>();
+    }
+
+    inline object &object_ref()
+    {
+        return get<object>();
+    }
+
+    inline const std::shared_ptr<js::object> &class_ref_const() const
+    {
+        return get<std::shared_ptr<js::object>>();
+    }
+
+    inline std::shared_ptr<js::object> &class_ref()
+    {
+        return get<std::shared_ptr<js::object>>();
+    }
+
+    any &operator=(const any &other)
+    {
+        JS_STAT(any_copies);
+        _value = other._value;
+        return *this;
+    }
+
+    any &operator=(any &&other) noexcept
+    {
+        _value = std::move(other._value);
+        return *this;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any &operator=(N other)
+    {
+        _value = js::number(other);
+        return *this;
+    }
+
+    // reads: nothing is added to the array or object, which may share its storage with copies
+    template <class T>
+    const any &operator[](T t) const
+    {
+        if constexpr (std::is_same_v<T, js::number>)
+        {
+            if (get_type() == anyTypeId::array_type)
+            {
+                return array_ref_const()[t];
+            }
+        }
+
+        if constexpr (is_stringish_v<T>)
+        {
+            if (get_type() == anyTypeId::object_type)
+            {
+                return object_ref_const()[t];
+            }
+        }
+
+        throw "wrong type";
+    }
+
+    template <class T>
+    any &operator[](T t)
+    {
+        if constexpr (std::is_same_v<T, js::number>)
+        {
+            if (get_type() == anyTypeId::array_type)
+            {
+                return (array_ref())[t];
+            }
+        }
+
+        if constexpr (is_stringish_v<T>)
+        {
+            if (get_type() == anyTypeId::object_type)
+            {
+                return (object_ref())[t];
+            }
+        }
+
+        throw "wrong type";
+    }
+
+    operator js::pointer_t()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::string_type && string_ref().is_null())
+        {
+            return null;
+        }
+
+        if (get_type() == anyTypeId::number_type)
+        {
+            return pointer_t(number_ref());
+        }
+
+        if (get_type() == anyTypeId::class_type)
+        {
+            return pointer_t(class_ref().get());
+        }
+
+        return pointer_t(0xffffffff);
+    }
+
+    operator js::boolean()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::boolean_type)
+        {
+            return boolean_ref();
+        }
+
+        throw "wrong type";
+    }
+
+    operator js::number()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::number_type)
+        {
+            return number_ref();
+        }
+
+        if (get_type() == anyTypeId::string_type)
+        {
+            return js::number(static_cast<double>(string_ref()));
+        }
+
+        throw "wrong type";
+    }
+
+    operator js::string()
+    {
+        JS_STAT(any_conversions);
+        /*
+            // String
+            template <typename T>
+            string<T>::string(any val) : _value(val != null ? val.operator std::string() : string_empty._value), _control(val != null ? string_defined : string_null)
+            {
+            }    
+        */
+
+        if (get_type() == anyTypeId::undefined_type)
+        {
+            return js::string();
+        }
+
+        if (get_type() == anyTypeId::string_type)
+        {
+            return string_ref();
+        }
+
+        if (get_type() == anyTypeId::number_type)
+        {
+            return js::string(number_ref().operator tstring());
+        }
+
+        if (get_type() == anyTypeId::pointer_type)
+        {
+            return js::string(get<js::pointer_t>());
+        }        
+
+        throw "wrong type";
+    }
+
+    operator js::object()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::object_type)
+        {
+            return object_ref();
+        }
+
+        throw "wrong type";
+    }
+
+    operator js::array_any()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::array_type)
+        {
+            return array_ref();
+        }
+
+        throw "wrong type";
+    }
+
+    operator bool()
+    {
+        JS_STAT(any_conversions);
+        switch (get_type())
+        {
+        case anyTypeId::undefined_type:
+            return false;
+        case anyTypeId::boolean_type:
+            return boolean_ref();
+        case anyTypeId::number_type:
+            return number_ref();
+        case anyTypeId::string_type:
+            return !string_ref().view().empty();
+        case anyTypeId::object_type:
+            return object_ref()->get().size() > 0;
+        case anyTypeId::array_type:
+            return array_ref()->get().size() > 0;
+        case anyTypeId::pointer_type:
+            return get<pointer_t>();
+        case anyTypeId::class_type:
+            return true;
+        default:
+            break;
+        }
+
+        return false;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnum<N>
+    operator N()
+    {
+        JS_STAT(any_conversions);
+        switch (get_type())
+        {
+        case anyTypeId::undefined_type:
+            return 0;
+        case anyTypeId::boolean_type:
+            return boolean_ref() ? 1 : 0;
+        case anyTypeId::number_type:
+            return number_ref();
+        case anyTypeId::string_type:
+            return static_cast<N>(static_cast<double>(string_ref()));
+        }
+
+        throw "wrong type";
+    }
+
+    template <typename T>
+    operator std::shared_ptr<T>()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::class_type)
+        {
+            return js::as<T>(get_alternative<std::shared_ptr<js::object>>(_value));
+        }
+
+        throw "wrong type";
+    }
+
+    template <typename Rx, typename... Args>
+    operator std::function<Rx(Args...)>()
+    {
+        JS_STAT(any_conversions);
+        if (get_type() == anyTypeId::function_type)
+        {
+            auto func = function_ptr();
+            if (auto typed = func->as_typed<Rx(Args...)>())
+            {
+                // same signature: call straight through, nothing is boxed into any
+                return std::function<Rx(Args...)>([func, typed](Args... args) -> Rx {
+                    return typed->call(args...);
+                });
+            }
+
+            return std::function<Rx(Args...)>([=](Args... args) -> Rx {
+                if constexpr (std::is_void_v<Rx>)
+                {
+                    func->invoke({args...});
+                }
+                else
+                {
+                    return func->invoke({args...});
+                }
+            });
+        }
+
+        throw "wrong type";
+    }
+
+    operator tstring()
+    {
+        JS_STAT(any_conversions);
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref().operator tstring();
+        case anyTypeId::string_type:
+            return tstring(string_ref().view());
+        default:
+            break;
+        }
+
+        tostringstream streamObj2;
+        streamObj2 << *this;
+        return streamObj2.str();
+    }
+
+    bool operator==(const js::any &other) const
+    {
+        if (get_type() != other.get_type())
+        {
+            return false;
+        }
+
+        switch (get_type())
+        {
+        case anyTypeId::undefined_type:
+            return true;
+        case anyTypeId::boolean_type:
+            return boolean_ref_const() == mutable_(other).boolean_ref_const();
+        case anyTypeId::number_type:
+            return number_ref_const() == mutable_(other).number_ref_const();
+        case anyTypeId::string_type:
+            return string_ref_const() == mutable_(other).string_ref_const();
+        case anyTypeId::object_type:
+            return object_ref_const() == mutable_(other).object_ref_const();
+        }
+
+        throw "not implemented";
+    }
+
+    bool operator!=(const js::any &other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator==(const js::undefined_t &) const
+    {
+        return get_type() == anyTypeId::undefined_type;
+    }
+
+    bool operator!=(const js::undefined_t &) const
+    {
+        return get_type() != anyTypeId::undefined_type;
+    }
+
+    bool operator==(const pointer_t &other) const
+    {
+        switch (get_type())
+        {
+        case anyTypeId::undefined_type:
+        case anyTypeId::boolean_type:
+        case anyTypeId::number_type:
+            return false;
+        case anyTypeId::string_type:
+            return string_ref_const().is_null() && other._ptr == nullptr;
+        case anyTypeId::object_type:
+        case anyTypeId::class_type:
+        case anyTypeId::pointer_type:
+            return get<pointer_t>()._ptr == other._ptr;
+        }
+
+        throw "not implemented";
+    }
+
+    bool operator!=(const pointer_t &other) const
+    {
+        return !operator==(other);
+    }
+
+    bool operator==(const js::boolean &other) const
+    {
+        return static_cast<js::boolean>(*mutable_(this)) == other;
+    }
+
+    bool operator!=(const js::boolean &other) const
+    {
+        return static_cast<js::boolean>(*mutable_(this)) != other;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    bool operator==(const N &n) const
+    {
+        return static_cast<js::number>(*mutable_(this)) == n;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend bool operator==(const N &n, const any& val)
+    {
+        return n == static_cast<js::number>(mutable_(val));
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    bool operator!=(const N &n) const
+    {
+        return static_cast<js::number>(*mutable_(this)) != n;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend bool operator!=(const N &n, const any& val)
+    {
+        return n != static_cast<js::number>(mutable_(val));
+    }
+
+    bool operator==(const js::string &other) const
+    {
+        return static_cast<js::string>(*mutable_(this)) == other;
+    }
+
+    bool operator!=(const js::string &other) const
+    {
+        return static_cast<js::string>(*mutable_(this)) != other;
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any operator+(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref() + n;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend N operator+(N n, const any& val)
+    {
+        switch (val.get_type())
+        {
+        case anyTypeId::number_type:
+            return n + mutable_(val).number_ref();
+        }
+
+        throw "not implemented";
+    }
+
+    any operator+(const string &s)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref().operator js::string() + s;
+        case anyTypeId::string_type:
+            return any(string_ref() + s);
+        }
+
+        throw "not implemented";
+    }
+
+    inline any operator+(const any &t) const
+    {
+        return mutable_(this)->operator+(t);
+    }
+
+    any operator+(const any &t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref() + t.number_ref_const();
+            case anyTypeId::string_type:
+                return number_ref().operator js::string() + t.string_ref_const();
+            }
+            break;
+        case anyTypeId::string_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::string_type:
+                return string_ref() + t.string_ref_const();
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    any &operator++()
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref()++;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    any operator++(int)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            any tmp(number_ref());
+            operator++();
+            return tmp;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any &operator+=(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref() += n;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend N operator+=(N &n, any value)
+    {
+        switch (value.get_type())
+        {
+        case anyTypeId::number_type:
+            return n += value.number_ref();
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any operator-(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref() - n;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend N operator-(N n, const any& val)
+    {
+        switch (val.get_type())
+        {
+        case anyTypeId::number_type:
+            return n - mutable_(val).number_ref();
+        }
+
+        throw "not implemented";
+    }    
+
+    any operator-(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return number_ref() - t.number_ref();
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    any &operator--()
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref() -= 1;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    any operator--(int)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            any tmp(number_ref());
+            operator--();
+            return tmp;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any &operator-=(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref() -= n;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend N operator-=(N &n, any value)
+    {
+        switch (value.get_type())
+        {
+        case anyTypeId::number_type:
+            return n -= value.number_ref();
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any operator*(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return any(number_ref() * n);
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend N operator*(N n, const any& val)
+    {
+        switch (val.get_type())
+        {
+        case anyTypeId::number_type:
+            return n * mutable_(val).number_ref();
+        }
+
+        throw "not implemented";
+    }    
+
+    any operator*(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() * t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any &operator*=(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref() *= n;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any operator/(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return any(number_ref() / n);
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend N operator/(N n, const any& val)
+    {
+        switch (val.get_type())
+        {
+        case anyTypeId::number_type:
+            return n / mutable_(val).number_ref();
+        }
+
+        throw "not implemented";
+    }
+
+    any operator/(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() / t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any &operator/=(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref() /= n;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any operator%(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return any(number_ref() % n);
+        }
+
+        throw "not implemented";
+    }
+
+    any operator%(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() % t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    friend any operator%(N n, any value)
+    {
+        switch (value.get_type())
+        {
+        case anyTypeId::number_type:
+            return any(js::number(n) % value.number_ref());
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    any &operator%=(N other)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            number_ref() %= other;
+            return *this;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    bool operator>(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref() > n;
+        }
+
+        throw "not implemented";
+    }
+
+    any operator>(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() > t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    bool operator>=(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref() >= n;
+        }
+
+        throw "not implemented";
+    }
+
+    any operator>=(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() >= t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename N = void> requires ArithmeticOrEnumOrNumber<N>
+    bool operator<(N n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref() < n;
+        }
+
+        throw "not implemented";
+    }
+
+    any operator<(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() < t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    bool operator<=(js::number n)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            return number_ref() <= n;
+        }
+
+        throw "not implemented";
+    }
+
+    any operator<=(any t)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::number_type:
+            switch (t.get_type())
+            {
+            case anyTypeId::number_type:
+                return any(number_ref() <= t.number_ref());
+            }
+            break;
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename... Args>
+    any operator()(Args... args) const
+    {
+        switch (get_type())
+        {
+        case anyTypeId::function_type:
+            return function_ptr()->invoke({args...});
+        }
+
+        throw "not implemented";
+    }
+
+    template <typename... Args>
+    any operator()(Args... args)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::function_type:
+            return function_ptr()->invoke({args...});
+        }
+
+        throw "not implemented";
+    }
+
+    js::string type_of()
+    {
+        switch (get_type())
+        {
+        case anyTypeId::undefined_type:
+            return TXT("undefined");
+
+        case anyTypeId::boolean_type:
+            return TXT("boolean");
+
+        case anyTypeId::number_type:
+            return TXT("number");
+
+        case anyTypeId::string_type:
+            return TXT("string");
+
+        case anyTypeId::array_type:
+            return TXT("array");
+
+        case anyTypeId::object_type:
+            return TXT("object");
+
+        default:
+            return TXT("error");
+        }
+    }
+
+    void Delete(const char_t *field)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::object_type:
+            object_ref().get().erase(field);
+            break;
+
+        default:
+            throw "wrong type";
+        }
+    }
+
+    void Delete(js::number field)
+    {
+        switch (get_type())
+        {
+        case anyTypeId::array_type:
+            array_ref().Delete(field);
+            break;
+
+        case anyTypeId::object_type:
+            object_ref().Delete(field);
+            break;
+
+        default:
+            throw "wrong type";
+        }
+    }
+
+    js::number get_length()
+    {
+        switch (get_type())
+        {
+        case anyTypeId::string_type:
+            return string_ref().get_length();
+        case anyTypeId::array_type:
+            return array_ref().get_length();
+        default:
+            throw "wrong type";
+        }
+    }
+
+    auto begin() -> decltype(array_ref().begin())
+    {
+        switch (get_type())
+        {
+        case anyTypeId::array_type:
+            return array_ref().begin();
+        default:
+            throw "wrong type";
+        }
+    }
+
+    auto end() -> decltype(array_ref().end())
+    {
+        switch (get_type())
+        {
+        case anyTypeId::array_type:
+            return array_ref().end();
+        default:
+            throw "wrong type";
+        }
+    }
+
+    size_t hash(void) const noexcept
+    {
+        size_t const h1(std::hash<int>{}(static_cast<int>(get_type())));
+        size_t h2;
+
+        switch (get_type())
+        {
+        case anyTypeId::undefined_type:
+            h2 = 0;
+            break;
+
+        case anyTypeId::boolean_type:
+            h2 = std::hash<bool>{}(static_cast<bool>(mutable_(boolean_ref_const())));
+            break;
+
+        case anyTypeId::number_type:
+            h2 = std::hash<double>{}(static_cast<double>(mutable_(number_ref_const())));
+            break;
+
+        case anyTypeId::string_type:
+            h2 = string_ref_const().hash();
+            break;
+
+        default:
+            h2 = 0;
+        }
+
+        return hash_combine(h1, h2);
+    }
+
+    friend tostream &operator<<(tostream &os, any val)
+    {
+        switch (val.get_type())
+        {
+        case anyTypeId::undefined_type:
+            return os << TXT("undefined");
+
+        case anyTypeId::boolean_type:
+            return os << val.boolean_ref();
+
+        case anyTypeId::number_type:
+            return os << val.number_ref();
+
+        case anyTypeId::pointer_type:
+            return os << TXT("null");
+
+        case anyTypeId::string_type:
+            return os << val.string_ref();
+
+        case anyTypeId::function_type:
+            return os << TXT("[function]");
+
+        case anyTypeId::array_type:
+            return os << TXT("[array]");
+
+        case anyTypeId::object_type:
+            return os << TXT("[object]");
+
+        case anyTypeId::class_type:
+            return os << val.class_ref().get()->toString();
+
+        default:
+            return os << TXT("[any]");
+        }
+    }
+};
+
+template <typename... Args>
+auto function::operator()(Args... args)
+{
+    return invoke({args...});
+}
+
+template <typename F, typename _MethodType>
+any function_t<F, _MethodType>::invoke(std::initializer_list<any> args_)
+{
+    JS_STAT(function_invokes);
+    if constexpr (std::is_void_v<_ReturnType>)
+    {
+        invoke_args<_MethodPtr::_CountArgs>(_f, args_.begin(), args_.size());
+        return any();
+    }
+    else
+    {
+        return invoke_args<_MethodPtr::_CountArgs>(_f, args_.begin(), args_.size());
+    }
+}
+
+template <typename T>
+struct shared;
+
+template <class T1, class T2>
+concept NotShared = !std::is_same_v<T1, shared<T2>>;
+
+template <typename T>
+struct shared
+{
+    using shared_type = shared<T>;
+
+    std::shared_ptr<T> _value;
+
+    shared(T t) : _value(std::make_shared<T>(t)) {}
+    shared(std::shared_ptr<T> t) : _value(t) {}
+
+    template <typename V>
+    shared_type &operator=(const V &v)
+    {
+        *_value = mutable_(v);
+        return *this;
+    }
+
+    T &operator*() const
+    {
+        return *_value.get();
+    }    
+
+    operator T() { return *_value.get(); }
+
+    // todo: memory leak here, improve it using any(shared_t<value> s)
+    operator any() { return *_value.get(); }
+
+    T &get() const { return *_value.get(); }
+
+    T *operator->() const
+    {
+        return _value.get();
+    }
+
+    template <class Tv>
+    auto &operator[](Tv t) const
+    {
+        return const_(get())[t];
+    }
+
+    template <class Tv>
+    auto &operator[](Tv t)
+    {
+        return get()[t];
+    }
+
+    auto &operator++()
+    {
+        return ++get();
+    }
+
+    auto operator++(int)
+    {
+        return get()++;
+    }
+
+    template <class Tv>
+    auto operator+(Tv other) const
+    {
+        return get() + other;
+    }
+
+    template <class Tv = void> requires NotShared<Tv, T>
+    friend auto operator+(Tv other, const shared_type &val)
+    {
+        return other + val.get();
+    }
+
+    template <class Tv>
+    auto operator+=(Tv other) const
+    {
+        return get() += other;
+    }    
+
+    template <class Tv> requires NotShared<Tv, T>
+    friend auto operator+=(Tv& other, const shared_type &val)
+    {
+        return other += mutable_(val).get();
+    }    
+
+    template <class Tv>
+    auto operator-(Tv other) const
+    {
+        return get() - other;
+    }    
+
+    template <class Tv = void> requires NotShared<Tv, T>
+    friend auto operator-(Tv other, const shared_type &val)
+    {
+        return other - val.get();
+    }
+
+    template <class Tv>
+    auto operator-=(Tv other) const
+    {
+        return get() -= other;
+    }    
+
+    template <class Tv> requires NotShared<Tv, T>
+    friend auto operator-=(Tv& other, const shared_type &val)
+    {
+        return other -= mutable_(val).get();
+    }    
+
+    template <class Tv>
+    auto operator*(Tv other) const
+    {
+        return get() * other;
+    }    
+
+    template <class Tv = void> requires NotShared<Tv, T>
+    friend auto operator*(Tv other, const shared_type &val)
+    {
+        return other * val.get();
+    }
+
+    template <class Tv>
+    auto operator*=(Tv other) const
+    {
+        return get() *= other;
+    }    
+
+    template <class Tv> requires NotShared<Tv, T>
+    friend auto operator*=(Tv& other, const shared_type &val)
+    {
+        return other *= mutable_(val).get();
+    }    
+
+    template <class Tv>
+    auto operator/(Tv other) const
+    {
+        return get() / other;
+    }    
+
+    template <class Tv = void> requires NotShared<Tv, T>
+    friend auto operator/(Tv other, const shared_type &val)
+    {
+        return other / val.get();
+    }
+
+    template <class Tv>
+    auto operator/=(Tv other) const
+    {
+        return get() /= other;
+    }        
+
+    template <class Tv> requires NotShared<Tv, T>
+    friend auto operator/=(Tv& other, const shared_type &val)
+    {
+        return other /= mutable_(val).get();
+    }    
+
+    template <class Tv>
+    friend bool operator==(const Tv &other, const shared_type &val)
+    {
+        return val.get() == other;
+    }
+
+    template <class Tv>
+    friend bool operator!=(const Tv &other, const shared_type &val)
+    {
+        return val.get() != other;
+    }
+
+    template <class Tv>
+    bool operator==(const Tv &other) const
+    {
+        return get() == other;
+    }
+
+    template <class Tv>
+    bool operator!=(const Tv &other) const
+    {
+        return get() != other;
+    }    
+
+    template <class Tv>
+    friend bool operator==(const shared<Tv> &other, const shared_type &val)
+    {
+        return val.get() == other.get();
+    }
+
+    template <class Tv>
+    friend bool operator!=(const shared<Tv> &other, const shared_type &val)
+    {
+        return val.get() != other.get();
+    }
+
+    template <class Tv>
+    bool operator==(const shared<Tv> &other) const
+    {
+        return get() == other.get();
+    }
+
+    template <class Tv>
+    bool operator!=(const shared<Tv> &other) const
+    {
+        return get() != other.get();
+    } 
+
+    number get_length()
+    {
+        return get()->get_length();
+    }
+
+    auto begin()
+    {
+        return get()->begin();
+    }
+
+    auto end()
+    {
+        return get()->end();
+    }
+};
+
+template <typename T>
+shared(T t)->shared<T>;
+
+// TODO: put into class undefined
+static js::number operator+(const undefined_t &v)
+{
+    return number(NAN);
+}
+
+// TODO: put into class boolean
+static js::number operator+(const boolean &v)
+{
+    return number((mutable_(v)) ? 1 : 0);
+}
+
+// typedefs
+typedef std::unordered_map<any, int, any::any_hash, any::any_equal_to> switch_type;
+
+// Number
+static js::number Infinity(std::numeric_limits<double>::infinity());
+static js::number NaN(std::numeric_limits<double>::quiet_NaN());
+
+namespace tmpl
+{
+
+// Number
+template <typename V>
+number<V>::operator js::string()
+{
+    return js::string(static_cast<tstring>(*this));
+}
+
+template <typename V>
 js::string number<V>::toString()
 {
-    tostringstream streamObj2;
-    streamObj2 << _value;
-    return streamObj2.str();
+    return utils::number_to_tstring(static_cast<double>(_value));
+}
+
+template <typename V>
+js::string number<V>::toString(number_t radix)
+{
+    return utils::number_to_tstring(static_cast<double>(_value), static_cast<int>(radix));
+}
+
+template <typename T>
+string<T> string<T>::operator+(const any &value)
+{
+    if (value.get_type() == any::anyTypeId::string_type)
+    {
+        return append_copy(value.string_ref_const().view());
+    }
+
+    return append_copy(mutable_(value).operator tstring());
+}
+
+template <typename T>
+string<T> &string<T>::operator+=(const any &value)
+{
+    if (value.get_type() == any::anyTypeId::string_type)
+    {
+        append(value.string_ref_const().view());
+        return *this;
+    }
+
+    append(mutable_(value).operator tstring());
+    return *this;
+}
+
+// Object
+template <typename K, typename V>
+object<K, V>::object() : _values(object<K, V>::object_traits<object<K, V>::object_type>::create()), isUndefined(false)
+{
+}
+
+template <typename K, typename V>
+object<K, V>::object(const object& value) : _values(value._values), isUndefined(value.isUndefined)
+{
+}
+
+template <typename K, typename V>
+object<K, V>::object(object&& value) : _values(std::move(value._values)), isUndefined(value.isUndefined)
+{
+}
+
+template <typename K, typename V>
+object<K, V>::object(std::initializer_list<pair> values) : _values(object<K, V>::object_traits<object<K, V>::object_type>::create(values)), isUndefined(false)
+{
+}
+
+template <typename K, typename V>
+object<K, V>::object(const undefined_t &) : _values(object<K, V>::object_traits<object<K, V>::object_type>::create()), isUndefined(true)
+{
+}
+
+template <typename K, typename V>
+ObjectKeys<js::string, typename object<K, V>::object_type_base> object<K, V>::keys(const object<K, V> &obj)
+{
+    return ObjectKeys<js::string, object<K, V>::object_type_base>(obj->get());
+}
+
+template <typename K, typename V>
+ObjectKeys<js::string, typename object<K, V>::object_type_base> object<K, V>::keys()
+{
+    return ObjectKeys<js::string, object<K, V>::object_type_base>(get());
+}
+
+template <typename K, typename V>
+const any &object<K, V>::operator[](js::number n) const
+{
+    return get().read(K(n.operator tstring()));
+}
+
+template <typename K, typename V>
+any &object<K, V>::operator[](js::number n)
+{
+    return get().dynamic_at(K(n.operator tstring()));
+}
+
+template <typename K, typename V>
+const any &object<K, V>::operator[](const char_t *s) const
+{
+    return get().read(K(s));
+}
+
+template <typename K, typename V>
+const any &object<K, V>::operator[](std::string s) const
+{
+    return get().read(K(s));
+}
+
+template <typename K, typename V>
+const any &object<K, V>::operator[](const js::string &s) const
+{
+    return get().read(s);
+}
+
+template <typename K, typename V>
+any &object<K, V>::operator[](const char_t *s)
+{
+    return get().dynamic_at(K(s));
+}
+
+template <typename K, typename V>
+any &object<K, V>::operator[](std::string s)
+{
+    return get().dynamic_at(K(s));
+}
+
+template <typename K, typename V>
+any &object<K, V>::operator[](const js::string &s)
+{
+    return get().dynamic_at(s);
+}
+
+template <typename K, typename V>
+any &object<K, V>::operator[](undefined_t)
+{
+    return get()[K(TXT("undefined"))];
+}
+
+template <typename K, typename V>
+const any &object<K, V>::operator[](const property_key &key) const
+{
+    return get().read(key.name, key.cache);
+}
+
+template <typename K, typename V>
+any &object<K, V>::operator[](const property_key &key)
+{
+    return get().at(key.name, key.cache);
+}
+
+template <typename K, typename V>
+void object<K, V>::Delete(js::any field)
+{
+    get().erase(field.operator js::string());
+}
+
+} // namespace tmpl
+
+// typeof
+template <>
+string type_of(boolean value)
+{
+    return STR("boolean");
+}
+
+template <>
+string type_of(number value)
+{
+    return STR("number");
+}
+
+template <>
+string type_of(string value)
+{
+    return STR("string");
+}
+
+template <>
+string type_of(object value)
+{
+    return STR("object");
+}
+
+template <>
+string type_of(any value)
+{
+    return value.type_of();
+}
+
+template <class T>
+static any Void(T value)
+{
+    return any();
+}
+
+template <typename I>
+inline bool is(js::any t)
+{
+    if constexpr (has_class_info<I>)
+    {
+        return t.get_type() == any::anyTypeId::class_type && is<I>(t.class_ref());
+    }
+    else
+    {
+        return false;
+    }
+}
+
+template <>
+inline bool is<js::boolean>(js::any t)
+{
+    return t && t.get_type() == any::anyTypeId::boolean_type;
+}
+
+template <>
+inline bool is<js::number>(js::any t)
+{
+    return t && t.get_type() == any::anyTypeId::number_type;
+}
+
+template <>
+inline bool is<js::string>(js::any t)
+{
+    return t && t.get_type() == any::anyTypeId::string_type;
+}
+
+template <>
+inline bool is<js::array_any>(js::any t)
+{
+    return t && t.get_type() == any::anyTypeId::array_type;
+}
+
+template <>
+inline bool is<js::object>(js::any t)
+{
+    return t && t.get_type() == any::anyTypeId::object_type;
+}
+
+template <>
+inline bool is<js::function>(js::any t)
+{
+    return t && t.get_type() == any::anyTypeId::function_type;
+}
+
+namespace utils
+{
+
+struct finally
+{
+private:
+    std::function<void()> _dtor;
+
+public:
+    finally(std::function<void()> dtor) : _dtor(dtor){};
+    ~finally() { _dtor(); }
+};
+
+template <typename... Args>
+object assign(object &dst, const Args &... args)
+{
+    for (auto src : {args...})
+    {
+        for (auto &k : keys_(src))
+        {
+            dst[k] = const_(src)[k];
+        }
+    }
+
+    return dst;
+}
+
+// template literals: one growing buffer instead of a temporary per +
+template <typename... Args>
+string concat(const Args &... args)
+{
+    auto result = string_empty;
+    ((result += args), ...);
+    return result;
+}
+
+// s += a + b + ... lowered by the emitter, appends in place without temporaries
+template <typename D, typename... Args>
+D &append(D &dst, const Args &... args)
+{
+    ((dst += args), ...);
+    return dst;
+}
+
+}; // namespace Utils
+
+template <typename V, class Ax = void> requires has_exists_member<Ax>
+constexpr bool in(V v, const Ax &a)
+{
+    return a.exists(v);
+}
+
+template <typename V, class Ax = void> requires has_exists_member<Ax>
+constexpr bool in(V v, Ax *a)
+{
+    return a->exists(v);
+}
+
+template <typename V, class O>
+constexpr bool in(V v, O o)
+{
+    return false;
+}
+
+} // namespace js
+
+#ifdef UNICODE
+#define MAIN                                                             \
+    int wmain(int argc, char_t **argv)                                   \
+    {                                                                    \
+        try                                                              \
+        {                                                                \
+            Main();                                                      \
+            js::event_loop::current().run();                             \
+        }                                                                \
+        catch (const js::string &s)                                      \
+        {                                                                \
+            js::console.log(TXT("Exception: "), s);                      \
+        }                                                                \
+        catch (const js::any &a)                                         \
+        {                                                                \
+            js::console.log(TXT("Exception: "), a);                      \
+        }                                                                \
+        catch (const std::exception &exception)                          \
+        {                                                                \
+            js::console.log("Exception: ", exception.what());            \
+        }                                                                \
+        catch (const tstring &s)                                         \
+        {                                                                \
+            js::console.log(TXT("Exception: "), s);                      \
+        }                                                                \
+        catch (const char_t *s)                                          \
+        {                                                                \
+            js::console.log(TXT("Exception: "), s);                      \
+        }                                                                \
+        catch (...)                                                      \
+        {                                                                \
+            js::console.log(TXT("General failure."));                    \
+        }                                                                \
+        js::utils::thread_pool::shared().shutdown();                     \
+        js::utils::console_sink::shared().shutdown();                    \
+        JS_STATS_REPORT();                                               \
+        js::utils::trace_events::export_file();                          \
+        return 0;                                                        \
+    }
+#else
+#define MAIN                                                             \
+    int main(int argc, char_t **argv)                                    \
+    {                                                                    \
+        try                                                              \
+        {                                                                \
+            Main();                                                      \
+            js::event_loop::current().run();                             \
+        }                                                                \
+        catch (const js::string &s)                                      \
+        {                                                                \
+            js::console.log(TXT("Exception: "), s);                      \
+        }                                                                \
+        catch (const js::any &a)                                         \
+        {                                                                \
+            js::console.log(TXT("Exception: "), a);                      \
+        }                                                                \
+        catch (const std::exception &exception)                          \
+        {                                                                \
+            js::console.log("Exception: ", exception.what());            \
+        }                                                                \
+        catch (const tstring &s)                                         \
+        {                                                                \
+            js::console.log(TXT("Exception: "), s);                      \
+        }                                                                \
+        catch (const char_t *s)                                          \
+        {                                                                \
+            js::console.log(TXT("Exception: "), s);                      \
+        }                                                                \
+        catch (...)                                                      \
+        {                                                                \
+            js::console.log(TXT("General failure."));                    \
+        }                                                                \
+        js::utils::thread_pool::shared().shutdown();                     \
+        js::utils::console_sink::shared().shutdown();                    \
+        JS_STATS_REPORT();                                               \
+        js::utils::trace_events::export_file();                          \
+        return 0;                                                        \
+    }
+#endif
+
+// JS Core classes
+namespace js
+{
+
+template<class _Fn, class... _Args>
+static auto thread(_Fn f, _Args... args) {
+    return utils::thread_pool::shared().async([=]() mutable { return f(args...); });
+}
+
+static void sleep(js::number n) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<size_t>(n)));
+}
+
+static number parseInt(const js::string &value, int base = 0)
+{
+    auto view = value.view();
+    return number(utils::parse_int(view.data(), view.data() + view.size(), base));
+}
+
+static number parseFloat(const js::string &value)
+{
+    auto view = value.view();
+    return number(utils::parse_float(view.data(), view.data() + view.size()));
+}
+
+// Object statics. Keys come in property order, and the result array is sized once from the key count
+static struct Object_t
+{
+    using entry_type = std::tuple<js::string, any>;
+
+    constexpr Object_t *operator->()
+    {
+        return this;
+    }
+
+    template <typename F>
+    static void for_each(const object &value, F f)
+    {
+        for (auto item : value.get())
+        {
+            f(item.first, item.second);
+        }
+    }
+
+    template <typename F>
+    static void for_each(const any &value, F f)
+    {
+        switch (value.get_type())
+        {
+        case any::anyTypeId::object_type:
+            for_each(value.object_ref_const(), f);
+            break;
+        case any::anyTypeId::class_type:
+            for_each(*mutable_(value).class_ref(), f);
+            break;
+        case any::anyTypeId::array_type:
+        {
+            // holes of a sparse array are not own properties
+            auto &values = mutable_(value).array_ref();
+            for (auto index : values.keys())
+            {
+                f(js::string(to_tstring(index)), values[index]);
+            }
+
+            break;
+        }
+        }
+    }
+
+    template <typename T, typename F> requires std::is_base_of_v<object, T>
+    static void for_each(const std::shared_ptr<T> &value, F f)
+    {
+        for_each(static_cast<const object &>(*value), f);
+    }
+
+    static size_t count(const object &value)
+    {
+        return value.get().size();
+    }
+
+    static size_t count(const any &value)
+    {
+        switch (value.get_type())
+        {
+        case any::anyTypeId::object_type:
+            return value.object_ref_const().get().size();
+        case any::anyTypeId::class_type:
+            return mutable_(value).class_ref()->get().size();
+        case any::anyTypeId::array_type:
+        {
+            auto &storage = mutable_(value).array_ref().storage();
+            return storage.size() + (storage._sparse ? storage._sparse->values.size() : 0);
+        }
+        }
+
+        return 0;
+    }
+
+    template <typename T> requires std::is_base_of_v<object, T>
+    static size_t count(const std::shared_ptr<T> &value)
+    {
+        return value->get().size();
+    }
+
+    template <typename T>
+    static array<js::string> keys(const T &value)
+    {
+        std::vector<js::string> result;
+        result.reserve(count(value));
+        for_each(value, [&](const js::string &key, any &) { result.push_back(key); });
+        return array<js::string>(std::move(result));
+    }
+
+    template <typename T>
+    static array_any values(const T &value)
+    {
+        std::vector<any> result;
+        result.reserve(count(value));
+        for_each(value, [&](const js::string &, any &item) { result.push_back(item); });
+        return array_any(std::move(result));
+    }
+
+    template <typename T>
+    static array<entry_type> entries(const T &value)
+    {
+        std::vector<entry_type> result;
+        result.reserve(count(value));
+        for_each(value, [&](const js::string &key, any &item) { result.emplace_back(key, item); });
+        return array<entry_type>(std::move(result));
+    }
+
+    // own properties of each source, left to right, into target
+    template <typename... Sources>
+    static object assign(object target, const Sources &...sources)
+    {
+        auto &storage = target.get();
+        storage.reserve(storage.size() + (count(sources) + ... + 0));
+        (for_each(sources, [&](const js::string &key, any &item) { storage.dynamic_at(key) = item; }), ...);
+        return target;
+    }
+} Object;
+
+static string String;
+
+template <typename T>
+using ReadonlyArray = tmpl::array<T>;
+
+template <typename T>
+using Array = tmpl::array<T>;
+
+// time value: milliseconds since the epoch in UTC, NaN for an invalid date. Local time follows the time zone of
+// the C library
+struct Date
+{
+    static constexpr double ms_per_day = 86400000.0;
+
+    double _time;
+
+    Date() : _time(static_cast<double>(now()))
+    {
+    }
+
+    // a template, so an integer literal doesn't also match the string constructor through string(char_t)
+    template <typename N> requires ArithmeticOrEnumOrNumber<N>
+    Date(N time) : _time(time_clip(static_cast<double>(time)))
+    {
+    }
+
+    Date(const js::string &text) : _time(static_cast<double>(parse(text)))
+    {
+    }
+
+    Date(js::number year, js::number month, js::number day = 1, js::number hours = 0, js::number minutes = 0,
+         js::number seconds = 0, js::number ms = 0)
+        : _time(time_clip(local_to_utc(make_time(static_cast<double>(year), static_cast<double>(month), static_cast<double>(day),
+                                                 static_cast<double>(hours), static_cast<double>(minutes), static_cast<double>(seconds),
+                                                 static_cast<double>(ms)))))
+    {
+    }
+
+    static js::number now()
+    {
+        using namespace std::chrono;
+        return js::number(static_cast<double>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count()));
+    }
+
+    static js::number UTC(js::number year, js::number month = 0, js::number day = 1, js::number hours = 0, js::number minutes = 0,
+                          js::number seconds = 0, js::number ms = 0)
+    {
+        return js::number(time_clip(make_time(static_cast<double>(year), static_cast<double>(month), static_cast<double>(day),
+                                              static_cast<double>(hours), static_cast<double>(minutes), static_cast<double>(seconds),
+                                              static_cast<double>(ms))));
+    }
+
+    // the ISO 8601 subset of Date.parse: YYYY-MM-DD, optionally THH:mm, :ss, .sss and Z or +HH:mm. A date alone is
+    // UTC, a date and time without an offset is local time
+    static js::number parse(const js::string &text)
+    {
+        auto view = text.view();
+        size_t position = 0;
+        auto digits = [&](size_t count, double &value) {
+            value = 0;
+            for (size_t i = 0; i < count; i++, position++)
+            {
+                if (position >= view.size() || view[position] < TXT('0') || view[position] > TXT('9'))
+                {
+                    return false;
+                }
+
+                value = value * 10 + (view[position] - TXT('0'));
+            }
+
+            return true;
+        };
+        auto skip = [&](char_t c) {
+            if (position < view.size() && view[position] == c)
+            {
+                position++;
+                return true;
+            }
+
+            return false;
+        };
+
+        const auto invalid = js::number(std::numeric_limits<double>::quiet_NaN());
+        double year, month = 1, day = 1, hours = 0, minutes = 0, seconds = 0, ms = 0;
+        if (!digits(4, year) || (skip(TXT('-')) && (!digits(2, month) || (skip(TXT('-')) && !digits(2, day)))))
+        {
+            return invalid;
+        }
+
+        auto hasTime = skip(TXT('T')) || skip(TXT(' '));
+        if (hasTime && (!digits(2, hours) || !skip(TXT(':')) || !digits(2, minutes)
+            || (skip(TXT(':')) && (!digits(2, seconds) || (skip(TXT('.')) && !digits(3, ms))))))
+        {
+            return invalid;
+        }
+
+        auto time = make_time(year, month - 1, day, hours, minutes, seconds, ms);
+        if (skip(TXT('Z')))
+        {
+            hasTime = false;
+        }
+        else if (position < view.size() && (view[position] == TXT('+') || view[position] == TXT('-')))
+        {
+            auto sign = view[position++] == TXT('-') ? -1 : 1;
+            double offsetHours, offsetMinutes;
+            if (!digits(2, offsetHours) || !skip(TXT(':')) || !digits(2, offsetMinutes))
+            {
+                return invalid;
+            }
+
+            time -= sign * (offsetHours * 60 + offsetMinutes) * 60000;
+            hasTime = false;
+        }
+
+        if (position != view.size())
+        {
+            return invalid;
+        }
+
+        return js::number(time_clip(hasTime ? local_to_utc(time) : time));
+    }
+
+    // days from 1970-01-01 to the first of the month, months outside 0..11 roll the year (civil from days, inverted)
+    static double days_from_civil(double year, double month)
+    {
+        auto y = static_cast<std::int64_t>(year + std::floor(month / 12));
+        auto m = static_cast<std::int64_t>(month - std::floor(month / 12) * 12) + 1;
+        y -= m <= 2;
+        auto era = (y >= 0 ? y : y - 399) / 400;
+        auto yoe = y - era * 400;
+        auto doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5;
+        auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return static_cast<double>(era * 146097 + doe - 719468);
+    }
+
+    static double make_time(double year, double month, double day, double hours, double minutes, double seconds, double ms)
+    {
+        if (!std::isfinite(year) || !std::isfinite(month) || !std::isfinite(day) || !std::isfinite(hours)
+            || !std::isfinite(minutes) || !std::isfinite(seconds) || !std::isfinite(ms))
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        auto days = days_from_civil(std::trunc(year), std::trunc(month)) + std::trunc(day) - 1;
+        return days * ms_per_day + ((std::trunc(hours) * 60 + std::trunc(minutes)) * 60 + std::trunc(seconds)) * 1000 + std::trunc(ms);
+    }
+
+    static double time_clip(double time)
+    {
+        return std::isfinite(time) && std::abs(time) <= 8.64e15 ? std::trunc(time) + 0.0 : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // milliseconds to add to UTC for local time at the given UTC time
+    static double local_offset(double time)
+    {
+        if (!std::isfinite(time))
+        {
+            return 0;
+        }
+
+        auto seconds = static_cast<std::time_t>(std::floor(time / 1000));
+        std::tm local{};
+#ifdef _MSC_VER
+        if (localtime_s(&local, &seconds) != 0)
+#else
+        if (!localtime_r(&seconds, &local))
+#endif
+        {
+            return 0;
+        }
+
+        auto localSeconds = make_time(local.tm_year + 1900, local.tm_mon, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec, 0) / 1000;
+        return (localSeconds - static_cast<double>(seconds)) * 1000;
+    }
+
+    static double local_to_utc(double time)
+    {
+        return time - local_offset(time - local_offset(time));
+    }
+
+    struct fields
+    {
+        double year, month, day, hours, minutes, seconds, ms, weekday;
+    };
+
+    static fields split(double time)
+    {
+        auto days = std::floor(time / ms_per_day);
+        auto inDay = time - days * ms_per_day;
+
+        // days to civil
+        auto z = static_cast<std::int64_t>(days) + 719468;
+        auto era = (z >= 0 ? z : z - 146096) / 146097;
+        auto doe = z - era * 146097;
+        auto yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        auto doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        auto mp = (5 * doy + 2) / 153;
+        auto d = doy - (153 * mp + 2) / 5 + 1;
+        auto m = mp < 10 ? mp + 3 : mp - 9;
+        auto y = yoe + era * 400 + (m <= 2);
+
+        auto weekday = std::fmod(days + 4, 7);
+        return fields{static_cast<double>(y), static_cast<double>(m - 1), static_cast<double>(d),
+                      std::floor(inDay / 3600000), std::fmod(std::floor(inDay / 60000), 60), std::fmod(std::floor(inDay / 1000), 60),
+                      std::fmod(inDay, 1000), weekday < 0 ? weekday + 7 : weekday};
+    }
+
+    fields local() const
+    {
+        return split(_time + local_offset(_time));
+    }
+
+    fields utc() const
+    {
+        return split(_time);
+    }
+
+    template <typename F>
+    js::number get(F field) const
+    {
+        return std::isnan(_time) ? js::number(std::numeric_limits<double>::quiet_NaN()) : js::number(field());
+    }
+
+    js::number getTime()
+    {
+        return js::number(_time);
+    }
+
+    js::number valueOf()
+    {
+        return js::number(_time);
+    }
+
+    js::number setTime(js::number time)
+    {
+        _time = time_clip(static_cast<double>(time));
+        return js::number(_time);
+    }
+
+    js::number getTimezoneOffset()
+    {
+        return get([&] { return 0.0 - local_offset(_time) / 60000; });
+    }
+
+    js::number getFullYear()
+    {
+        return get([&] { return local().year; });
+    }
+
+    js::number getMonth()
+    {
+        return get([&] { return local().month; });
+    }
+
+    js::number getDate()
+    {
+        return get([&] { return local().day; });
+    }
+
+    js::number getDay()
+    {
+        return get([&] { return local().weekday; });
+    }
+
+    js::number getHours()
+    {
+        return get([&] { return local().hours; });
+    }
+
+    js::number getMinutes()
+    {
+        return get([&] { return local().minutes; });
+    }
+
+    js::number getSeconds()
+    {
+        return get([&] { return local().seconds; });
+    }
+
+    js::number getMilliseconds()
+    {
+        return get([&] { return local().ms; });
+    }
+
+    js::number getUTCFullYear()
+    {
+        return get([&] { return utc().year; });
+    }
+
+    js::number getUTCMonth()
+    {
+        return get([&] { return utc().month; });
+    }
+
+    js::number getUTCDate()
+    {
+        return get([&] { return utc().day; });
+    }
+
+    js::number getUTCDay()
+    {
+        return get([&] { return utc().weekday; });
+    }
+
+    js::number getUTCHours()
+    {
+        return get([&] { return utc().hours; });
+    }
+
+    js::number getUTCMinutes()
+    {
+        return get([&] { return utc().minutes; });
+    }
+
+    js::number getUTCSeconds()
+    {
+        return get([&] { return utc().seconds; });
+    }
+
+    js::number getUTCMilliseconds()
+    {
+        return get([&] { return utc().ms; });
+    }
+
+    js::string toISOString()
+    {
+        if (std::isnan(_time))
+        {
+            throw "RangeError: Invalid time value";
+        }
+
+        auto value = utc();
+        char buffer[48];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", static_cast<int>(value.year),
+                      static_cast<int>(value.month) + 1, static_cast<int>(value.day), static_cast<int>(value.hours),
+                      static_cast<int>(value.minutes), static_cast<int>(value.seconds), static_cast<int>(value.ms));
+        return js::string(tstring(buffer, buffer + std::strlen(buffer)));
+    }
+
+    js::string toJSON()
+    {
+        return toISOString();
+    }
+
+    js::string toString()
+    {
+        if (std::isnan(_time))
+        {
+            return js::string(TXT("Invalid Date"));
+        }
+
+        constexpr const char *days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        constexpr const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        auto value = local();
+        auto offset = static_cast<int>(local_offset(_time) / 60000);
+        auto absolute = offset < 0 ? -offset : offset;
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%s %s %02d %04d %02d:%02d:%02d GMT%c%02d%02d", days[static_cast<int>(value.weekday)],
+                      months[static_cast<int>(value.month)], static_cast<int>(value.day), static_cast<int>(value.year),
+                      static_cast<int>(value.hours), static_cast<int>(value.minutes), static_cast<int>(value.seconds),
+                      offset < 0 ? '-' : '+', absolute / 60, absolute % 60);
+        return js::string(tstring(buffer, buffer + std::strlen(buffer)));
+    }
+
+    friend tostream &operator<<(tostream &os, const Date &date)
+    {
+        return os << mutable_(date).toString();
+    }
+};
+
+typedef any Action;
+
+typedef any Function;
+
+// one match: offset and length of the whole match and of every group, npos for groups that did not take part
+struct regexp_match
+{
+    std::vector<std::pair<size_t, size_t>> groups;
+
+    size_t start() const
+    {
+        return groups[0].first;
+    }
+
+    size_t end() const
+    {
+        return groups[0].first + groups[0].second;
+    }
+};
+
+// compiled pattern shared by every RegExp made from the same source and flags
+struct regexp_program
+{
+    using view_type = js::string::view_type;
+
+    js::string source;
+    js::string flags;
+    bool global;
+    bool ignore_case;
+    bool multiline;
+    bool sticky;
+
+    regexp_program(const js::string &source_, const js::string &flags_) : source(source_), flags(flags_)
+    {
+        auto view = flags.view();
+        global = view.find(TXT('g')) != view_type::npos;
+        ignore_case = view.find(TXT('i')) != view_type::npos;
+        multiline = view.find(TXT('m')) != view_type::npos;
+        sticky = view.find(TXT('y')) != view_type::npos;
+    }
+
+    virtual ~regexp_program()
+    {
+    }
+
+    // first match starting at or after start, or exactly at start when anchored
+    virtual bool search(view_type subject, size_t start, bool anchored, regexp_match &match) const = 0;
+};
+
+// patterns without metacharacters are plain substring searches
+struct regexp_literal_program : public regexp_program
+{
+    regexp_literal_program(const js::string &source_, const js::string &flags_) : regexp_program(source_, flags_)
+    {
+    }
+
+    static bool accepts(view_type source, bool ignore_case)
+    {
+        return !ignore_case && source.find_first_of(TXT("\\^$.|?*+()[]{}/")) == view_type::npos;
+    }
+
+    bool search(view_type subject, size_t start, bool anchored, regexp_match &match) const override
+    {
+        auto needle = source.view();
+        auto found = anchored
+            ? (subject.substr(start, needle.size()) == needle ? start : view_type::npos)
+            : subject.find(needle, start);
+        if (found == view_type::npos)
+        {
+            return false;
+        }
+
+        match.groups.assign(1, {found, needle.size()});
+        return true;
+    }
+};
+
+struct regexp_std_program : public regexp_program
+{
+#ifdef UNICODE
+    std::wregex re;
+#else
+    std::regex re;
+#endif
+
+    regexp_std_program(const js::string &source_, const js::string &flags_) : regexp_program(source_, flags_)
+    {
+        auto options = std::regex_constants::ECMAScript;
+        if (ignore_case)
+        {
+            options |= std::regex_constants::icase;
+        }
+
+        if (multiline)
+        {
+            options |= std::regex_constants::multiline;
+        }
+
+        auto view = source.view();
+        try
+        {
+            re.assign(view.data(), view.size(), options);
+        }
+        catch (const std::regex_error &)
+        {
+            throw "Invalid regular expression";
+        }
+    }
+
+    bool search(view_type subject, size_t start, bool anchored, regexp_match &match) const override
+    {
+        std::match_results<view_type::const_iterator> result;
+        auto options = start > 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+        if (anchored)
+        {
+            options |= std::regex_constants::match_continuous;
+        }
+
+        if (!std::regex_search(subject.begin() + start, subject.end(), result, re, options))
+        {
+            return false;
+        }
+
+        match.groups.resize(result.size());
+        for (size_t index = 0; index < result.size(); index++)
+        {
+            match.groups[index] = result[index].matched
+                ? std::pair<size_t, size_t>(result[index].first - subject.begin(), result[index].length())
+                : std::pair<size_t, size_t>(view_type::npos, 0);
+        }
+
+        return true;
+    }
+};
+
+// hook for a faster engine (PCRE2 JIT, a DFA...): return nullptr to leave a pattern to the built-in backends
+using regexp_factory = std::shared_ptr<const regexp_program> (*)(const js::string &source, const js::string &flags);
+inline regexp_factory regexp_backend = nullptr;
+
+static std::shared_ptr<const regexp_program> compile_regexp(const js::string &source, const js::string &flags)
+{
+    if (regexp_backend)
+    {
+        if (auto program = regexp_backend(source, flags))
+        {
+            return program;
+        }
+    }
+
+    if (regexp_literal_program::accepts(source.view(), flags.view().find(TXT('i')) != tstring::npos))
+    {
+        return std::make_shared<regexp_literal_program>(source, flags);
+    }
+
+    return std::make_shared<regexp_std_program>(source, flags);
+}
+
+// programs for new RegExp(s) by flags and source, the least recently used is dropped first
+struct regexp_cache
+{
+    static constexpr size_t capacity = 128;
+
+    using entry = std::pair<tstring, std::shared_ptr<const regexp_program>>;
+
+    std::mutex _mutex;
+    std::list<entry> _entries;
+    std::unordered_map<tstring, std::list<entry>::iterator> _index;
+
+    static regexp_cache &shared()
+    {
+        static regexp_cache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const regexp_program> get(const js::string &source, const js::string &flags)
+    {
+        tstring key(flags.view());
+        key += TXT('/');
+        key += source.view();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _index.find(key);
+        if (found != _index.end())
+        {
+            _entries.splice(_entries.begin(), _entries, found->second);
+            return found->second->second;
+        }
+
+        auto program = compile_regexp(source, flags);
+        _entries.emplace_front(key, program);
+        _index.emplace(std::move(key), _entries.begin());
+        if (_entries.size() > capacity)
+        {
+            _index.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+
+        return program;
+    }
+};
+
+// matched text and groups, the strings are slices of the input
+struct RegExpExecArray : public tmpl::array<js::string>
+{
+    js::number index;
+    js::string input;
+
+    RegExpExecArray(std::vector<js::string> values, js::number index_, const js::string &input_)
+        : tmpl::array<js::string>(values), index(index_), input(input_)
+    {
+    }
+};
+
+typedef RegExpExecArray RegExpMatchArray;
+
+struct RegExp
+{
+    using view_type = regexp_program::view_type;
+
+    std::shared_ptr<const regexp_program> _program;
+    js::string source;
+    js::string flags;
+    js::boolean global;
+    js::number lastIndex;
+
+    RegExp(std::shared_ptr<const regexp_program> program)
+        : _program(std::move(program)), source(_program->source), flags(_program->flags), global(_program->global), lastIndex(0)
+    {
+    }
+
+    RegExp(const js::string &pattern) : RegExp(regexp_cache::shared().get(pattern, string_empty))
+    {
+    }
+
+    RegExp(const js::string &pattern, const js::string &flags_) : RegExp(regexp_cache::shared().get(pattern, flags_))
+    {
+    }
+
+    js::boolean test(js::string value)
+    {
+        regexp_match match;
+        return next(value, match);
+    }
+
+    std::shared_ptr<RegExpExecArray> exec(js::string value)
+    {
+        regexp_match match;
+        if (!next(value, match))
+        {
+            return nullptr;
+        }
+
+        return result(value, match);
+    }
+
+    // String.prototype.match
+    std::shared_ptr<RegExpMatchArray> match_string(const js::string &value)
+    {
+        if (!_program->global)
+        {
+            return exec(value);
+        }
+
+        std::vector<js::string> found;
+        each(value, [&](const regexp_match &match) {
+            found.push_back(value.sub(match.start(), match.groups[0].second));
+            return true;
+        });
+
+        lastIndex = 0;
+        if (found.empty())
+        {
+            return nullptr;
+        }
+
+        return std::make_shared<RegExpMatchArray>(found, js::number(-1), value);
+    }
+
+    js::number search_string(const js::string &value)
+    {
+        regexp_match match;
+        return _program->search(value.view(), 0, _program->sticky, match) ? js::number(match.start()) : js::number(-1);
+    }
+
+    // $$, $&, $`, $' and $1..$99 in the replacement; a callable gets the matched text
+    template <typename W>
+    js::string replace_string(const js::string &value, W replacement)
+    {
+        auto subject = value.view();
+        js::string result;
+        size_t last = 0;
+        auto replaced = false;
+        each(value, [&](const regexp_match &match) {
+            result.append(subject.substr(last, match.start() - last));
+            if constexpr (std::is_invocable_v<W &, js::string>)
+            {
+                result.append(js::string(replacement(value.sub(match.start(), match.groups[0].second))).view());
+            }
+            else
+            {
+                expand(result, js::string(replacement).view(), subject, match);
+            }
+
+            last = match.end();
+            replaced = true;
+            return static_cast<bool>(_program->global);
+        });
+
+        if (_program->global)
+        {
+            lastIndex = 0;
+        }
+
+        if (!replaced)
+        {
+            return value;
+        }
+
+        result.append(subject.substr(last));
+        return result;
+    }
+
+    tmpl::array<js::string> split_string(const js::string &value)
+    {
+        auto subject = value.view();
+        std::vector<js::string> parts;
+        regexp_match match;
+        if (subject.empty())
+        {
+            if (!_program->search(subject, 0, false, match))
+            {
+                parts.push_back(value);
+            }
+
+            return parts;
+        }
+
+        size_t last = 0;
+        size_t from = 0;
+        while (from < subject.size() && _program->search(subject, from, false, match))
+        {
+            if (match.start() >= subject.size())
+            {
+                break;
+            }
+
+            if (match.end() == last || (match.groups[0].second == 0 && match.start() == last))
+            {
+                from = match.start() + 1;
+                continue;
+            }
+
+            parts.push_back(value.sub(last, match.start() - last));
+            for (size_t group = 1; group < match.groups.size(); group++)
+            {
+                parts.push_back(match.groups[group].first == view_type::npos
+                    ? js::string()
+                    : value.sub(match.groups[group].first, match.groups[group].second));
+            }
+
+            last = match.end();
+            from = match.groups[0].second == 0 ? last + 1 : last;
+        }
+
+        parts.push_back(value.sub(last, subject.size() - last));
+        return parts;
+    }
+
+private:
+    // exec and test: from lastIndex for global and sticky patterns, which then move it past the match
+    bool next(const js::string &value, regexp_match &match)
+    {
+        auto subject = value.view();
+        auto stateful = _program->global || _program->sticky;
+        auto start = stateful ? static_cast<size_t>(lastIndex) : 0;
+        if (start > subject.size() || !_program->search(subject, start, _program->sticky, match))
+        {
+            if (stateful)
+            {
+                lastIndex = 0;
+            }
+
+            return false;
+        }
+
+        if (stateful)
+        {
+            lastIndex = js::number(match.end());
+        }
+
+        return true;
+    }
+
+    std::shared_ptr<RegExpExecArray> result(const js::string &value, const regexp_match &match)
+    {
+        std::vector<js::string> values;
+        for (auto &group : match.groups)
+        {
+            values.push_back(group.first == view_type::npos ? js::string() : value.sub(group.first, group.second));
+        }
+
+        return std::make_shared<RegExpExecArray>(values, js::number(match.start()), value);
+    }
+
+    // every match left to right while f returns true, empty matches step over one character
+    template <typename F>
+    void each(const js::string &value, F f)
+    {
+        auto subject = value.view();
+        regexp_match match;
+        size_t from = 0;
+        while (from <= subject.size() && _program->search(subject, from, _program->sticky, match))
+        {
+            if (!f(match))
+            {
+                break;
+            }
+
+            from = match.groups[0].second == 0 ? match.end() + 1 : match.end();
+        }
+    }
+
+    static void expand(js::string &result, view_type replacement, view_type subject, const regexp_match &match)
+    {
+        size_t last = 0;
+        for (size_t i = 0; i + 1 < replacement.size(); i++)
+        {
+            if (replacement[i] != TXT('$'))
+            {
+                continue;
+            }
+
+            auto next = replacement[i + 1];
+            view_type insert;
+            auto length = size_t(2);
+            if (next == TXT('$'))
+            {
+                insert = view_type(TXT("$"), 1);
+            }
+            else if (next == TXT('&'))
+            {
+                insert = subject.substr(match.start(), match.groups[0].second);
+            }
+            else if (next == TXT('`'))
+            {
+                insert = subject.substr(0, match.start());
+            }
+            else if (next == TXT('\''))
+            {
+                insert = subject.substr(match.end());
+            }
+            else if (next >= TXT('0') && next <= TXT('9'))
+            {
+                auto group = static_cast<size_t>(next - TXT('0'));
+                if (i + 2 < replacement.size() && replacement[i + 2] >= TXT('0') && replacement[i + 2] <= TXT('9')
+                    && group * 10 + (replacement[i + 2] - TXT('0')) < match.groups.size())
+                {
+                    group = group * 10 + (replacement[i + 2] - TXT('0'));
+                    length = 3;
+                }
+
+                if (group == 0 || group >= match.groups.size())
+                {
+                    continue;
+                }
+
+                if (match.groups[group].first != view_type::npos)
+                {
+                    insert = subject.substr(match.groups[group].first, match.groups[group].second);
+                }
+            }
+            else
+            {
+                continue;
+            }
+
+            result.append(replacement.substr(last, i - last));
+            result.append(insert);
+            last = i + length;
+            i += length - 1;
+        }
+
+        result.append(replacement.substr(last));
+    }
+};
+
+// regular expression literals are compiled once per site, the first time it runs
+#define REGEXP(pattern, flags) \
+    (std::make_shared<js::RegExp>([]() -> const std::shared_ptr<const js::regexp_program> & { \
+        static const auto program = js::compile_regexp(STR(pattern), STR(flags)); \
+        return program; \
+    }()))
+
+// vectorized loops over contiguous memory used by the typed arrays. The widest instruction set of the CPU is picked
+// once, at the first call. float and double use explicit kernels; other element types use plain loops that the
+// compiler vectorizes. sum adds lanes in parallel, so its rounding may differ from a left to right loop
+namespace simd
+{
+
+#if defined(JS_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define JS_SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define JS_SIMD_TARGET_AVX2
+#endif
+
+#define JS_SIMD_TARGET_BASELINE
+
+enum class isa
+{
+    scalar,
+    sse2,
+    avx2,
+    neon
+};
+
+inline isa detect()
+{
+#if defined(JS_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        auto avx2 = (info[1] & (1 << 5)) != 0;
+        __cpuid(info, 1);
+        auto fma = (info[2] & (1 << 12)) != 0;
+        auto osxsave = (info[2] & (1 << 27)) != 0;
+        if (avx2 && fma && osxsave && (_xgetbv(0) & 6) == 6)
+        {
+            return isa::avx2;
+        }
+    }
+
+    return isa::sse2;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? isa::avx2 : isa::sse2;
+#endif
+#elif defined(JS_SIMD_NEON)
+    return isa::neon;
+#else
+    return isa::scalar;
+#endif
+}
+
+inline isa current()
+{
+    static const isa value = detect();
+    return value;
+}
+
+template <typename T>
+struct scalar
+{
+    using value_type = T;
+    using reg = T;
+    static constexpr size_t width = 1;
+
+    static inline reg load(const T *p) { return *p; }
+    static inline void store(T *p, reg r) { *p = r; }
+    static inline reg set1(T v) { return v; }
+    static inline reg add(reg a, reg b) { return a + b; }
+    static inline reg mul(reg a, reg b) { return a * b; }
+    static inline reg fma(reg a, reg b, reg c) { return a * b + c; }
+    static inline reg min(reg a, reg b) { return b < a ? b : a; }
+    static inline reg max(reg a, reg b) { return b > a ? b : a; }
+    static inline int eq(reg a, reg b) { return a == b ? 1 : 0; }
+};
+
+#if defined(JS_SIMD_X86)
+struct sse2_f32
+{
+    using value_type = float;
+    using reg = __m128;
+    static constexpr size_t width = 4;
+
+    static inline reg load(const float *p) { return _mm_loadu_ps(p); }
+    static inline void store(float *p, reg r) { _mm_storeu_ps(p, r); }
+    static inline reg set1(float v) { return _mm_set1_ps(v); }
+    static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+    static inline reg fma(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static inline reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+    static inline reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+    static inline int eq(reg a, reg b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+};
+
+struct sse2_f64
+{
+    using value_type = double;
+    using reg = __m128d;
+    static constexpr size_t width = 2;
+
+    static inline reg load(const double *p) { return _mm_loadu_pd(p); }
+    static inline void store(double *p, reg r) { _mm_storeu_pd(p, r); }
+    static inline reg set1(double v) { return _mm_set1_pd(v); }
+    static inline reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static inline reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+    static inline reg fma(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static inline reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+    static inline reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+    static inline int eq(reg a, reg b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+};
+
+struct avx2_f32
+{
+    using value_type = float;
+    using reg = __m256;
+    static constexpr size_t width = 8;
+
+    JS_SIMD_TARGET_AVX2 static inline reg load(const float *p) { return _mm256_loadu_ps(p); }
+    JS_SIMD_TARGET_AVX2 static inline void store(float *p, reg r) { _mm256_storeu_ps(p, r); }
+    JS_SIMD_TARGET_AVX2 static inline reg set1(float v) { return _mm256_set1_ps(v); }
+    JS_SIMD_TARGET_AVX2 static inline reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline reg fma(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+    JS_SIMD_TARGET_AVX2 static inline reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline int eq(reg a, reg b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+};
+
+struct avx2_f64
+{
+    using value_type = double;
+    using reg = __m256d;
+    static constexpr size_t width = 4;
+
+    JS_SIMD_TARGET_AVX2 static inline reg load(const double *p) { return _mm256_loadu_pd(p); }
+    JS_SIMD_TARGET_AVX2 static inline void store(double *p, reg r) { _mm256_storeu_pd(p, r); }
+    JS_SIMD_TARGET_AVX2 static inline reg set1(double v) { return _mm256_set1_pd(v); }
+    JS_SIMD_TARGET_AVX2 static inline reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline reg fma(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+    JS_SIMD_TARGET_AVX2 static inline reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+    JS_SIMD_TARGET_AVX2 static inline int eq(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+};
+#endif
+
+#if defined(JS_SIMD_NEON)
+struct neon_f32
+{
+    using value_type = float;
+    using reg = float32x4_t;
+    static constexpr size_t width = 4;
+
+    static inline reg load(const float *p) { return vld1q_f32(p); }
+    static inline void store(float *p, reg r) { vst1q_f32(p, r); }
+    static inline reg set1(float v) { return vdupq_n_f32(v); }
+    static inline reg add(reg a, reg b) { return vaddq_f32(a, b); }
+    static inline reg mul(reg a, reg b) { return vmulq_f32(a, b); }
+    static inline reg fma(reg a, reg b, reg c) { return vmlaq_f32(c, a, b); }
+    static inline reg min(reg a, reg b) { return vminq_f32(a, b); }
+    static inline reg max(reg a, reg b) { return vmaxq_f32(a, b); }
+    static inline int eq(reg a, reg b)
+    {
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vceqq_f32(a, b));
+        return (lanes[0] & 1) | (lanes[1] & 2) | (lanes[2] & 4) | (lanes[3] & 8);
+    }
+};
+#endif
+
+// the same loops for every instruction set, TARGET lets the compiler use the instructions of V in them
+#define JS_SIMD_KERNELS(NAME, TARGET)                                                               \
+    struct NAME                                                                                     \
+    {                                                                                               \
+        template <typename V, typename T>                                                           \
+        TARGET static void add(const T *a, const T *b, T *out, size_t n)                            \
+        {                                                                                           \
+            size_t i = 0;                                                                           \
+            for (; i + V::width <= n; i += V::width)                                                \
+                V::store(out + i, V::add(V::load(a + i), V::load(b + i)));                          \
+            for (; i < n; i++)                                                                      \
+                out[i] = a[i] + b[i];                                                               \
+        }                                                                                           \
+                                                                                                    \
+        template <typename V, typename T>                                                           \
+        TARGET static void mul(const T *a, const T *b, T *out, size_t n)                            \
+        {                                                                                           \
+            size_t i = 0;                                                                           \
+            for (; i + V::width <= n; i += V::width)                                                \
+                V::store(out + i, V::mul(V::load(a + i), V::load(b + i)));                          \
+            for (; i < n; i++)                                                                      \
+                out[i] = a[i] * b[i];                                                               \
+        }                                                                                           \
+                                                                                                    \
+        template <typename V, typename T>                                                           \
+        TARGET static void fma(const T *a, const T *b, const T *c, T *out, size_t n)                \
+        {                                                                                           \
+            size_t i = 0;                                                                           \
+            for (; i + V::width <= n; i += V::width)                                                \
+                V::store(out + i, V::fma(V::load(a + i), V::load(b + i), V::load(c + i)));          \
+            for (; i < n; i++)                                                                      \
+                out[i] = a[i] * b[i] + c[i];                                                        \
+        }                                                                                           \
+                                                                                                    \
+        template <typename V, typename T>                                                           \
+        TARGET static void fill(T *out, T value, size_t n)                                          \
+        {                                                                                           \
+            size_t i = 0;                                                                           \
+            auto v = V::set1(value);                                                                \
+            for (; i + V::width <= n; i += V::width)                                                \
+                V::store(out + i, v);                                                               \
+            for (; i < n; i++)                                                                      \
+                out[i] = value;                                                                     \
+        }                                                                                           \
+                                                                                                    \
+        template <typename V, typename T>                                                           \
+        TARGET static T sum(const T *a, size_t n)                                                   \
+        {                                                                                           \
+            size_t i = 0;                                                                           \
+            T result = 0;                                                                           \
+            if (n >= V::width)                                                                      \
+            {                                                                                       \
+                auto acc = V::set1(0);                                                              \
+                for (; i + V::width <= n; i += V::width)                                            \
+                    acc = V::add(acc, V::load(a + i));                                              \
+                T lanes[V::width];                                                                  \
+                V::store(lanes, acc);                                                               \
+                for (auto lane : lanes)                                                             \
+                    result += lane;                                                                 \
+            }                                                                                       \
+            for (; i < n; i++)                                                                      \
+                result += a[i];                                                                     \
+            return result;                                                                          \
+        }                                                                                           \
+                                                                                                    \
+        /* NaN anywhere gives NaN as Math.min does, n > 0 */                                        \
+        template <typename V, typename T, bool Max>                                                 \
+        TARGET static T extreme(const T *a, size_t n)                                               \
+        {                                                                                           \
+            constexpr auto all = (1 << V::width) - 1;                                               \
+            size_t i = 0;                                                                           \
+            T result = a[0];                                                                        \
+            if (n >= V::width)                                                                      \
+            {                                                                                       \
+                auto acc = V::load(a);                                                              \
+                for (; i + V::width <= n; i += V::width)                                            \
+                {                                                                                   \
+                    auto v = V::load(a + i);                                                        \
+                    if (V::eq(v, v) != all)                                                         \
+                        return std::numeric_limits<T>::quiet_NaN();                                 \
+                    acc = Max ? V::max(acc, v) : V::min(acc, v);                                    \
+                }                                                                                   \
+                T lanes[V::width];                                                                  \
+                V::store(lanes, acc);                                                               \
+                for (auto lane : lanes)                                                             \
+                    result = Max ? (lane > result ? lane : result) : (lane < result ? lane : result); \
+            }                                                                                       \
+            for (; i < n; i++)                                                                      \
+            {                                                                                       \
+                if (a[i] != a[i])                                                                   \
+                    return std::numeric_limits<T>::quiet_NaN();                                     \
+                result = Max ? (a[i] > result ? a[i] : result) : (a[i] < result ? a[i] : result);  \
+            }                                                                                       \
+            return result;                                                                          \
+        }                                                                                           \
+                                                                                                    \
+        template <typename V, typename T>                                                           \
+        TARGET static size_t index_of(const T *a, T value, size_t first, size_t n)                  \
+        {                                                                                           \
+            size_t i = first;                                                                       \
+            auto v = V::set1(value);                                                                \
+            for (; i + V::width <= n; i += V::width)                                                \
+            {                                                                                       \
+                auto mask = V::eq(V::load(a + i), v);                                               \
+                if (mask)                                                                           \
+                {                                                                                   \
+                    auto lane = size_t(0);                                                          \
+                    while (!(mask & (1 << lane)))                                                   \
+                        lane++;                                                                     \
+                    return i + lane;                                                                \
+                }                                                                                   \
+            }                                                                                       \
+            for (; i < n; i++)                                                                      \
+                if (a[i] == value)                                                                  \
+                    return i;                                                                       \
+            return n;                                                                               \
+        }                                                                                           \
+    };
+
+JS_SIMD_KERNELS(baseline_kernels, JS_SIMD_TARGET_BASELINE)
+JS_SIMD_KERNELS(avx2_kernels, JS_SIMD_TARGET_AVX2)
+
+// f(kernels, traits) with the best kernels for T on this CPU
+template <typename T, typename F>
+inline auto dispatch(F &&f)
+{
+#if defined(JS_SIMD_X86)
+    if constexpr (std::is_same_v<T, float>)
+    {
+        if (current() == isa::avx2)
+        {
+            return f(avx2_kernels(), avx2_f32());
+        }
+
+        return f(baseline_kernels(), sse2_f32());
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        if (current() == isa::avx2)
+        {
+            return f(avx2_kernels(), avx2_f64());
+        }
+
+        return f(baseline_kernels(), sse2_f64());
+    }
+    else
+#elif defined(JS_SIMD_NEON)
+    if constexpr (std::is_same_v<T, float>)
+    {
+        return f(baseline_kernels(), neon_f32());
+    }
+    else
+#endif
+    {
+        return f(baseline_kernels(), scalar<T>());
+    }
+}
+
+template <typename T>
+inline void add(const T *a, const T *b, T *out, size_t n)
+{
+    dispatch<T>([&](auto k, auto v) { decltype(k)::template add<decltype(v)>(a, b, out, n); });
+}
+
+template <typename T>
+inline void mul(const T *a, const T *b, T *out, size_t n)
+{
+    dispatch<T>([&](auto k, auto v) { decltype(k)::template mul<decltype(v)>(a, b, out, n); });
+}
+
+template <typename T>
+inline void fma(const T *a, const T *b, const T *c, T *out, size_t n)
+{
+    dispatch<T>([&](auto k, auto v) { decltype(k)::template fma<decltype(v)>(a, b, c, out, n); });
+}
+
+template <typename T>
+inline void fill(T *out, T value, size_t n)
+{
+    dispatch<T>([&](auto k, auto v) { decltype(k)::template fill<decltype(v)>(out, value, n); });
+}
+
+template <typename T>
+inline T sum(const T *a, size_t n)
+{
+    return dispatch<T>([&](auto k, auto v) { return decltype(k)::template sum<decltype(v)>(a, n); });
+}
+
+template <typename T>
+inline T min(const T *a, size_t n)
+{
+    return dispatch<T>([&](auto k, auto v) { return decltype(k)::template extreme<decltype(v), T, false>(a, n); });
+}
+
+template <typename T>
+inline T max(const T *a, size_t n)
+{
+    return dispatch<T>([&](auto k, auto v) { return decltype(k)::template extreme<decltype(v), T, true>(a, n); });
+}
+
+// n when not found
+template <typename T>
+inline size_t index_of(const T *a, T value, size_t first, size_t n)
+{
+    return dispatch<T>([&](auto k, auto v) { return decltype(k)::template index_of<decltype(v)>(a, value, first, n); });
+}
+
+} // namespace simd
+
+// zero filled, aligned memory shared by every view created on it
+struct ArrayBuffer
+{
+    static constexpr size_t alignment = 16;
+
+    std::shared_ptr<std::uint8_t> _data;
+    js::number byteLength;
+
+    ArrayBuffer(js::number byteLength_) : byteLength(byteLength_)
+    {
+        auto size = static_cast<size_t>(byteLength_);
+        auto data = static_cast<std::uint8_t *>(::operator new[](size > 0 ? size : 1, std::align_val_t(alignment)));
+        std::memset(data, 0, size);
+        _data = std::shared_ptr<std::uint8_t>(data, [](std::uint8_t *p) { ::operator delete[](p, std::align_val_t(alignment)); });
+    }
+
+    std::uint8_t *data() const
+    {
+        return _data.get();
+    }
+
+    size_t size() const
+    {
+        return static_cast<size_t>(mutable_(byteLength));
+    }
+
+    std::shared_ptr<ArrayBuffer> slice(js::number begin)
+    {
+        return slice(begin, byteLength);
+    }
+
+    std::shared_ptr<ArrayBuffer> slice(js::number begin, js::number end)
+    {
+        auto first = std::min(static_cast<size_t>(begin), size());
+        auto last = std::max(first, std::min(static_cast<size_t>(end), size()));
+        auto result = std::make_shared<ArrayBuffer>(js::number(last - first));
+        std::memcpy(result->data(), data() + first, last - first);
+        return result;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const ArrayBuffer &)
+    {
+        return os << "[object ArrayBuffer]";
+    }
+};
+
+struct ArrayBufferView
+{
+    std::shared_ptr<ArrayBuffer> buffer;
+    js::number byteOffset;
+    js::number byteLength;
+
+    ArrayBufferView(std::shared_ptr<ArrayBuffer> buffer_, size_t byteOffset_, size_t byteLength_)
+        : buffer(std::move(buffer_)), byteOffset(byteOffset_), byteLength(byteLength_)
+    {
+        if (byteOffset_ + byteLength_ > buffer->size())
+        {
+            throw "out of range";
+        }
+    }
+
+    std::uint8_t *bytes() const
+    {
+        return buffer->data() + static_cast<size_t>(mutable_(byteOffset));
+    }
+};
+
+// view over an ArrayBuffer, elements are read and written in place without bounds checks
+template <typename T>
+struct TypedArray : public ArrayBufferView
+{
+    js::number length;
+    T *_data;
+
+    TypedArray(js::number length_) : TypedArray(std::make_shared<ArrayBuffer>(js::number(static_cast<size_t>(length_) * sizeof(T))))
+    {
+    }
+
+    TypedArray(std::shared_ptr<ArrayBuffer> buffer_) : TypedArray(buffer_, 0, buffer_->size() / sizeof(T))
+    {
+    }
+
+    TypedArray(std::shared_ptr<ArrayBuffer> buffer_, js::number byteOffset_)
+        : TypedArray(buffer_, byteOffset_, (buffer_->size() - std::min(buffer_->size(), static_cast<size_t>(byteOffset_))) / sizeof(T))
+    {
+    }
+
+    TypedArray(std::shared_ptr<ArrayBuffer> buffer_, js::number byteOffset_, js::number length_)
+        : ArrayBufferView(buffer_, static_cast<size_t>(byteOffset_), static_cast<size_t>(length_) * sizeof(T)), length(length_)
+    {
+        if (static_cast<size_t>(byteOffset_) % alignof(T) != 0)
+        {
+            throw "start offset should be a multiple of the element size";
+        }
+
+        _data = reinterpret_cast<T *>(bytes());
+    }
+
+    template <typename E>
+    TypedArray(const tmpl::array<E> &values) : TypedArray(js::number(values.get().size()))
+    {
+        set(values);
+    }
+
+    inline size_t size() const
+    {
+        return static_cast<size_t>(mutable_(length));
+    }
+
+    inline T *data() const
+    {
+        return _data;
+    }
+
+    inline T *begin() const
+    {
+        return _data;
+    }
+
+    inline T *end() const
+    {
+        return _data + size();
+    }
+
+    template <typename N = void> requires can_cast_to_size_t<N>
+    inline T &operator[](N index)
+    {
+        return _data[static_cast<size_t>(index)];
+    }
+
+    template <typename N = void> requires can_cast_to_size_t<N>
+    inline const T &operator[](N index) const
+    {
+        return _data[static_cast<size_t>(index)];
+    }
+
+    template <typename E>
+    void set(const tmpl::array<E> &values, js::number offset = 0)
+    {
+        auto &items = values.get();
+        auto first = static_cast<size_t>(offset);
+        if (first + items.size() > size())
+        {
+            throw "out of range";
+        }
+
+        for (size_t index = 0; index < items.size(); index++)
+        {
+            _data[first + index] = to_element(static_cast<double>(mutable_(items[index])));
+        }
+    }
+
+    template <typename U>
+    void set(const std::shared_ptr<TypedArray<U>> &values, js::number offset = 0)
+    {
+        auto first = static_cast<size_t>(offset);
+        if (first + values->size() > size())
+        {
+            throw "out of range";
+        }
+
+        if constexpr (std::is_same_v<T, U>)
+        {
+            std::memmove(_data + first, values->data(), values->size() * sizeof(T));
+        }
+        else
+        {
+            std::copy(values->begin(), values->end(), _data + first);
+        }
+    }
+
+    // JS value of an element, NaN past the end
+    inline double at(size_t index) const
+    {
+        return index < size() ? static_cast<double>(_data[index]) : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // JS conversion of a number to the element type: integers wrap modulo 2^32 and then to their width, NaN is 0
+    static inline T to_element(double value)
+    {
+        if constexpr (std::is_integral_v<T>)
+        {
+            return static_cast<T>(bitwise::to_uint32(value));
+        }
+        else
+        {
+            return static_cast<T>(value);
+        }
+    }
+
+    // stores a JS value, ignored past the end
+    inline void put(size_t index, double value)
+    {
+        if (index < size())
+        {
+            _data[index] = to_element(value);
+        }
+    }
+
+    js::number indexOf(js::number value, js::number fromIndex = 0)
+    {
+        auto first = static_cast<size_t>(fromIndex);
+        auto element = to_element(static_cast<double>(value));
+        if (first >= size() || static_cast<double>(element) != static_cast<double>(value))
+        {
+            return js::number(-1);
+        }
+
+        auto index = simd::index_of(_data, element, first, size());
+        return index < size() ? js::number(index) : js::number(-1);
+    }
+
+    T sum() const
+    {
+        return simd::sum(_data, size());
+    }
+
+    // js::number, so an empty array gives Infinity / -Infinity like Math.min() / Math.max() whatever T is
+    js::number min() const
+    {
+        return size() > 0 ? js::number(simd::min(_data, size())) : js::number(std::numeric_limits<double>::infinity());
+    }
+
+    js::number max() const
+    {
+        return size() > 0 ? js::number(simd::max(_data, size())) : js::number(-std::numeric_limits<double>::infinity());
+    }
+
+    std::shared_ptr<TypedArray> fill(js::number value)
+    {
+        simd::fill(_data, to_element(static_cast<double>(value)), size());
+        return std::make_shared<TypedArray>(buffer, byteOffset, length);
+    }
+
+    // shares the memory
+    std::shared_ptr<TypedArray> subarray(js::number begin_)
+    {
+        return subarray(begin_, length);
+    }
+
+    std::shared_ptr<TypedArray> subarray(js::number begin_, js::number end_)
+    {
+        auto first = std::min(static_cast<size_t>(begin_), size());
+        auto last = std::max(first, std::min(static_cast<size_t>(end_), size()));
+        return std::make_shared<TypedArray>(buffer, js::number(static_cast<size_t>(byteOffset) + first * sizeof(T)), js::number(last - first));
+    }
+
+    // copies the memory
+    std::shared_ptr<TypedArray> slice(js::number begin_)
+    {
+        return slice(begin_, length);
+    }
+
+    std::shared_ptr<TypedArray> slice(js::number begin_, js::number end_)
+    {
+        auto first = std::min(static_cast<size_t>(begin_), size());
+        auto last = std::max(first, std::min(static_cast<size_t>(end_), size()));
+        auto result = std::make_shared<TypedArray>(js::number(last - first));
+        std::memcpy(result->data(), _data + first, (last - first) * sizeof(T));
+        return result;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const TypedArray &)
+    {
+        return os << "[object TypedArray]";
+    }
+};
+
+using Int8Array = TypedArray<std::int8_t>;
+using Uint8Array = TypedArray<std::uint8_t>;
+using Int16Array = TypedArray<std::int16_t>;
+using Uint16Array = TypedArray<std::uint16_t>;
+using Int32Array = TypedArray<std::int32_t>;
+using Uint32Array = TypedArray<std::uint32_t>;
+using Float32Array = TypedArray<float>;
+using Float64Array = TypedArray<double>;
+using Int64Array = TypedArray<std::int64_t>;
+using Uint64Array = TypedArray<std::uint64_t>;
+
+// element-wise loops over float typed arrays, out[i] = a[i] op b[i] for i < a.length, the emitter lowers such for
+// loops to these. Inputs that are too short or overlap the output partially take the JS semantics loop
+template <typename T, typename... Inputs>
+inline bool elementwise_fast(const TypedArray<T> &out, size_t n, const Inputs &... inputs)
+{
+    auto fits = [&](const TypedArray<T> &input) {
+        return input.size() >= n
+            && (input.data() == out.data() || input.data() + n <= out.data() || out.data() + n <= input.data());
+    };
+
+    return out.size() >= n && (fits(inputs) && ...);
+}
+
+template <typename T>
+void vector_add(const std::shared_ptr<TypedArray<T>> &out, const std::shared_ptr<TypedArray<T>> &a, const std::shared_ptr<TypedArray<T>> &b)
+{
+    auto n = a->size();
+    if (elementwise_fast(*out, n, *a, *b))
+    {
+        simd::add(a->data(), b->data(), out->data(), n);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        out->put(i, a->at(i) + b->at(i));
+    }
+}
+
+template <typename T>
+void vector_mul(const std::shared_ptr<TypedArray<T>> &out, const std::shared_ptr<TypedArray<T>> &a, const std::shared_ptr<TypedArray<T>> &b)
+{
+    auto n = a->size();
+    if (elementwise_fast(*out, n, *a, *b))
+    {
+        simd::mul(a->data(), b->data(), out->data(), n);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        out->put(i, a->at(i) * b->at(i));
+    }
+}
+
+// out[i] = a[i] * b[i] + c[i], fused into one rounding where the CPU has FMA
+template <typename T>
+void vector_fma(const std::shared_ptr<TypedArray<T>> &out, const std::shared_ptr<TypedArray<T>> &a, const std::shared_ptr<TypedArray<T>> &b, const std::shared_ptr<TypedArray<T>> &c)
+{
+    auto n = a->size();
+    if (elementwise_fast(*out, n, *a, *b, *c))
+    {
+        simd::fma(a->data(), b->data(), c->data(), out->data(), n);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        out->put(i, a->at(i) * b->at(i) + c->at(i));
+    }
+}
+
+// unaligned reads and writes of any width and byte order, the default byte order is big endian as in JS
+struct DataView : public ArrayBufferView
+{
+    DataView(std::shared_ptr<ArrayBuffer> buffer_) : ArrayBufferView(buffer_, 0, buffer_->size())
+    {
+    }
+
+    DataView(std::shared_ptr<ArrayBuffer> buffer_, js::number byteOffset_)
+        : ArrayBufferView(buffer_, static_cast<size_t>(byteOffset_), buffer_->size() - std::min(buffer_->size(), static_cast<size_t>(byteOffset_)))
+    {
+    }
+
+    DataView(std::shared_ptr<ArrayBuffer> buffer_, js::number byteOffset_, js::number byteLength_)
+        : ArrayBufferView(buffer_, static_cast<size_t>(byteOffset_), static_cast<size_t>(byteLength_))
+    {
+    }
+
+    template <typename T>
+    T get(js::number byteOffset_, bool littleEndian) const
+    {
+        auto offset = checked_offset(byteOffset_, sizeof(T));
+        std::uint8_t raw[sizeof(T)];
+        std::memcpy(raw, bytes() + offset, sizeof(T));
+        if (littleEndian != (std::endian::native == std::endian::little))
+        {
+            std::reverse(raw, raw + sizeof(T));
+        }
+
+        T value;
+        std::memcpy(&value, raw, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void set(js::number byteOffset_, T value, bool littleEndian)
+    {
+        auto offset = checked_offset(byteOffset_, sizeof(T));
+        std::uint8_t raw[sizeof(T)];
+        std::memcpy(raw, &value, sizeof(T));
+        if (littleEndian != (std::endian::native == std::endian::little))
+        {
+            std::reverse(raw, raw + sizeof(T));
+        }
+
+        std::memcpy(bytes() + offset, raw, sizeof(T));
+    }
+
+    js::number getInt8(js::number byteOffset_) const
+    {
+        return js::number(get<std::int8_t>(byteOffset_, false));
+    }
+
+    js::number getUint8(js::number byteOffset_) const
+    {
+        return js::number(get<std::uint8_t>(byteOffset_, false));
+    }
+
+    js::number getInt16(js::number byteOffset_, bool littleEndian = false) const
+    {
+        return js::number(get<std::int16_t>(byteOffset_, littleEndian));
+    }
+
+    js::number getUint16(js::number byteOffset_, bool littleEndian = false) const
+    {
+        return js::number(get<std::uint16_t>(byteOffset_, littleEndian));
+    }
+
+    js::number getInt32(js::number byteOffset_, bool littleEndian = false) const
+    {
+        return js::number(get<std::int32_t>(byteOffset_, littleEndian));
+    }
+
+    js::number getUint32(js::number byteOffset_, bool littleEndian = false) const
+    {
+        return js::number(get<std::uint32_t>(byteOffset_, littleEndian));
+    }
+
+    js::number getFloat32(js::number byteOffset_, bool littleEndian = false) const
+    {
+        return js::number(get<float>(byteOffset_, littleEndian));
+    }
+
+    js::number getFloat64(js::number byteOffset_, bool littleEndian = false) const
+    {
+        return js::number(get<double>(byteOffset_, littleEndian));
+    }
+
+    void setInt8(js::number byteOffset_, js::number value)
+    {
+        set(byteOffset_, static_cast<std::int8_t>(bitwise::to_int32(static_cast<double>(value))), false);
+    }
+
+    void setUint8(js::number byteOffset_, js::number value)
+    {
+        set(byteOffset_, static_cast<std::uint8_t>(bitwise::to_uint32(static_cast<double>(value))), false);
+    }
+
+    void setInt16(js::number byteOffset_, js::number value, bool littleEndian = false)
+    {
+        set(byteOffset_, static_cast<std::int16_t>(bitwise::to_int32(static_cast<double>(value))), littleEndian);
+    }
+
+    void setUint16(js::number byteOffset_, js::number value, bool littleEndian = false)
+    {
+        set(byteOffset_, static_cast<std::uint16_t>(bitwise::to_uint32(static_cast<double>(value))), littleEndian);
+    }
+
+    void setInt32(js::number byteOffset_, js::number value, bool littleEndian = false)
+    {
+        set(byteOffset_, bitwise::to_int32(static_cast<double>(value)), littleEndian);
+    }
+
+    void setUint32(js::number byteOffset_, js::number value, bool littleEndian = false)
+    {
+        set(byteOffset_, bitwise::to_uint32(static_cast<double>(value)), littleEndian);
+    }
+
+    void setFloat32(js::number byteOffset_, js::number value, bool littleEndian = false)
+    {
+        set(byteOffset_, static_cast<float>(value), littleEndian);
+    }
+
+    void setFloat64(js::number byteOffset_, js::number value, bool littleEndian = false)
+    {
+        set(byteOffset_, static_cast<double>(value), littleEndian);
+    }
+
+private:
+    size_t checked_offset(js::number byteOffset_, size_t size) const
+    {
+        auto offset = static_cast<size_t>(byteOffset_);
+        if (offset + size > static_cast<size_t>(mutable_(byteLength)))
+        {
+            throw "offset is outside the bounds of the DataView";
+        }
+
+        return offset;
+    }
+};
+
+namespace utils
+{
+
+// SameValueZero for Map and Set keys: NaN is one key, 0 and -0 are the same key
+template <typename K>
+struct map_hash
+{
+    size_t operator()(const K &key) const
+    {
+        if constexpr (requires { key.hash(); })
+        {
+            return key.hash();
+        }
+        else
+        {
+            return std::hash<K>{}(key);
+        }
+    }
+};
+
+template <>
+struct map_hash<js::number>
+{
+    size_t operator()(const js::number &key) const
+    {
+        auto value = key._value;
+        if (std::isnan(value))
+        {
+            return 0x7ff8000000000000ull;
+        }
+
+        return std::bit_cast<std::uint64_t>(value == 0 ? 0.0 : value);
+    }
+};
+
+template <typename K>
+struct map_equal_to
+{
+    bool operator()(const K &value, const K &other) const
+    {
+        if constexpr (requires { value.hash_differs(other); })
+        {
+            if (value.hash_differs(other))
+            {
+                return false;
+            }
+        }
+
+        return static_cast<bool>(mutable_(value) == other);
+    }
+};
+
+template <>
+struct map_equal_to<js::number>
+{
+    bool operator()(const js::number &value, const js::number &other) const
+    {
+        return value._value == other._value || (std::isnan(value._value) && std::isnan(other._value));
+    }
+};
+
+// the table behind Map and Set: entries in insertion order in one vector, found through an open addressing index
+// of (entry, hash) slots probed linearly. A probe looks at 32 bits of hash before it touches an entry. Deleting
+// leaves a hole in the entries that iteration skips; the holes go when the index is rebuilt, unless a forEach or an
+// iterator is live
+template <typename E, typename K, typename KeyOf, typename Hash, typename Equal>
+struct ordered_hash_table
+{
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t min_slots = 8;
+
+    struct node
+    {
+        E value;
+        std::uint32_t hash;
+        bool live;
+    };
+
+    // entry is the index of the node plus one, 0 marks a free slot
+    struct slot
+    {
+        std::uint32_t entry;
+        std::uint32_t hash;
+    };
+
+    std::vector<node> _nodes;
+    std::vector<slot> _slots;
+    size_t _size = 0;
+    size_t _iterating = 0;
+
+    // the bits used by the index come from the top of a multiplicative mix, so small integer and pointer hashes spread
+    static std::uint32_t hash_of(const K &key)
+    {
+        return static_cast<std::uint32_t>((static_cast<std::uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15ull) >> 32);
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    size_t find_slot(const K &key) const
+    {
+        if (_slots.empty())
+        {
+            return npos;
+        }
+
+        auto hash = hash_of(key);
+        auto mask = _slots.size() - 1;
+        for (auto i = hash & mask;; i = (i + 1) & mask)
+        {
+            auto &current = _slots[i];
+            if (current.entry == 0)
+            {
+                return npos;
+            }
+
+            if (current.hash == hash && Equal{}(KeyOf{}(_nodes[current.entry - 1].value), key))
+            {
+                return i;
+            }
+        }
+    }
+
+    E *find(const K &key)
+    {
+        auto i = find_slot(key);
+        return i == npos ? nullptr : &_nodes[_slots[i].entry - 1].value;
+    }
+
+    // the entry of key, made by make() when there is none; true when it was added
+    template <typename F>
+    std::pair<E *, bool> insert(const K &key, F make)
+    {
+        if ((_nodes.size() + 1) * 2 > _slots.size())
+        {
+            rehash();
+        }
+
+        auto hash = hash_of(key);
+        auto mask = _slots.size() - 1;
+        auto i = hash & mask;
+        for (; _slots[i].entry != 0; i = (i + 1) & mask)
+        {
+            if (_slots[i].hash == hash && Equal{}(KeyOf{}(_nodes[_slots[i].entry - 1].value), key))
+            {
+                return {&_nodes[_slots[i].entry - 1].value, false};
+            }
+        }
+
+        _nodes.push_back(node{make(), hash, true});
+        _slots[i] = slot{static_cast<std::uint32_t>(_nodes.size()), hash};
+        _size++;
+        return {&_nodes.back().value, true};
+    }
+
+    bool erase(const K &key)
+    {
+        auto i = find_slot(key);
+        if (i == npos)
+        {
+            return false;
+        }
+
+        auto &erased = _nodes[_slots[i].entry - 1];
+        erased.value = E();
+        erased.live = false;
+        _size--;
+
+        // backward shift: pull later slots of the probe sequence into the gap, so lookups need no tombstones
+        auto mask = _slots.size() - 1;
+        for (auto j = (i + 1) & mask; _slots[j].entry != 0; j = (j + 1) & mask)
+        {
+            auto home = _slots[j].hash & mask;
+            if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+            {
+                _slots[i] = _slots[j];
+                i = j;
+            }
+        }
+
+        _slots[i] = slot{0, 0};
+        return true;
+    }
+
+    void clear()
+    {
+        _nodes.clear();
+        _slots.clear();
+        _size = 0;
+    }
+
+    void rehash()
+    {
+        if (_size * 2 < _nodes.size() && _iterating == 0)
+        {
+            _nodes.erase(std::remove_if(_nodes.begin(), _nodes.end(), [](const node &item) { return !item.live; }), _nodes.end());
+        }
+
+        auto capacity = min_slots;
+        while (capacity < (_nodes.size() + 1) * 2)
+        {
+            capacity *= 2;
+        }
+
+        _slots.assign(capacity, slot{0, 0});
+        auto mask = capacity - 1;
+        for (size_t index = 0; index < _nodes.size(); index++)
+        {
+            if (!_nodes[index].live)
+            {
+                continue;
+            }
+
+            auto i = _nodes[index].hash & mask;
+            for (; _slots[i].entry != 0; i = (i + 1) & mask);
+            _slots[i] = slot{static_cast<std::uint32_t>(index + 1), _nodes[index].hash};
+        }
+    }
+
+    // visits the live entries, including those added meanwhile, as JS iteration does. f gets a copy: an insert
+    // from f may reallocate _nodes
+    template <typename F>
+    void for_each(F f)
+    {
+        _iterating++;
+        try
+        {
+            for (size_t index = 0; index < _nodes.size(); index++)
+            {
+                if (_nodes[index].live)
+                {
+                    E value = _nodes[index].value;
+                    f(value);
+                }
+            }
+        }
+        catch (...)
+        {
+            _iterating--;
+            throw;
+        }
+
+        _iterating--;
+    }
+
+    // P projects an entry to what the iteration yields; a live iterator keeps rehash() from compacting _nodes
+    template <typename P>
+    struct iterator
+    {
+        using value_type = std::decay_t<decltype(P{}(std::declval<E &>()))>;
+
+        ordered_hash_table *_table;
+        size_t _index;
+        mutable std::optional<value_type> _current;
+
+        iterator(ordered_hash_table *table, size_t index) : _table(table), _index(index)
+        {
+            _table->_iterating++;
+        }
+
+        iterator(const iterator &other) : iterator(other._table, other._index)
+        {
+        }
+
+        iterator &operator=(const iterator &other)
+        {
+            other._table->_iterating++;
+            _table->_iterating--;
+            _table = other._table;
+            _index = other._index;
+            return *this;
+        }
+
+        ~iterator()
+        {
+            _table->_iterating--;
+        }
+
+        // a copy, as for_each passes: the body of for (auto &x : ...) may add entries and reallocate _nodes
+        value_type &operator*() const
+        {
+            _current.emplace(P{}(_table->_nodes[_index].value));
+            return *_current;
+        }
+
+        iterator &operator++()
+        {
+            for (_index++; _index < _table->_nodes.size() && !_table->_nodes[_index].live; _index++);
+            return *this;
+        }
+
+        // end is wherever the entries end when it is asked, so entries added during the loop are visited
+        bool operator!=(const iterator &) const
+        {
+            return _index < _table->_nodes.size();
+        }
+    };
+
+    template <typename P>
+    iterator<P> begin()
+    {
+        iterator<P> it{this, 0};
+        for (; it._index < _nodes.size() && !_nodes[it._index].live; it._index++);
+        return it;
+    }
+
+    template <typename P>
+    iterator<P> end()
+    {
+        return iterator<P>{this, 0};
+    }
+
+    template <typename P>
+    struct view
+    {
+        ordered_hash_table *_table;
+
+        iterator<P> begin() const
+        {
+            return _table->template begin<P>();
+        }
+
+        iterator<P> end() const
+        {
+            return _table->template end<P>();
+        }
+    };
+};
+
+} // namespace utils
+
+template <typename K, typename V, typename Hash = utils::map_hash<K>, typename Equal = utils::map_equal_to<K>>
+struct Map
+{
+    using entry = std::pair<K, V>;
+
+    struct key_of
+    {
+        const K &operator()(const entry &value) const
+        {
+            return value.first;
+        }
+    };
+
+    struct value_of
+    {
+        V &operator()(entry &value) const
+        {
+            return value.second;
+        }
+    };
+
+    struct entry_of
+    {
+        entry &operator()(entry &value) const
+        {
+            return value;
+        }
+    };
+
+    using table_type = utils::ordered_hash_table<entry, K, key_of, Hash, Equal>;
+
+    table_type _table;
+    js::number size;
+
+    Map() : size(0)
+    {
+    }
+
+    // new Map(entries): anything iterable whose elements have the key at 0 and the value at 1
+    template <typename R>
+        requires(!std::is_same_v<std::decay_t<R>, Map>)
+    Map(const R &entries) : size(0)
+    {
+        for (auto &item : mutable_(entries))
+        {
+            set(std::get<0>(item), std::get<1>(item));
+        }
+    }
+
+    constexpr Map *operator->()
+    {
+        return this;
+    }
+
+    V get(const K &key)
+    {
+        auto found = _table.find(key);
+        return found ? found->second : V();
+    }
+
+    js::boolean has(const K &key) const
+    {
+        return _table.find_slot(key) != table_type::npos;
+    }
+
+    // returns the map itself, for m.set(a, 1).set(b, 2)
+    Map &set(const K &key, V value)
+    {
+        auto [found, added] = _table.insert(key, [&]() { return entry(key, value); });
+        if (added)
+        {
+            size = _table.size();
+        }
+        else
+        {
+            found->second = std::move(value);
+        }
+
+        return *this;
+    }
+
+    js::boolean _delete(const K &key)
+    {
+        auto erased = _table.erase(key);
+        size = _table.size();
+        return erased;
+    }
+
+    void clear()
+    {
+        _table.clear();
+        size = 0;
+    }
+
+    // callback(value, key) or callback(value)
+    template <typename F>
+    void forEach(F callback)
+    {
+        _table.for_each([&](entry &item) {
+            if constexpr (std::is_invocable_v<F &, V &, const K &>)
+            {
+                callback(item.second, item.first);
+            }
+            else
+            {
+                callback(item.second);
+            }
+        });
+    }
+
+    auto keys()
+    {
+        return typename table_type::template view<key_of>{&_table};
+    }
+
+    auto values()
+    {
+        return typename table_type::template view<value_of>{&_table};
+    }
+
+    auto entries()
+    {
+        return typename table_type::template view<entry_of>{&_table};
+    }
+
+    auto begin()
+    {
+        return _table.template begin<entry_of>();
+    }
+
+    auto end()
+    {
+        return _table.template end<entry_of>();
+    }
+};
+
+template <typename T, typename Hash = utils::map_hash<T>, typename Equal = utils::map_equal_to<T>>
+struct Set
+{
+    struct key_of
+    {
+        const T &operator()(const T &value) const
+        {
+            return value;
+        }
+    };
+
+    using table_type = utils::ordered_hash_table<T, T, key_of, Hash, Equal>;
+
+    table_type _table;
+    js::number size;
+
+    Set() : size(0)
+    {
+    }
+
+    template <typename R>
+        requires(!std::is_same_v<std::decay_t<R>, Set>)
+    Set(const R &values) : size(0)
+    {
+        for (auto &item : mutable_(values))
+        {
+            add(item);
+        }
+    }
+
+    constexpr Set *operator->()
+    {
+        return this;
+    }
+
+    js::boolean has(const T &value) const
+    {
+        return _table.find_slot(value) != table_type::npos;
+    }
+
+    // returns the set itself, for s.add(a).add(b)
+    Set &add(const T &value)
+    {
+        if (_table.insert(value, [&]() { return value; }).second)
+        {
+            size = _table.size();
+        }
+
+        return *this;
+    }
+
+    js::boolean _delete(const T &value)
+    {
+        auto erased = _table.erase(value);
+        size = _table.size();
+        return erased;
+    }
+
+    void clear()
+    {
+        _table.clear();
+        size = 0;
+    }
+
+    template <typename F>
+    void forEach(F callback)
+    {
+        _table.for_each([&](T &item) {
+            if constexpr (std::is_invocable_v<F &, const T &, const T &>)
+            {
+                callback(item, item);
+            }
+            else
+            {
+                callback(item);
+            }
+        });
+    }
+
+    auto values()
+    {
+        return typename table_type::template view<key_of>{&_table};
+    }
+
+    auto keys()
+    {
+        return values();
+    }
+
+    auto begin()
+    {
+        return _table.template begin<key_of>();
+    }
+
+    auto end()
+    {
+        return _table.template end<key_of>();
+    }
+};
+
+// for (auto &item : m) over the std::shared_ptr the emitter declares Map and Set variables as
+template <typename K, typename V, typename H, typename E>
+auto begin(const std::shared_ptr<Map<K, V, H, E>> &map)
+{
+    return map->begin();
+}
+
+template <typename K, typename V, typename H, typename E>
+auto end(const std::shared_ptr<Map<K, V, H, E>> &map)
+{
+    return map->end();
+}
+
+template <typename T, typename H, typename E>
+auto begin(const std::shared_ptr<Set<T, H, E>> &set)
+{
+    return set->begin();
+}
+
+template <typename T, typename H, typename E>
+auto end(const std::shared_ptr<Set<T, H, E>> &set)
+{
+    return set->end();
+}
+
+// single threaded event loop, MAIN runs it after Main() returns. Promise reactions are microtasks and run before the
+// next timer. Other threads hand work to the loop with post()
+struct event_loop
+{
+    using clock = std::chrono::steady_clock;
+    using timer_key = std::pair<clock::time_point, size_t>;
+
+    std::deque<std::function<void()>> _microtasks;
+    std::map<timer_key, std::function<void()>> _timers;
+    std::unordered_map<size_t, timer_key> _timer_keys;
+    size_t _last_timer_id;
+
+    std::mutex _mutex;
+    std::condition_variable _posted_ready;
+    std::deque<std::function<void()>> _posted;
+    std::atomic<size_t> _keep_alive;
+
+    event_loop() : _last_timer_id(0), _keep_alive(0)
+    {
+    }
+
+    static event_loop &current()
+    {
+        static event_loop loop;
+        return loop;
+    }
+
+    void queue_microtask(std::function<void()> task)
+    {
+        _microtasks.push_back(std::move(task));
+    }
+
+    size_t set_timer(std::function<void()> callback, double delay)
+    {
+        auto id = ++_last_timer_id;
+        schedule(id, std::move(callback), delay);
+        return id;
+    }
+
+    size_t set_interval(std::function<void()> callback, double delay)
+    {
+        auto id = ++_last_timer_id;
+        repeat(id, std::move(callback), delay);
+        return id;
+    }
+
+    void clear_timer(size_t id)
+    {
+        auto found = _timer_keys.find(id);
+        if (found != _timer_keys.end())
+        {
+            _timers.erase(found->second);
+            _timer_keys.erase(found);
+        }
+    }
+
+    // from any thread
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _posted.push_back(std::move(task));
+        }
+
+        _posted_ready.notify_one();
+    }
+
+    // while held, run() waits for post() even when nothing else is queued
+    void keep_alive()
+    {
+        _keep_alive++;
+    }
+
+    void release()
+    {
+        _keep_alive--;
+        _posted_ready.notify_one();
+    }
+
+    void run_microtasks()
+    {
+        while (!_microtasks.empty())
+        {
+            auto task = std::move(_microtasks.front());
+            _microtasks.pop_front();
+            task();
+        }
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            run_microtasks();
+
+            std::deque<std::function<void()>> posted;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                posted.swap(_posted);
+            }
+
+            for (auto &task : posted)
+            {
+                task();
+                run_microtasks();
+            }
+
+            if (!posted.empty())
+            {
+                continue;
+            }
+
+            if (!_timers.empty() && _timers.begin()->first.first <= clock::now())
+            {
+                auto first = _timers.begin();
+                auto callback = std::move(first->second);
+                _timer_keys.erase(first->first.second);
+                _timers.erase(first);
+                callback();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!_posted.empty())
+            {
+                continue;
+            }
+
+            if (_timers.empty())
+            {
+                if (_keep_alive == 0)
+                {
+                    return;
+                }
+
+                _posted_ready.wait(lock, [this]() { return !_posted.empty() || _keep_alive == 0; });
+            }
+            else
+            {
+                _posted_ready.wait_until(lock, _timers.begin()->first.first, [this]() { return !_posted.empty(); });
+            }
+        }
+    }
+
+private:
+    void schedule(size_t id, std::function<void()> callback, double delay)
+    {
+        auto due = clock::now() + std::chrono::microseconds(static_cast<long long>(std::max(0.0, delay) * 1000));
+        timer_key key{due, id};
+        _timers.emplace(key, std::move(callback));
+        _timer_keys[id] = key;
+    }
+
+    // re-armed before the callback runs, so the callback can clear it
+    void repeat(size_t id, std::function<void()> callback, double delay)
+    {
+        schedule(id, [this, id, callback, delay]() {
+            repeat(id, callback, delay);
+            callback();
+        }, delay);
+    }
+};
+
+static js::number setTimeout(std::function<void()> callback, js::number delay = 0)
+{
+    return js::number(event_loop::current().set_timer(std::move(callback), static_cast<double>(delay)));
+}
+
+static void clearTimeout(js::number id)
+{
+    event_loop::current().clear_timer(static_cast<size_t>(id));
+}
+
+static js::number setInterval(std::function<void()> callback, js::number delay = 0)
+{
+    return js::number(event_loop::current().set_interval(std::move(callback), static_cast<double>(delay)));
+}
+
+static void clearInterval(js::number id)
+{
+    event_loop::current().clear_timer(static_cast<size_t>(id));
+}
+
+static void queueMicrotask(std::function<void()> callback)
+{
+    event_loop::current().queue_microtask(std::move(callback));
+}
+
+// reason of a rejected promise from whatever was thrown
+static any exception_reason(std::exception_ptr exception)
+{
+    try
+    {
+        std::rethrow_exception(exception);
+    }
+    catch (const any &a)
+    {
+        return a;
+    }
+    catch (const js::string &s)
+    {
+        return any(s);
+    }
+    catch (const std::exception &e)
+    {
+        return any(js::string(e.what()));
+    }
+    catch (const char_t *s)
+    {
+        return any(js::string(s));
+    }
+    catch (...)
+    {
+        return any(js::string(TXT("unknown exception")));
+    }
+}
+
+template <typename T = any>
+struct Promise;
+
+template <typename T>
+struct promise_value
+{
+    using type = T;
+};
+
+template <typename T>
+struct promise_value<std::shared_ptr<Promise<T>>>
+{
+    using type = T;
+};
+
+template <typename T>
+using promise_value_t = typename promise_value<T>::type;
+
+template <typename T>
+struct promise_state : public std::enable_shared_from_this<promise_state<T>>
+{
+    using value_type = std::conditional_t<std::is_void_v<T>, undefined_t, T>;
+
+    enum class status
+    {
+        pending,
+        fulfilled,
+        rejected
+    };
+
+    status _status = status::pending;
+    std::optional<value_type> _value;
+    any _reason;
+    std::vector<std::function<void()>> _reactions;
+
+    void fulfill(value_type value)
+    {
+        if (_status == status::pending)
+        {
+            _value.emplace(std::move(value));
+            _status = status::fulfilled;
+            flush();
+        }
+    }
+
+    void reject(any reason)
+    {
+        if (_status == status::pending)
+        {
+            _reason = std::move(reason);
+            _status = status::rejected;
+            flush();
+        }
+    }
+
+    // called once as a microtask after the promise is settled
+    void subscribe(std::function<void()> reaction)
+    {
+        if (_status == status::pending)
+        {
+            _reactions.push_back(std::move(reaction));
+        }
+        else
+        {
+            event_loop::current().queue_microtask(std::move(reaction));
+        }
+    }
+
+    // settles with the result of f(), following it when it is a promise
+    template <typename F>
+    void settle(F &&f)
+    {
+        using R = decltype(f());
+        try
+        {
+            if constexpr (std::is_void_v<R>)
+            {
+                f();
+                fulfill(value_type(undefined));
+            }
+            else if constexpr (!std::is_same_v<promise_value_t<R>, R>)
+            {
+                follow(f());
+            }
+            else
+            {
+                fulfill(value_type(f()));
+            }
+        }
+        catch (...)
+        {
+            reject(exception_reason(std::current_exception()));
+        }
+    }
+
+    template <typename U>
+    void follow(const std::shared_ptr<Promise<U>> &other);
+
+private:
+    void flush()
+    {
+        for (auto &reaction : _reactions)
+        {
+            event_loop::current().queue_microtask(std::move(reaction));
+        }
+
+        _reactions.clear();
+    }
+};
+
+template <typename T>
+struct Promise
+{
+    using state_type = promise_state<T>;
+    using value_type = typename state_type::value_type;
+    using status = typename state_type::status;
+
+    std::shared_ptr<state_type> _state;
+
+    Promise() : _state(std::make_shared<state_type>())
+    {
+    }
+
+    template <typename F> requires (!std::is_same_v<std::decay_t<F>, Promise>)
+    Promise(F executor) : Promise()
+    {
+        auto state = _state;
+        try
+        {
+            executor(resolver{state}, rejecter{state});
+        }
+        catch (...)
+        {
+            state->reject(exception_reason(std::current_exception()));
+        }
+    }
+
+    struct resolver
+    {
+        std::shared_ptr<state_type> _state;
+
+        void operator()() const
+        {
+            _state->fulfill(value_type(undefined));
+        }
+
+        template <typename U>
+        void operator()(const std::shared_ptr<Promise<U>> &other) const
+        {
+            _state->follow(other);
+        }
+
+        template <typename V>
+        void operator()(const V &value) const
+        {
+            _state->fulfill(value_type(value));
+        }
+    };
+
+    struct rejecter
+    {
+        std::shared_ptr<state_type> _state;
+
+        void operator()() const
+        {
+            _state->reject(any());
+        }
+
+        template <typename V>
+        void operator()(const V &reason) const
+        {
+            _state->reject(any(reason));
+        }
+    };
+
+    template <typename F>
+    auto then(F onFulfilled)
+    {
+        return then(onFulfilled, nullptr);
+    }
+
+    template <typename F, typename R>
+    auto then(F onFulfilled, R onRejected)
+    {
+        using result_type = decltype(call_fulfilled(onFulfilled, std::declval<value_type &>()));
+        auto next = std::make_shared<Promise<promise_value_t<result_type>>>();
+        auto state = _state;
+        auto next_state = next->_state;
+        state->subscribe([state, next_state, onFulfilled, onRejected]() mutable {
+            if (state->_status == status::fulfilled)
+            {
+                next_state->settle([&]() { return call_fulfilled(onFulfilled, *state->_value); });
+            }
+            else if constexpr (std::is_null_pointer_v<R>)
+            {
+                next_state->reject(state->_reason);
+            }
+            else
+            {
+                next_state->settle([&]() { return onRejected(state->_reason); });
+            }
+        });
+
+        return next;
+    }
+
+    template <typename R>
+    std::shared_ptr<Promise> _catch(R onRejected)
+    {
+        auto next = std::make_shared<Promise>();
+        auto state = _state;
+        auto next_state = next->_state;
+        state->subscribe([state, next_state, onRejected]() mutable {
+            if (state->_status == status::fulfilled)
+            {
+                next_state->fulfill(*state->_value);
+            }
+            else
+            {
+                next_state->settle([&]() { return onRejected(state->_reason); });
+            }
+        });
+
+        return next;
+    }
+
+    template <typename F>
+    std::shared_ptr<Promise> finally(F onFinally)
+    {
+        auto next = std::make_shared<Promise>();
+        auto state = _state;
+        auto next_state = next->_state;
+        state->subscribe([state, next_state, onFinally]() mutable {
+            try
+            {
+                onFinally();
+            }
+            catch (...)
+            {
+                next_state->reject(exception_reason(std::current_exception()));
+                return;
+            }
+
+            if (state->_status == status::fulfilled)
+            {
+                next_state->fulfill(*state->_value);
+            }
+            else
+            {
+                next_state->reject(state->_reason);
+            }
+        });
+
+        return next;
+    }
+
+    static std::shared_ptr<Promise<void>> resolve()
+    {
+        auto result = std::make_shared<Promise<void>>();
+        result->_state->fulfill(undefined);
+        return result;
+    }
+
+    template <typename V>
+    static std::shared_ptr<Promise<promise_value_t<V>>> resolve(V value)
+    {
+        if constexpr (!std::is_same_v<promise_value_t<V>, V>)
+        {
+            return value;
+        }
+        else
+        {
+            auto result = std::make_shared<Promise<V>>();
+            result->_state->fulfill(value);
+            return result;
+        }
+    }
+
+    template <typename V>
+    static std::shared_ptr<Promise> reject(V reason)
+    {
+        auto result = std::make_shared<Promise>();
+        result->_state->reject(any(reason));
+        return result;
+    }
+
+    // values in the order of the promises, rejects with the first rejection
+    template <typename U>
+    static auto all(const tmpl::array<std::shared_ptr<Promise<U>>> &promises)
+    {
+        using item_type = typename Promise<U>::value_type;
+        auto result = std::make_shared<Promise<tmpl::array<item_type>>>();
+        auto state = result->_state;
+        auto &items = promises.get();
+        auto values = std::make_shared<std::vector<item_type>>(items.size());
+        auto left = std::make_shared<size_t>(items.size());
+        if (items.empty())
+        {
+            state->fulfill(tmpl::array<item_type>(*values));
+        }
+
+        for (size_t index = 0; index < items.size(); index++)
+        {
+            auto item = items[index]->_state;
+            item->subscribe([item, state, values, left, index]() {
+                if (item->_status == Promise<U>::status::rejected)
+                {
+                    state->reject(item->_reason);
+                    return;
+                }
+
+                (*values)[index] = *item->_value;
+                if (--*left == 0)
+                {
+                    state->fulfill(tmpl::array<item_type>(*values));
+                }
+            });
+        }
+
+        return result;
+    }
+
+    template <typename U>
+    static auto race(const tmpl::array<std::shared_ptr<Promise<U>>> &promises)
+    {
+        auto result = std::make_shared<Promise<U>>();
+        auto state = result->_state;
+        for (auto &promise : promises.get())
+        {
+            state->follow(promise);
+        }
+
+        return result;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const Promise &)
+    {
+        return os << "[object Promise]";
+    }
+
+private:
+    template <typename F, typename V>
+    static decltype(auto) call_fulfilled(F &f, V &value)
+    {
+        if constexpr (std::is_invocable_v<F &, V &>)
+        {
+            return f(value);
+        }
+        else
+        {
+            return f();
+        }
+    }
+};
+
+template <typename T>
+template <typename U>
+void promise_state<T>::follow(const std::shared_ptr<Promise<U>> &other)
+{
+    auto self = this->shared_from_this();
+    auto source = other->_state;
+    source->subscribe([self, source]() {
+        if (source->_status == promise_state<U>::status::fulfilled)
+        {
+            self->fulfill(value_type(*source->_value));
+        }
+        else
+        {
+            self->reject(source->_reason);
+        }
+    });
+}
+
+namespace utils
+{
+
+// coroutine frames of async functions, recycled by size class instead of going back to the heap
+struct frame_pool
+{
+    static constexpr size_t granularity = 64;
+    static constexpr size_t classes = 32;
+
+    void *_free[classes] = {};
+
+    static frame_pool &local()
+    {
+        thread_local frame_pool pool;
+        return pool;
+    }
+
+    ~frame_pool()
+    {
+        for (auto head : _free)
+        {
+            while (head)
+            {
+                auto next = *static_cast<void **>(head);
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+    void *allocate(size_t size)
+    {
+        auto index = (size + granularity - 1) / granularity;
+        if (index >= classes)
+        {
+            return ::operator new(size);
+        }
+
+        if (auto head = _free[index])
+        {
+            _free[index] = *static_cast<void **>(head);
+            return head;
+        }
+
+        return ::operator new(index * granularity);
+    }
+
+    void deallocate(void *p, size_t size)
+    {
+        auto index = (size + granularity - 1) / granularity;
+        if (index >= classes)
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        *static_cast<void **>(p) = _free[index];
+        _free[index] = p;
+    }
+};
+
+} // namespace utils
+
+// promise_type of async functions: they return std::shared_ptr<Promise<T>> and run until the first co_await
+template <typename T>
+struct async_frame_base
+{
+    std::shared_ptr<Promise<T>> _promise = std::make_shared<Promise<T>>();
+
+    static void *operator new(size_t size)
+    {
+        return utils::frame_pool::local().allocate(size);
+    }
+
+    static void operator delete(void *p, size_t size)
+    {
+        utils::frame_pool::local().deallocate(p, size);
+    }
+
+    std::shared_ptr<Promise<T>> get_return_object()
+    {
+        return _promise;
+    }
+
+    std::suspend_never initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    std::suspend_never final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        _promise->_state->reject(exception_reason(std::current_exception()));
+    }
+
+    template <typename U>
+    struct promise_awaiter
+    {
+        std::shared_ptr<promise_state<U>> _state;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            _state->subscribe([handle]() { handle.resume(); });
+        }
+
+        typename promise_state<U>::value_type await_resume()
+        {
+            if (_state->_status == promise_state<U>::status::rejected)
+            {
+                throw _state->_reason;
+            }
+
+            return *_state->_value;
+        }
+    };
+
+    // await of a plain value still lets the microtasks queued before it run first
+    template <typename V>
+    struct value_awaiter
+    {
+        V _value;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            event_loop::current().queue_microtask([handle]() { handle.resume(); });
+        }
+
+        V await_resume()
+        {
+            return std::move(_value);
+        }
+    };
+
+    template <typename U>
+    promise_awaiter<U> await_transform(const std::shared_ptr<Promise<U>> &promise)
+    {
+        return promise_awaiter<U>{promise->_state};
+    }
+
+    template <typename V>
+    value_awaiter<V> await_transform(V value)
+    {
+        return value_awaiter<V>{std::move(value)};
+    }
+};
+
+template <typename T>
+struct async_frame : public async_frame_base<T>
+{
+    template <typename V>
+    void return_value(V &&value)
+    {
+        if constexpr (!std::is_same_v<promise_value_t<std::decay_t<V>>, std::decay_t<V>>)
+        {
+            this->_promise->_state->follow(value);
+        }
+        else
+        {
+            this->_promise->_state->fulfill(typename Promise<T>::value_type(std::forward<V>(value)));
+        }
+    }
+};
+
+template <>
+struct async_frame<void> : public async_frame_base<void>
+{
+    void return_void()
+    {
+        this->_promise->_state->fulfill(undefined);
+    }
+};
+
+// runs f() on the thread pool, the promise settles on the event loop thread
+template <typename F>
+auto offload(F f)
+{
+    using R = decltype(f());
+    auto promise = std::make_shared<Promise<R>>();
+    auto state = promise->_state;
+    auto &loop = event_loop::current();
+    loop.keep_alive();
+    utils::thread_pool::shared().submit([f, state, &loop]() mutable {
+        std::function<void()> settle;
+        try
+        {
+            if constexpr (std::is_void_v<R>)
+            {
+                f();
+                settle = [state]() { state->fulfill(undefined); };
+            }
+            else
+            {
+                auto value = std::make_shared<R>(f());
+                settle = [state, value]() { state->fulfill(*value); };
+            }
+        }
+        catch (...)
+        {
+            auto exception = std::current_exception();
+            settle = [state, exception]() { state->reject(exception_reason(exception)); };
+        }
+
+        loop.post(settle);
+        loop.release();
+    });
+
+    return promise;
 }
 
-template <typename V>
-js::string number<V>::toString(number_t radix)
+namespace utils
+{
+
+// xoshiro256+ for Math.random: one generator per thread, seeded on first use
+struct xoshiro256
+{
+    uint64_t _state[4];
+
+    // 0 seeds every thread from std::random_device; anything else makes the sequences repeatable
+    static inline std::atomic<uint64_t> _seed{0};
+    static inline std::atomic<uint64_t> _streams{0};
+
+    static uint64_t splitmix64(uint64_t &x)
+    {
+        auto z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static xoshiro256 &local()
+    {
+        thread_local xoshiro256 generator;
+        return generator;
+    }
+
+    xoshiro256()
+    {
+        auto seed = _seed.load(std::memory_order_relaxed);
+        if (seed == 0)
+        {
+            std::random_device device;
+            reseed((static_cast<uint64_t>(device()) << 32) ^ device());
+            return;
+        }
+
+        // threads started after a seed get distinct, but still reproducible, streams
+        reseed(seed + 0x632be59bd9b4e019ull * _streams.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    void reseed(uint64_t seed)
+    {
+        for (auto &word : _state)
+        {
+            word = splitmix64(seed);
+        }
+    }
+
+    // seeds the generator of the calling thread and every thread that draws its first number afterwards
+    static void seed(uint64_t seed)
+    {
+        _seed.store(seed == 0 ? 1 : seed, std::memory_order_relaxed);
+        _streams.store(1, std::memory_order_relaxed);
+        local().reseed(seed == 0 ? 1 : seed);
+    }
+
+    uint64_t next()
+    {
+        auto result = _state[0] + _state[3];
+        auto t = _state[1] << 17;
+        _state[2] ^= _state[0];
+        _state[3] ^= _state[1];
+        _state[1] ^= _state[2];
+        _state[0] ^= _state[3];
+        _state[2] ^= t;
+        _state[3] = rotl(_state[3], 45);
+        return result;
+    }
+
+    // the top 53 bits, uniform in [0, 1)
+    double next_double()
+    {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53;
+    }
+
+    void fill(double *values, size_t count)
+    {
+        // a local copy of the state lets the loop keep it in registers
+        auto generator = *this;
+        for (size_t index = 0; index < count; index++)
+        {
+            values[index] = generator.next_double();
+        }
+
+        *this = generator;
+    }
+};
+
+} // namespace utils
+
+static struct math_t
+{
+    static number E;
+    static number LN10;
+    static number LN2;
+    static number LOG2E;
+    static number LOG10E;
+    static number PI;
+    static number SQRT1_2;
+    static number SQRT2;
+
+    constexpr math_t *operator->()
+    {
+        return this;
+    }
+
+    static number pow(number op1, number op2)
+    {
+        return number(std::pow(static_cast<double>(op1), static_cast<double>(op2)));
+    }
+
+    static number min(number op1, number op2)
+    {
+        return number(std::min(static_cast<double>(op1), static_cast<double>(op2)));
+    }
+
+    static number max(number op1, number op2)
+    {
+        return number(std::max(static_cast<double>(op1), static_cast<double>(op2)));
+    }
+
+    static number sin(number op1)
+    {
+        return number(std::sin(static_cast<double>(op1)));
+    }
+
+    static number cos(number op1)
+    {
+        return number(std::cos(static_cast<double>(op1)));
+    }
+
+    static number asin(number op1)
+    {
+        return number(std::asin(static_cast<double>(op1)));
+    }
+
+    static number acos(number op1)
+    {
+        return number(std::acos(static_cast<double>(op1)));
+    }
+
+    static number abs(number op1)
+    {
+        return number(std::abs(static_cast<double>(op1)));
+    }
+
+    static number floor(number op1)
+    {
+        return number(std::floor(static_cast<double>(op1)));
+    }
+
+    static number round(number op1, int numDecimalPlaces = 0)
+    {
+        const auto mult = 10 ^ (numDecimalPlaces);
+        return number(std::floor(static_cast<double>(op1) * mult + 0.5) / mult);
+    }
+
+    static number sqrt(number op1)
+    {
+        return number(std::sqrt(static_cast<double>(op1)));
+    }
+
+    static number tan(number op1)
+    {
+        return number(std::tan(static_cast<double>(op1)));
+    }
+
+    static number atan(number op1)
+    {
+        return number(std::atan(static_cast<double>(op1)));
+    }
+
+    static number atan2(number op1, number op2)
+    {
+        return number(std::atan2(static_cast<double>(op1), static_cast<double>(op2)));
+    }
+
+    static number log(number op1)
+    {
+        return number(std::log(static_cast<double>(op1)));
+    }
+
+    static number exp(number op1)
+    {
+        return number(std::exp(static_cast<double>(op1)));
+    }
+
+    static number random()
+    {
+        return number(utils::xoshiro256::local().next_double());
+    }
+
+    // not in JavaScript: makes Math.random repeatable, e.g. for benchmark runs
+    static void seed(number value)
+    {
+        utils::xoshiro256::seed(static_cast<uint64_t>(static_cast<double>(value)));
+    }
+
+    // not in JavaScript: Math.random for every element, in one call
+    static std::shared_ptr<Float64Array> fillRandom(const std::shared_ptr<Float64Array> &values)
+    {
+        utils::xoshiro256::local().fill(values->_data, static_cast<size_t>(values->length));
+        return values;
+    }
+
+    static number sign(number op1)
+    {
+        auto d = static_cast<double>(op1);
+        return number(d < 0 ? -1 : d > 0 ? 1 : 0);
+    }
+} Math;
+
+static number E(2.718281828459045);
+static number LN10(2.302585092994046);
+static number LN2(0.6931471805599453);
+static number LOG2E(1.4426950408889634);
+static number LOG10E(0.4342944819032518);
+static number PI(3.141592653589793);
+static number SQRT1_2(0.7071067811865476);
+static number SQRT2(1.4142135623730951);
+
+// JSON.parse and JSON.stringify. The parser reports what it reads to a handler (SAX style), so the same code
+// builds any values for JSON.parse and streams through inputs too big to hold in memory
+namespace json
 {
-    return js::string(to_tstring(_value));
-}
 
-template <typename T>
-string<T> string<T>::operator+(any value)
+// first '"', '\\' or control character in [first, last): the characters that end a plain run of a string
+template <typename C>
+inline const C *scan_string(const C *first, const C *last)
 {
-    string tmp(_value);
-    tmp._value.append(value.operator std::string());
-    return tmp;
-}
+    for (; first != last; first++)
+    {
+        auto c = *first;
+        if (c == '"' || c == '\\' || static_cast<std::make_unsigned_t<C>>(c) < 0x20)
+        {
+            break;
+        }
+    }
 
-template <typename T>
-string<T> &string<T>::operator+=(any value)
-{
-    auto value_string = value.operator std::string();
-    _control = string_defined;
-    _value.append(value_string);
-    return *this;
+    return first;
 }
 
-// Object
-template <typename K, typename V>
-object<K, V>::object() : _values(object<K, V>::object_traits<object<K, V>::object_type>::create()), isUndefined(false)
-{
-}
+#if defined(JS_SIMD_X86) || (defined(JS_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64)))
+// 16 characters per step
+template <>
+inline const char *scan_string(const char *first, const char *last)
+{
+#if defined(JS_SIMD_X86)
+    auto quote = _mm_set1_epi8('"');
+    auto backslash = _mm_set1_epi8('\\');
+    auto control = _mm_set1_epi8(0x1f);
+    for (; last - first >= 16; first += 16)
+    {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+        auto stops = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        if (auto mask = _mm_movemask_epi8(stops))
+        {
+            return first + std::countr_zero(static_cast<unsigned>(mask));
+        }
+    }
+#else
+    auto quote = vdupq_n_u8('"');
+    auto backslash = vdupq_n_u8('\\');
+    auto control = vdupq_n_u8(0x20);
+    for (; last - first >= 16; first += 16)
+    {
+        auto chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(first));
+        auto stops = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)), vcltq_u8(chunk, control));
+        if (vmaxvq_u8(stops))
+        {
+            break;
+        }
+    }
+#endif
 
-template <typename K, typename V>
-object<K, V>::object(const object& value) : _values(value._values), isUndefined(value.isUndefined)
-{
+    for (; first != last; first++)
+    {
+        auto c = static_cast<unsigned char>(*first);
+        if (c == '"' || c == '\\' || c < 0x20)
+        {
+            break;
+        }
+    }
+
+    return first;
 }
+#endif
 
-template <typename K, typename V>
-object<K, V>::object(std::initializer_list<pair> values) : _values(object<K, V>::object_traits<object<K, V>::object_type>::create(values)), isUndefined(false)
+// recursive descent over a text in memory, or over a stream read in chunks.
+// H gets null_value(), boolean_value(bool), number_value(double), string_value(view), key(view),
+// start_array(), end_array(), start_object() and end_object(); views are only valid during the call
+template <typename C, typename H>
+struct parser
 {
-    auto& ref = get();
-    for (auto &item : values)
+    using view_type = std::basic_string_view<C>;
+
+    static constexpr size_t max_depth = 1000;
+    static constexpr size_t chunk_size = 64 * 1024;
+
+    H &_handler;
+    const C *_pos;
+    const C *_end;
+    std::basic_istream<C> *_input;
+    std::vector<C> _chunk;
+    std::basic_string<C> _text;
+    size_t _depth;
+    bool _high_surrogate;
+    size_t _high_surrogate_at;
+
+    parser(H &handler, view_type text)
+        : _handler(handler), _pos(text.data()), _end(text.data() + text.size()), _input(nullptr), _depth(0), _high_surrogate(false), _high_surrogate_at(0)
     {
-        ref[item.first] = item.second;
     }
-}
 
-template <typename K, typename V>
-object<K, V>::object(const undefined_t &) : _values(object<K, V>::object_traits<object<K, V>::object_type>::create()), isUndefined(true)
-{
-}
+    parser(H &handler, std::basic_istream<C> &input)
+        : _handler(handler), _pos(nullptr), _end(nullptr), _input(&input), _chunk(chunk_size), _depth(0), _high_surrogate(false), _high_surrogate_at(0)
+    {
+    }
 
-template <typename K, typename V>
-ObjectKeys<js::string, typename object<K, V>::object_type_base> object<K, V>::keys(const object<K, V> &obj)
-{
-    return ObjectKeys<js::string, object<K, V>::object_type_base>(obj->get());
-}
+    void parse()
+    {
+        parse_value();
+        skip_whitespace();
+        if (_pos != _end)
+        {
+            throw "Unexpected token in JSON";
+        }
+    }
 
-template <typename K, typename V>
-ObjectKeys<js::string, typename object<K, V>::object_type_base> object<K, V>::keys()
-{
-    return ObjectKeys<js::string, object<K, V>::object_type_base>(get());
-}
+    bool refill()
+    {
+        if (!_input)
+        {
+            return false;
+        }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](js::number n) const
-{
-    return mutable_(get())[static_cast<std::string>(n)];
-}
+        _input->read(_chunk.data(), _chunk.size());
+        _pos = _chunk.data();
+        _end = _pos + _input->gcount();
+        return _pos != _end;
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](js::number n)
-{
-    return get()[static_cast<std::string>(n)];
-}
+    C peek()
+    {
+        if (_pos == _end && !refill())
+        {
+            throw "Unexpected end of JSON input";
+        }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](const char_t *s) const
-{
-    return mutable_(get())[std::string(s)];
-}
+        return *_pos;
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](std::string s) const
-{
-    return mutable_(get())[s];
-}
+    C next()
+    {
+        auto c = peek();
+        _pos++;
+        return c;
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](js::string s) const
-{
-    return mutable_(get())[(std::string)s];
-}
+    void skip_whitespace()
+    {
+        do
+        {
+            while (_pos != _end && (*_pos == ' ' || *_pos == '\n' || *_pos == '\r' || *_pos == '\t'))
+            {
+                _pos++;
+            }
+        } while (_pos == _end && refill());
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](const char_t *s)
-{
-    return get()[std::string(s)];
-}
+    void expect(const char *rest)
+    {
+        for (; *rest; rest++)
+        {
+            if (next() != *rest)
+            {
+                throw "Unexpected token in JSON";
+            }
+        }
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](std::string s)
-{
-    return get()[s];
-}
+    void parse_value()
+    {
+        skip_whitespace();
+        switch (peek())
+        {
+        case '{':
+            _pos++;
+            parse_object();
+            break;
+        case '[':
+            _pos++;
+            parse_array();
+            break;
+        case '"':
+            _pos++;
+            _handler.string_value(parse_string());
+            break;
+        case 't':
+            _pos++;
+            expect("rue");
+            _handler.boolean_value(true);
+            break;
+        case 'f':
+            _pos++;
+            expect("alse");
+            _handler.boolean_value(false);
+            break;
+        case 'n':
+            _pos++;
+            expect("ull");
+            _handler.null_value();
+            break;
+        default:
+            _handler.number_value(parse_number());
+            break;
+        }
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](js::string s)
-{
-    return get()[(std::string)s];
-}
+    void enter()
+    {
+        if (++_depth > max_depth)
+        {
+            throw "JSON nested too deeply";
+        }
+    }
 
-template <typename K, typename V>
-any &object<K, V>::operator[](undefined_t)
-{
-    return get()["undefined"];
-}
+    void parse_array()
+    {
+        enter();
+        _handler.start_array();
+        skip_whitespace();
+        if (peek() == ']')
+        {
+            _pos++;
+        }
+        else
+        {
+            for (;;)
+            {
+                parse_value();
+                skip_whitespace();
+                auto c = next();
+                if (c == ']')
+                {
+                    break;
+                }
+
+                if (c != ',')
+                {
+                    throw "Unexpected token in JSON";
+                }
+            }
+        }
 
-} // namespace tmpl
+        _depth--;
+        _handler.end_array();
+    }
 
-// typeof
-template <>
-string type_of(boolean value)
-{
-    return STR("boolean");
-}
+    void parse_object()
+    {
+        enter();
+        _handler.start_object();
+        skip_whitespace();
+        if (peek() == '}')
+        {
+            _pos++;
+        }
+        else
+        {
+            for (;;)
+            {
+                skip_whitespace();
+                if (next() != '"')
+                {
+                    throw "Unexpected token in JSON";
+                }
+
+                _handler.key(parse_string());
+                skip_whitespace();
+                if (next() != ':')
+                {
+                    throw "Unexpected token in JSON";
+                }
+
+                parse_value();
+                skip_whitespace();
+                auto c = next();
+                if (c == '}')
+                {
+                    break;
+                }
+
+                if (c != ',')
+                {
+                    throw "Unexpected token in JSON";
+                }
+            }
+        }
 
-template <>
-string type_of(number value)
-{
-    return STR("number");
-}
+        _depth--;
+        _handler.end_object();
+    }
 
-template <>
-string type_of(string value)
-{
-    return STR("string");
-}
+    // after the opening quote; a string without escapes is a view of the input, the others are built in _text
+    view_type parse_string()
+    {
+        auto first = _pos;
+        auto stop = scan_string(_pos, _end);
+        if (stop != _end && *stop == '"')
+        {
+            _pos = stop + 1;
+            return view_type(first, stop - first);
+        }
 
-template <>
-string type_of(object value)
-{
-    return STR("object");
-}
+        _text.clear();
+        _high_surrogate = false;
+        for (;;)
+        {
+            _text.append(first, stop);
+            _pos = stop;
+            if (_pos == _end)
+            {
+                if (!refill())
+                {
+                    throw "Unterminated string in JSON";
+                }
+            }
+            else
+            {
+                auto c = *_pos++;
+                if (c == '"')
+                {
+                    return _text;
+                }
+
+                if (c != '\\')
+                {
+                    throw "Bad control character in string literal in JSON";
+                }
+
+                parse_escape();
+            }
 
-template <>
-string type_of(any value)
-{
-    return value.type_of();
-}
+            first = _pos;
+            stop = scan_string(_pos, _end);
+        }
+    }
 
-template <class T>
-static any Void(T value)
-{
-    return any();
-}
+    void parse_escape()
+    {
+        auto c = next();
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            _text += c;
+            break;
+        case 'b':
+            _text += C('\b');
+            break;
+        case 'f':
+            _text += C('\f');
+            break;
+        case 'n':
+            _text += C('\n');
+            break;
+        case 'r':
+            _text += C('\r');
+            break;
+        case 't':
+            _text += C('\t');
+            break;
+        case 'u':
+            parse_unicode_escape();
+            break;
+        default:
+            throw "Bad escaped character in JSON";
+        }
+    }
+
+    void parse_unicode_escape()
+    {
+        std::uint32_t code = 0;
+        for (auto i = 0; i < 4; i++)
+        {
+            auto c = next();
+            auto digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (digit < 0)
+            {
+                throw "Bad Unicode escape in JSON";
+            }
+
+            code = code * 16 + digit;
+        }
+
+        // UTF-16 strings take the surrogates as they come, UTF-8 and UTF-32 ones join a pair into one code point
+        if constexpr (sizeof(C) != 2)
+        {
+            if (code >= 0xdc00 && code < 0xe000 && _high_surrogate && _text.size() == _high_surrogate_at + (sizeof(C) == 1 ? 3 : 1))
+            {
+                auto high = sizeof(C) == 1
+                    ? ((_text[_high_surrogate_at] & 0x0f) << 12) | ((_text[_high_surrogate_at + 1] & 0x3f) << 6) | (_text[_high_surrogate_at + 2] & 0x3f)
+                    : static_cast<std::uint32_t>(_text[_high_surrogate_at]);
+                _text.resize(_high_surrogate_at);
+                code = 0x10000 + ((high - 0xd800) << 10) + (code - 0xdc00);
+            }
+
+            _high_surrogate = code >= 0xd800 && code < 0xdc00;
+            _high_surrogate_at = _text.size();
+        }
+
+        append_code_point(code);
+    }
+
+    void append_code_point(std::uint32_t code)
+    {
+        if constexpr (sizeof(C) == 1)
+        {
+            if (code < 0x80)
+            {
+                _text += static_cast<C>(code);
+            }
+            else if (code < 0x800)
+            {
+                _text += static_cast<C>(0xc0 | (code >> 6));
+                _text += static_cast<C>(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                _text += static_cast<C>(0xe0 | (code >> 12));
+                _text += static_cast<C>(0x80 | ((code >> 6) & 0x3f));
+                _text += static_cast<C>(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                _text += static_cast<C>(0xf0 | (code >> 18));
+                _text += static_cast<C>(0x80 | ((code >> 12) & 0x3f));
+                _text += static_cast<C>(0x80 | ((code >> 6) & 0x3f));
+                _text += static_cast<C>(0x80 | (code & 0x3f));
+            }
+        }
+        else
+        {
+            _text += static_cast<C>(code);
+        }
+    }
+
+    static bool is_number_char(C c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    double parse_number()
+    {
+        auto first = _pos;
+        while (_pos != _end && is_number_char(*_pos))
+        {
+            _pos++;
+        }
+
+        view_type token(first, _pos - first);
+        if (_pos == _end && _input)
+        {
+            // the number may go on in the next chunk
+            _text.assign(first, _pos);
+            while (refill())
+            {
+                first = _pos;
+                while (_pos != _end && is_number_char(*_pos))
+                {
+                    _pos++;
+                }
+
+                _text.append(first, _pos);
+                if (_pos != _end)
+                {
+                    break;
+                }
+            }
+
+            token = _text;
+        }
+
+        return to_number(token);
+    }
+
+    // checks the JSON number grammar, which is stricter than Number(); integers of up to 15 digits are exact
+    static double to_number(view_type token)
+    {
+        auto is_digit = [](C c) { return c >= '0' && c <= '9'; };
+        auto p = token.data();
+        auto end = p + token.size();
+        auto negative = p != end && *p == '-';
+        if (negative)
+        {
+            p++;
+        }
 
-template <typename I>
-inline bool is(js::any t)
-{
-    return false;
-}
+        if (p == end || !is_digit(*p) || (*p == '0' && p + 1 != end && is_digit(p[1])))
+        {
+            throw "Unexpected token in JSON";
+        }
 
-template <>
-inline bool is<js::boolean>(js::any t)
-{
-    return t && t.get_type() == any::anyTypeId::boolean_type;
-}
+        auto integer = p;
+        std::uint64_t value = 0;
+        for (; p != end && is_digit(*p); p++)
+        {
+            value = value * 10 + (*p - '0');
+        }
 
-template <>
-inline bool is<js::number>(js::any t)
-{
-    return t && t.get_type() == any::anyTypeId::number_type;
-}
+        if (p == end && p - integer <= 15)
+        {
+            return negative ? -static_cast<double>(value) : static_cast<double>(value);
+        }
 
-template <>
-inline bool is<js::string>(js::any t)
-{
-    return t && t.get_type() == any::anyTypeId::string_type;
-}
+        if (p != end && *p == '.')
+        {
+            if (++p == end || !is_digit(*p))
+            {
+                throw "Unexpected token in JSON";
+            }
 
-template <>
-inline bool is<js::array_any>(js::any t)
-{
-    return t && t.get_type() == any::anyTypeId::array_type;
-}
+            for (; p != end && is_digit(*p); p++);
+        }
 
-template <>
-inline bool is<js::object>(js::any t)
-{
-    return t && t.get_type() == any::anyTypeId::object_type;
-}
+        if (p != end && (*p == 'e' || *p == 'E'))
+        {
+            if (++p != end && (*p == '+' || *p == '-'))
+            {
+                p++;
+            }
 
-template <>
-inline bool is<js::function>(js::any t)
-{
-    return t && t.get_type() == any::anyTypeId::function_type;
-}
+            if (p == end || !is_digit(*p))
+            {
+                throw "Unexpected token in JSON";
+            }
 
-namespace utils
-{
+            for (; p != end && is_digit(*p); p++);
+        }
 
-struct finally
-{
-private:
-    std::function<void()> _dtor;
+        if (p != end)
+        {
+            throw "Unexpected token in JSON";
+        }
 
-public:
-    finally(std::function<void()> dtor) : _dtor(dtor){};
-    ~finally() { _dtor(); }
+        double result;
+        utils::parse_decimal(token.data(), end, result);
+        return result;
+    }
 };
 
-template <typename... Args>
-object assign(object &dst, const Args &... args)
+// handler building the values of JSON.parse. Elements and members wait on one shared stack until their
+// container closes, so every array and object is allocated once at its final size
+struct builder
 {
-    for (auto src : {args...})
+    using view_type = js::string::view_type;
+
+    std::vector<any> _values;
+    std::vector<js::string> _keys;
+    std::vector<std::pair<size_t, size_t>> _open;
+    any _result;
+
+    void push(any value)
     {
-        for (auto &k : keys_(src))
+        if (_open.empty())
         {
-            dst[k] = const_(src)[k];
+            _result = std::move(value);
+            return;
         }
+
+        _values.push_back(std::move(value));
     }
 
-    return dst;
-}
+    void null_value()
+    {
+        push(any(null));
+    }
 
-}; // namespace Utils
+    void boolean_value(bool value)
+    {
+        push(any(value));
+    }
 
-template <typename V, class Ax = void> requires has_exists_member<Ax>
-constexpr bool in(V v, const Ax &a)
-{
-    return a.exists(v);
-}
+    void number_value(double value)
+    {
+        push(any(js::number(value)));
+    }
 
-template <typename V, class Ax = void> requires has_exists_member<Ax>
-constexpr bool in(V v, Ax *a)
-{
-    return a->exists(v);
-}
+    void string_value(view_type value)
+    {
+        push(any(js::string(tstring(value))));
+    }
 
-template <typename V, class O>
-constexpr bool in(V v, O o)
-{
-    return false;
-}
+    void key(view_type value)
+    {
+        _keys.emplace_back(tstring(value));
+    }
 
-} // namespace js
+    void start_array()
+    {
+        _open.emplace_back(_values.size(), _keys.size());
+    }
 
-#ifdef UNICODE
-#define MAIN                                                             \
-    int wmain(int argc, char_t **argv)                                   \
-    {                                                                    \
-        try                                                              \
-        {                                                                \
-            Main();                                                      \
-        }                                                                \
-        catch (const js::string &s)                                      \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << s << std::endl;          \
-        }                                                                \
-        catch (const js::any &a)                                         \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << a << std::endl;          \
-        }                                                                \
-        catch (const std::exception &exception)                          \
-        {                                                                \
-            std::cout << "Exception: " << exception.what() << std::endl; \
-        }                                                                \
-        catch (const tstring &s)                                         \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << s << std::endl;          \
-        }                                                                \
-        catch (const char_t *s)                                          \
-        {                                                                \
-            std::wcout << TXT("Exception: ") << s << std::endl;          \
-        }                                                                \
-        catch (...)                                                      \
-        {                                                                \
-            std::wcout << TXT("General failure.") << std::endl;          \
-        }                                                                \
-        return 0;                                                        \
+    void start_object()
+    {
+        _open.emplace_back(_values.size(), _keys.size());
     }
-#else
-#define MAIN                                                             \
-    int main(int argc, char_t **argv)                                    \
-    {                                                                    \
-        try                                                              \
-        {                                                                \
-            Main();                                                      \
-        }                                                                \
-        catch (const js::string &s)                                      \
-        {                                                                \
-            std::cout << TXT("Exception: ") << s << std::endl;           \
-        }                                                                \
-        catch (const js::any &a)                                         \
-        {                                                                \
-            std::cout << TXT("Exception: ") << a << std::endl;           \
-        }                                                                \
-        catch (const std::exception &exception)                          \
-        {                                                                \
-            std::cout << "Exception: " << exception.what() << std::endl;\
-        }                                                                \
-        catch (const tstring &s)                                         \
-        {                                                                \
-            std::cout << TXT("Exception: ") << s << std::endl;           \
-        }                                                                \
-        catch (const char_t *s)                                          \
-        {                                                                \
-            std::cout << TXT("Exception: ") << s << std::endl;           \
-        }                                                                \
-        catch (...)                                                      \
-        {                                                                \
-            std::cout << TXT("General failure.") << std::endl;           \
-        }                                                                \
-        return 0;                                                        \
+
+    void end_array()
+    {
+        auto first = _open.back().first;
+        _open.pop_back();
+
+        array_any result;
+        auto &values = result.get();
+        values.reserve(_values.size() - first);
+        std::move(_values.begin() + first, _values.end(), std::back_inserter(values));
+        _values.resize(first);
+        push(any(result));
     }
-#endif
 
-// JS Core classes
-namespace js
-{
+    void end_object()
+    {
+        auto [first, firstKey] = _open.back();
+        _open.pop_back();
 
-template<class _Fn, class... _Args>
-static void thread(_Fn f, _Args... args) {
-    new std::thread(f, args...);
-}
+        object result;
+        auto &storage = result.get();
+        auto count = _keys.size() - firstKey;
+        storage.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            // parsed keys are data, not program text: they must not add shape transitions
+            storage.dynamic_at(_keys[firstKey + i]) = std::move(_values[first + i]);
+        }
 
-static void sleep(js::number n) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<size_t>(n)));
-}
+        _values.resize(first);
+        _keys.resize(firstKey);
+        push(any(result));
+    }
+};
 
-static number parseInt(const js::string &value, int base = 10)
+// JSON.stringify into one growing buffer, handed to the output stream, when there is one, as it fills up
+struct writer
 {
-    return number(std::stol(value._value, 0, base));
-}
+    using view_type = js::string::view_type;
 
-static number parseFloat(const js::string &value)
-{
-    auto r = NaN;
-    try
+    static constexpr size_t flush_size = 64 * 1024;
+
+    tstring _out;
+    tstring _indent;
+    tstring _newline;
+    tostream *_output;
+
+    writer(tostream *output = nullptr, tstring indent = tstring()) : _indent(indent), _newline(TXT("\n")), _output(output)
     {
-        r = number(std::stod(value._value, 0));
     }
-    catch (const std::exception &)
+
+    void flush(size_t size = flush_size)
     {
+        if (_output && _out.size() >= size)
+        {
+            _output->write(_out.data(), _out.size());
+            _out.clear();
+        }
     }
 
-    return r;
-}
-
-static object Object;
+    void newline()
+    {
+        if (!_indent.empty())
+        {
+            _out += _newline;
+        }
+    }
 
-static string String;
+    void write_string(view_type value)
+    {
+        constexpr auto hex = "0123456789abcdef";
+        _out += TXT('"');
+        auto first = value.data();
+        auto last = first + value.size();
+        for (;;)
+        {
+            auto stop = scan_string(first, last);
+            _out.append(first, stop);
+            if (stop == last)
+            {
+                break;
+            }
 
-template <typename T>
-using ReadonlyArray = tmpl::array<T>;
+            auto c = *stop;
+            switch (c)
+            {
+            case '"':
+                _out += TXT("\\\"");
+                break;
+            case '\\':
+                _out += TXT("\\\\");
+                break;
+            case '\b':
+                _out += TXT("\\b");
+                break;
+            case '\f':
+                _out += TXT("\\f");
+                break;
+            case '\n':
+                _out += TXT("\\n");
+                break;
+            case '\r':
+                _out += TXT("\\r");
+                break;
+            case '\t':
+                _out += TXT("\\t");
+                break;
+            default:
+                _out += TXT("\\u00");
+                _out += hex[(c >> 4) & 0xf];
+                _out += hex[c & 0xf];
+                break;
+            }
 
-template <typename T>
-using Array = tmpl::array<T>;
+            first = stop + 1;
+        }
 
-struct Date
-{
-    number getHours()
-    {
-        return number(0);
+        _out += TXT('"');
     }
 
-    number getMinutes()
+    // false for the values JSON leaves out: undefined and functions
+    bool write_value(const any &value)
     {
-        return number(0);
-    }
+        switch (value.get_type())
+        {
+        case any::anyTypeId::undefined_type:
+        case any::anyTypeId::function_type:
+            return false;
+        case any::anyTypeId::boolean_type:
+            _out += static_cast<bool>(mutable_(value.boolean_ref_const())) ? TXT("true") : TXT("false");
+            break;
+        case any::anyTypeId::number_type:
+            if (std::isfinite(value.number_ref_const()._value))
+            {
+                utils::append_number(_out, value.number_ref_const()._value);
+            }
+            else
+            {
+                _out += TXT("null");
+            }
 
-    number getSeconds()
-    {
-        return number(0);
-    }
-};
+            break;
+        case any::anyTypeId::string_type:
+        {
+            auto &text = value.string_ref_const();
+            if (text.is_undefined())
+            {
+                return false;
+            }
 
-typedef any Action;
+            if (text.is_null())
+            {
+                _out += TXT("null");
+            }
+            else
+            {
+                write_string(text.view());
+            }
 
-typedef any Function;
+            break;
+        }
+        case any::anyTypeId::array_type:
+            write_array(value.array_ref_const().get());
+            break;
+        case any::anyTypeId::object_type:
+            write_object(value.object_ref_const().get());
+            break;
+        case any::anyTypeId::class_type:
+            if (auto &instance = value.class_ref_const())
+            {
+                write_object(instance->get());
+            }
+            else
+            {
+                _out += TXT("null");
+            }
 
-struct RegExp
-{
+            break;
+        default:
+            _out += TXT("null");
+            break;
+        }
 
-#ifdef UNICODE
-    std::wregex re;
-#else
-    std::regex re;
-#endif    
+        flush();
+        return true;
+    }
 
-    RegExp(js::string pattern) : re((const char_t *)pattern)
+    void write_array(const std::vector<any> &values)
     {
+        _out += TXT('[');
+        if (!values.empty())
+        {
+            _newline += _indent;
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                if (i > 0)
+                {
+                    _out += TXT(',');
+                }
+
+                newline();
+                if (!write_value(values[i]))
+                {
+                    _out += TXT("null");
+                }
+            }
+
+            _newline.resize(_newline.size() - _indent.size());
+            newline();
+        }
+
+        _out += TXT(']');
     }
 
-    js::boolean test(js::string val)
+    template <typename S>
+    void write_object(S &storage)
     {
-        try
+        _out += TXT('{');
+        _newline += _indent;
+        auto empty = true;
+        for (auto it = storage.begin(); it != storage.end(); ++it)
         {
-            if (std::regex_search((const char_t *)val, re))
+            auto entry = *it;
+            auto mark = _out.size();
+            if (!empty)
             {
-                return true;
+                _out += TXT(',');
+            }
+
+            newline();
+            write_string(entry.first.view());
+            _out += _indent.empty() ? TXT(":") : TXT(": ");
+            if (!write_value(entry.second))
+            {
+                _out.resize(mark);
+                continue;
             }
+
+            empty = false;
         }
-        catch (std::regex_error &)
+
+        _newline.resize(_newline.size() - _indent.size());
+        if (!empty)
         {
+            newline();
         }
 
-        return false;
+        _out += TXT('}');
     }
 };
 
-template <typename T>
-struct TypedArray : public Array<T>
+// the space argument of JSON.stringify: up to 10 spaces, or the first 10 characters of a string
+static tstring indentation(any space)
 {
-    typedef Array<T> super__;
-    js::number _length;
-
-    TypedArray(js::number length_) : super__()
+    if (space.get_type() == any::anyTypeId::number_type)
     {
-        _length = length_;
+        auto count = static_cast<double>(space.number_ref());
+        return tstring(count < 1 ? 0 : count > 10 ? 10 : static_cast<size_t>(count), TXT(' '));
     }
-};
 
-struct Int16Array : TypedArray<short>
-{
-    Int16Array(js::number length_) : TypedArray(length_)
+    if (space.get_type() == any::anyTypeId::string_type && !space.string_ref().is_undefined())
     {
+        return tstring(space.string_ref().view().substr(0, 10));
     }
-};
 
-struct Uint16Array : TypedArray<unsigned short>
+    return tstring();
+}
+
+// SAX over a text in memory
+template <typename H>
+void parse(std::basic_string_view<char_t> text, H &handler)
 {
-    Uint16Array(js::number length_) : TypedArray(length_)
-    {
-    }
-};
+    parser<char_t, H>(handler, text).parse();
+}
 
-struct Float32Array : TypedArray<float>
+// SAX over a stream, read in chunks: memory use does not depend on the size of the input
+template <typename H>
+void parse(std::basic_istream<char_t> &input, H &handler)
 {
-    Float32Array(js::number length_) : TypedArray(length_)
-    {
-    }
-};
+    parser<char_t, H>(handler, input).parse();
+}
 
-struct Float64Array : TypedArray<double>
+// JSON.stringify straight into a stream; returns false for undefined and functions, which write nothing
+static bool stringify(tostream &output, const any &value, tstring indent = tstring())
 {
-    Float64Array(js::number length_) : TypedArray(length_)
-    {
-    }
-};
+    writer out(&output, indent);
+    auto written = out.write_value(value);
+    out.flush(0);
+    return written;
+}
 
-struct Int32Array : TypedArray<int>
+} // namespace json
+
+static struct JSON_t
 {
-    Int32Array(js::number length_) : TypedArray(length_)
+    constexpr JSON_t *operator->()
     {
+        return this;
     }
-};
 
-struct Uint32Array : TypedArray<unsigned int>
-{
-    Uint32Array(js::number length_) : TypedArray(length_)
+    static any parse(const js::string &text)
     {
+        json::builder builder;
+        json::parse(text.view(), builder);
+        return builder._result;
     }
-};
 
-struct Int64Array : TypedArray<long long>
-{
-    Int64Array(js::number length_) : TypedArray(length_)
+    static js::string stringify(const any &value)
     {
+        json::writer out;
+        return out.write_value(value) ? js::string(std::move(out._out)) : js::string();
     }
-};
 
-struct Uint64Array : TypedArray<unsigned long long>
-{
-    Uint64Array(js::number length_) : TypedArray(length_)
+    static js::string stringify(const any &value, any replacer, any space = any())
     {
+        if (replacer != null && replacer != undefined)
+        {
+            throw "JSON.stringify: replacer is not supported";
+        }
+
+        json::writer out(nullptr, json::indentation(space));
+        return out.write_value(value) ? js::string(std::move(out._out)) : js::string();
     }
-};
+} JSON;
 
-struct ArrayBuffer
+namespace utils
 {
-};
 
-struct ArrayBufferView
+// monotonic clock of performance.now: the time stamp counter where there is one, scaled by a rate measured once
+// against steady_clock, else steady_clock itself. Time 0 is the first use, which pays the 2ms of calibration
+struct tsc_clock
 {
-};
+    struct calibration
+    {
+        std::uint64_t origin;
+        double ms_per_tick;
+    };
 
-template <typename T>
-struct Promise
-{
-    static void all()
+    static std::uint64_t ticks()
     {
+#ifdef JS_SIMD_X86
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
     }
 
-    void _catch()
+    static const calibration &shared()
     {
+        static const calibration value = [] {
+            using namespace std::chrono;
+#ifdef JS_SIMD_X86
+            auto start = steady_clock::now();
+            auto first = ticks();
+            auto end = start;
+            while (end - start < milliseconds(2))
+            {
+                end = steady_clock::now();
+            }
+
+            auto last = ticks();
+            return calibration{last, duration<double, std::milli>(end - start).count() / static_cast<double>(last - first)};
+#else
+            return calibration{ticks(), duration<double, std::milli>(steady_clock::duration(1)).count()};
+#endif
+        }();
+        return value;
     }
 
-    void finally()
+    static double now()
     {
+        auto &value = shared();
+        return static_cast<double>(ticks() - value.origin) * value.ms_per_tick;
     }
+};
+
+// performance.mark/measure as Chrome trace events. Every thread appends to its own buffer, linked into a lock-free
+// list once and never freed, like the stats blocks; a chunk publishes its count with release, so the export reads
+// whole events only. MAIN writes them to the file named by the JS_TRACE_FILE environment variable
+struct trace_events
+{
+    static constexpr size_t chunk_size = 256;
+
+    struct event
+    {
+        js::string name;
+        double start;
+        // negative for a mark
+        double duration;
+    };
+
+    struct chunk
+    {
+        event events[chunk_size];
+        std::atomic<size_t> count{0};
+        std::atomic<chunk *> next{nullptr};
+    };
 
-    void then()
+    struct buffer
     {
+        chunk first;
+        chunk *last = &first;
+        std::uint32_t tid = 0;
+        buffer *next = nullptr;
+        // mark times for measure, only touched by the owner
+        std::unordered_map<tstring, double> marks;
+
+        void append(event value)
+        {
+            auto index = last->count.load(std::memory_order_relaxed);
+            if (index == chunk_size)
+            {
+                auto created = new chunk();
+                last->next.store(created, std::memory_order_release);
+                last = created;
+                index = 0;
+            }
+
+            last->events[index] = std::move(value);
+            last->count.store(index + 1, std::memory_order_release);
+        }
+    };
+
+    static std::atomic<buffer *> &head()
+    {
+        static std::atomic<buffer *> first{nullptr};
+        return first;
     }
 
-    static void race()
+    static buffer &local()
     {
+        thread_local buffer *current = [] {
+            static std::atomic<std::uint32_t> ids{0};
+            auto created = new buffer();
+            created->tid = ++ids;
+            auto &first = head();
+            created->next = first.load(std::memory_order_relaxed);
+            while (!first.compare_exchange_weak(created->next, created, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+
+            return created;
+        }();
+        return *current;
     }
 
-    static void reject()
+    static void write(tostream &output)
     {
+        json::writer out(&output);
+        out._out += TXT("{\"traceEvents\":[");
+        auto next = false;
+        for (auto current = head().load(std::memory_order_acquire); current; current = current->next)
+        {
+            for (auto part = &current->first; part; part = part->next.load(std::memory_order_acquire))
+            {
+                for (size_t i = 0, count = part->count.load(std::memory_order_acquire); i < count; i++)
+                {
+                    auto &item = part->events[i];
+                    if (next)
+                    {
+                        out._out += TXT(',');
+                    }
+
+                    out._out += TXT("{\"name\":");
+                    out.write_string(item.name.view());
+                    out._out += item.duration < 0 ? TXT(",\"ph\":\"i\",\"s\":\"t\"") : TXT(",\"ph\":\"X\",\"dur\":");
+                    if (item.duration >= 0)
+                    {
+                        out._out += to_tstring(item.duration * 1000);
+                    }
+
+                    out._out += TXT(",\"ts\":");
+                    out._out += to_tstring(item.start * 1000);
+                    out._out += TXT(",\"pid\":1,\"tid\":");
+                    out._out += to_tstring(current->tid);
+                    out._out += TXT('}');
+                    out.flush();
+                    next = true;
+                }
+            }
+        }
+
+        out._out += TXT("]}");
+        out.flush(0);
     }
 
-    static void resolve()
+    // at MAIN exit, after every thread of the pool has finished
+    static void export_file()
     {
+        auto path = std::getenv("JS_TRACE_FILE");
+        if (!path || !*path || !head().load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        std::basic_ofstream<char_t> file(path, std::ios::binary);
+        write(file);
     }
 };
 
-static struct math_t
-{
-    static number E;
-    static number LN10;
-    static number LN2;
-    static number LOG2E;
-    static number LOG10E;
-    static number PI;
-    static number SQRT1_2;
-    static number SQRT2;
+} // namespace utils
 
-    constexpr math_t *operator->()
+// performance.now, mark and measure on the TSC clock, in milliseconds
+static struct performance_t
+{
+    constexpr performance_t *operator->()
     {
         return this;
     }
 
-    static number pow(number op1, number op2)
+    static js::number now()
     {
-        return number(std::pow(static_cast<double>(op1), static_cast<double>(op2)));
+        return js::number(utils::tsc_clock::now());
     }
 
-    static number min(number op1, number op2)
+    static void mark(const js::string &name)
     {
-        return number(std::min(static_cast<double>(op1), static_cast<double>(op2)));
+        auto time = utils::tsc_clock::now();
+        auto &buffer = utils::trace_events::local();
+        buffer.marks[tstring(name.view())] = time;
+        buffer.append({name, time, -1});
     }
 
-    static number max(number op1, number op2)
+    // from the time origin to now
+    static void measure(const js::string &name)
     {
-        return number(std::max(static_cast<double>(op1), static_cast<double>(op2)));
+        record(name, 0, utils::tsc_clock::now());
     }
 
-    static number sin(number op1)
+    // from a mark of this thread to now
+    static void measure(const js::string &name, const js::string &startMark)
     {
-        return number(std::sin(static_cast<double>(op1)));
+        auto end = utils::tsc_clock::now();
+        record(name, mark_time(startMark), end);
     }
 
-    static number cos(number op1)
+    static void measure(const js::string &name, const js::string &startMark, const js::string &endMark)
     {
-        return number(std::cos(static_cast<double>(op1)));
+        record(name, mark_time(startMark), mark_time(endMark));
     }
 
-    static number asin(number op1)
+    static double mark_time(const js::string &name)
     {
-        return number(std::asin(static_cast<double>(op1)));
+        auto &marks = utils::trace_events::local().marks;
+        auto found = marks.find(tstring(name.view()));
+        if (found == marks.end())
+        {
+            throw "SyntaxError: performance.measure: no such mark";
+        }
+
+        return found->second;
     }
 
-    static number acos(number op1)
+    static void record(const js::string &name, double start, double end)
     {
-        return number(std::acos(static_cast<double>(op1)));
+        utils::trace_events::local().append({name, start, end - start});
     }
+} performance;
 
-    static number abs(number op1)
+template <typename I, class = std::enable_if_t<!std::is_enum_v<I>>>
+constexpr inline I pass(I i) {
+    return i;
+}
+
+template <typename I, class = std::enable_if_t<std::is_enum_v<I>>>
+constexpr inline size_t pass(I i) {
+    return static_cast<size_t>(i);
+}
+
+namespace utils
+{
+
+// console output: each thread builds its line alone, then hands it to a bounded lock-free queue that one background
+// thread writes out in batches. Lines stay whole and in order; a batch ends with one flush, not every line.
+// error() and flush() wait until everything logged before them is written, MAIN flushes on exit.
+// JS_CONSOLE_FORMAT=json in the environment turns lines into JSON objects with time, level and thread
+struct console_sink
+{
+    enum level_t : unsigned char
     {
-        return number(std::abs(static_cast<double>(op1)));
-    }
+        level_log,
+        level_warn,
+        level_error,
+        level_debug
+    };
 
-    static number floor(number op1)
+    static constexpr size_t capacity = 4096;
+
+    struct cell
     {
-        return number(std::floor(static_cast<double>(op1)));
-    }
+        std::atomic<size_t> sequence;
+        tstring text;
+        level_t level;
+    };
 
-    static number round(number op1, int numDecimalPlaces = 0)
+    // a stream writing into a string, one per thread, so arguments are formatted without a lock
+    struct line_buffer : public std::basic_streambuf<char_t>
     {
-        const auto mult = 10 ^ (numDecimalPlaces);
-        return number(std::floor(static_cast<double>(op1) * mult + 0.5) / mult);
-    }
+        tstring text;
 
-    static number sqrt(number op1)
+        int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                text += traits_type::to_char_type(c);
+            }
+
+            return c;
+        }
+
+        std::streamsize xsputn(const char_t *s, std::streamsize count) override
+        {
+            text.append(s, static_cast<size_t>(count));
+            return count;
+        }
+    };
+
+    struct line_writer
     {
-        return number(std::sqrt(static_cast<double>(op1)));
-    }
+        line_buffer buffer;
+        tostream stream;
+        tstring structured;
+        size_t thread;
 
-    static number tan(number op1)
+        line_writer() : stream(&buffer), thread(next_thread())
+        {
+            stream << std::boolalpha;
+        }
+
+        static size_t next_thread()
+        {
+            static std::atomic<size_t> count{0};
+            return ++count;
+        }
+    };
+
+    std::unique_ptr<cell[]> _cells;
+    std::atomic<size_t> _tail{0};
+    size_t _head = 0;
+    std::atomic<size_t> _published{0};
+    std::atomic<size_t> _written{0};
+    std::atomic<bool> _stopping{false};
+    std::once_flag _started;
+    std::thread _writer;
+    std::mutex _direct_mutex;
+    bool _structured;
+
+    console_sink() : _cells(new cell[capacity])
     {
-        return number(std::tan(static_cast<double>(op1)));
+        for (size_t i = 0; i < capacity; i++)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        auto format = std::getenv("JS_CONSOLE_FORMAT");
+        _structured = format != nullptr && std::string(format) == "json";
     }
 
-    static number atan(number op1)
+    ~console_sink()
     {
-        return number(std::atan(static_cast<double>(op1)));
+        shutdown();
     }
 
-    static number atan2(number op1, number op2)
+    static console_sink &shared()
     {
-        return number(std::atan2(static_cast<double>(op1), static_cast<double>(op2)));
+        static console_sink sink;
+        return sink;
     }
 
-    static number log(number op1)
+    static line_writer &local()
     {
-        return number(std::log(static_cast<double>(op1)));
+        thread_local line_writer writer;
+        return writer;
     }
 
-    static number exp(number op1)
+    static tostream &output(level_t level)
     {
-        return number(std::exp(static_cast<double>(op1)));
+#ifdef UNICODE
+        return level == level_log ? std::wcout : level == level_error ? std::wcerr : std::wclog;
+#else
+        return level == level_log ? std::cout : level == level_error ? std::cerr : std::clog;
+#endif
     }
 
-    static number random()
+    template <class... Args>
+    void write(level_t level, Args &&...args)
+    {
+        auto &writer = local();
+        writer.buffer.text.clear();
+        auto dummy = {(writer.stream << pass(args), 0)...};
+        auto &line = _structured ? structure(writer, level) : writer.buffer.text;
+        line += TXT('\n');
+        push(level, line);
+    }
+
+    tstring &structure(line_writer &writer, level_t level)
+    {
+        constexpr const char_t *names[] = {TXT("log"), TXT("warn"), TXT("error"), TXT("debug")};
+        auto now = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+        json::writer out;
+        out._out.swap(writer.structured);
+        out._out.clear();
+        out._out += TXT("{\"time\":");
+        append_number(out._out, std::floor(now));
+        out._out += TXT(",\"level\":\"");
+        out._out += names[level];
+        out._out += TXT("\",\"thread\":");
+        append_number(out._out, static_cast<double>(writer.thread));
+        out._out += TXT(",\"message\":");
+        out.write_string(writer.buffer.text);
+        out._out += TXT('}');
+        out._out.swap(writer.structured);
+        return writer.structured;
+    }
+
+    // the line's storage is swapped with the cell's, so both sides keep reusing their allocations
+    void push(level_t level, tstring &line)
+    {
+        if (_stopping.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(_direct_mutex);
+            output(level).write(line.data(), line.size()).flush();
+            return;
+        }
+
+        std::call_once(_started, [this]() { _writer = std::thread([this]() { drain(); }); });
+
+        auto position = _tail.load(std::memory_order_relaxed);
+        cell *target;
+        for (;;)
+        {
+            target = &_cells[position & (capacity - 1)];
+            auto sequence = target->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (difference == 0)
+            {
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // full: the writer is behind, let it run
+                std::this_thread::yield();
+                position = _tail.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->text.swap(line);
+        target->level = level;
+        target->sequence.store(position + 1, std::memory_order_release);
+        _published.fetch_add(1, std::memory_order_release);
+        _published.notify_one();
+    }
+
+    void drain()
     {
-        std::default_random_engine generator;
-        std::uniform_real_distribution<double> distribution(0.0, 1.0);
-        auto rnd = distribution(generator);
-        return number(rnd);
+        tstring batch;
+        for (;;)
+        {
+            auto seen = _published.load(std::memory_order_acquire);
+            auto any = false;
+            level_t batch_level = level_log;
+            for (;;)
+            {
+                auto &current = _cells[_head & (capacity - 1)];
+                if (current.sequence.load(std::memory_order_acquire) != _head + 1)
+                {
+                    break;
+                }
+
+                if (any && current.level != batch_level && !batch.empty())
+                {
+                    output(batch_level).write(batch.data(), batch.size());
+                    batch.clear();
+                }
+
+                batch_level = current.level;
+                batch += current.text;
+                current.text.clear();
+                current.sequence.store(_head + capacity, std::memory_order_release);
+                _head++;
+                any = true;
+            }
+
+            if (any)
+            {
+                output(batch_level).write(batch.data(), batch.size());
+                batch.clear();
+                std::cout.flush();
+                std::cerr.flush();
+                std::clog.flush();
+#ifdef UNICODE
+                std::wcout.flush();
+                std::wcerr.flush();
+                std::wclog.flush();
+#endif
+                _written.store(_head, std::memory_order_release);
+                _written.notify_all();
+                continue;
+            }
+
+            if (_stopping.load(std::memory_order_acquire) && _head == _tail.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            _published.wait(seen, std::memory_order_acquire);
+        }
     }
 
-    static number sign(number op1)
+    // waits until every line pushed before the call is written
+    void flush()
     {
-        auto d = static_cast<double>(op1);
-        return number(d < 0 ? -1 : d > 0 ? 1 : 0);
+        if (!_writer.joinable() || _writer.get_id() == std::this_thread::get_id())
+        {
+            return;
+        }
+
+        auto target = _tail.load(std::memory_order_acquire);
+        for (auto written = _written.load(std::memory_order_acquire); written < target; written = _written.load(std::memory_order_acquire))
+        {
+            _written.wait(written, std::memory_order_acquire);
+        }
     }
-} Math;
 
-static number E(2.718281828459045);
-static number LN10(2.302585092994046);
-static number LN2(0.6931471805599453);
-static number LOG2E(1.4426950408889634);
-static number LOG10E(0.4342944819032518);
-static number PI(3.141592653589793);
-static number SQRT1_2(0.7071067811865476);
-static number SQRT2(1.4142135623730951);
+    void shutdown()
+    {
+        if (_stopping.exchange(true))
+        {
+            return;
+        }
 
-template <typename I, class = std::enable_if_t<!std::is_enum_v<I>>>
-constexpr inline I pass(I i) {
-    return i;
-}
+        if (_writer.joinable())
+        {
+            _published.fetch_add(1, std::memory_order_release);
+            _published.notify_one();
+            _writer.join();
+        }
+    }
+};
 
-template <typename I, class = std::enable_if_t<std::is_enum_v<I>>>
-constexpr inline size_t pass(I i) {
-    return static_cast<size_t>(i);
-}
+} // namespace utils
 
 static struct Console
 {
@@ -4301,51 +12138,33 @@ static struct Console
     template <class... Args>
     void log(Args&&... args)
     {
-#ifdef UNICODE        
-        auto dummy = { (std::wcout << pass(args), 0)... };
-        std::wcout << std::endl;
-#else
-        auto dummy = { (std::cout << pass(args), 0)... };
-        std::cout << std::endl;
-#endif        
+        utils::console_sink::shared().write(utils::console_sink::level_log, args...);
     }
 
     template <class... Args>
     void warn(Args&&... args)
     {
-#ifdef UNICODE 
-        auto dummy = { (std::wclog << pass(args), 0)... };
-        std::wclog << std::endl;
-#else        
-        auto dummy = { (std::clog << pass(args), 0)... };
-        std::clog << std::endl;
-#endif          
+        utils::console_sink::shared().write(utils::console_sink::level_warn, args...);
     }
 
     template <class... Args>
     void error(Args&&... args)
     {
-#ifdef UNICODE 
-        auto dummy = { (std::wcerr << pass(args), 0)... };
-        std::wcerr << std::endl;
-#else        
-        auto dummy = { (std::cerr << pass(args), 0)... };
-        std::cerr << std::endl;
-#endif          
+        auto &sink = utils::console_sink::shared();
+        sink.write(utils::console_sink::level_error, args...);
+        sink.flush();
     }
 
     template <class... Args>
     void debug(Args&&... args)
     {
-#ifdef UNICODE 
-        auto dummy = { (std::wclog << pass(args), 0)... };
-        std::wclog << std::endl;
-#else        
-        auto dummy = { (std::clog << pass(args), 0)... };
-        std::clog << std::endl;
-#endif          
+        utils::console_sink::shared().write(utils::console_sink::level_debug, args...);
     }
 
+    void flush()
+    {
+        utils::console_sink::shared().flush();
+    }
 
 } console;
 
@@ -4380,10 +12199,6 @@ struct Blob
 {
 };
 
-struct DataView
-{
-};
-
 struct BodyInit
 {
 };
@@ -4419,4 +12234,15 @@ struct WebGLTexture
 // end of HTML
 } // namespace js
 
-#endif // CORE_H
\ No newline at end of file
+namespace std
+{
+
+template <typename T, typename... Args>
+struct coroutine_traits<std::shared_ptr<js::Promise<T>>, Args...>
+{
+    using promise_type = js::async_frame<T>;
+};
+
+} // namespace std
+
+#endif // CORE_H
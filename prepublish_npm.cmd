@@ -21,11 +21,13 @@ del "packages\tsc-cxx\lib\*.js.map"
 
 del "packages\tsc-cxx\cpplib\*.cpp"
 del "packages\tsc-cxx\cpplib\*.h"
+del "packages\tsc-cxx\cpplib\*.d.ts"
 
 @call tsc -p ./
 copy __out\*.js "packages\tsc-cxx\lib"
 copy __out\*.js.map "packages\tsc-cxx\lib"
 
 copy cpplib\core.h "packages\tsc-cxx\cpplib"
+copy cpplib\core.d.ts "packages\tsc-cxx\cpplib"
 
 cd ..\..
\ No newline at end of file
@@ -0,0 +1,29 @@
+import { Run } from '../src/compiler';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('Arena', () => {
+
+    const declarations = '/// <reference path="../cpplib/core.d.ts" />\n';
+
+    it('allocations inside withArena are released with it', () => expect(new Run().test([
+        'class Point {                              \
+            constructor(public x: number, public y: number) {} \
+        }                                           \
+        let total = 0;                              \
+        withArena(() => {                           \
+            for (let i = 0; i < 1000; i++) {        \
+                const p = new Point(i, 1);          \
+                total += p.y;                       \
+            }                                       \
+            const items = [1, 2, 3];                \
+            const names = { first: "a" };           \
+            total += items.length + names.first.length; \
+        });                                         \
+        withArena(() => {                           \
+            total += new Point(0, 2).y;             \
+        });                                         \
+        console.log(total);                         \
+    '], undefined, declarations)).to.equals('1006\r\n'));
+
+});
@@ -90,4 +90,24 @@ describe('Test 1', () => {
             x = "Hello World!";                 \
             console.log(x);                     \
         '])));
+
+    it('print - buffered lines keep their order before an exception', () => expect('1\r\n2\r\ndone\r\nException: stop\r\n').to.equals(new Run().test([
+        '                                       \
+            for (let i = 1; i <= 2; i++) {      \
+                console.log(i);                 \
+            }                                   \
+            console.log("done");                \
+            throw "stop";                       \
+        '])));
+
+    it('Date in UTC and performance.now', () => expect('1970-01-01T00:00:00.000Z\r\n1577836800000\r\n2\r\ntrue\r\n').to.equals(new Run().test([
+        '                                       \
+            console.log(new Date(0).toISOString()); \
+            console.log(Date.UTC(2020, 0, 1));  \
+            console.log(new Date(Date.UTC(2020, 1, 1)).getUTCMonth() + 1); \
+            const start = performance.now();    \
+            performance.mark("start");          \
+            performance.measure("run", "start"); \
+            console.log(performance.now() >= start); \
+        '])));
 });
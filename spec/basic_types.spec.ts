@@ -64,6 +64,93 @@ I\'ll be 38 years old next month.\r\n').to.equals(new Run().test([
         console.log(list2[2]);                  \
     '])));
 
+    it('Array - filter/map/reduce chain', () => expect('26\r\n-13\r\n3\r\n').to.equals(new Run().test([
+        'let list: number[] = [1, 2, 3, 4, 5];                                  \
+        console.log(list.filter(x => x > 1).map((x, i) => x * i).reduce((a, x) => a + x, 0)); \
+        console.log(list.reduce((a, x) => a - x));                              \
+        let big = list.map(x => x * 2).filter(x => x > 4);                      \
+        console.log(big.length);                                                \
+    '])));
+
+    it('Typed arrays share one buffer', () => expect('4\r\n1.5\r\n63\r\n').to.equals(new Run().test([
+        'let buffer = new ArrayBuffer(16);                  \
+        let floats = new Float32Array(buffer);              \
+        let view = new DataView(buffer);                    \
+        floats[1] = 1.5;                                    \
+        console.log(floats.length);                         \
+        console.log(floats[1]);                             \
+        console.log(view.getUint8(7));                      \
+    '])));
+
+    it('Typed arrays - stores wrap modulo 2^32', () => expect('1\r\n255\r\n-1\r\n').to.equals(new Run().test([
+        'let view = new DataView(new ArrayBuffer(8));       \
+        view.setInt32(0, 4294967297);                       \
+        console.log(view.getInt32(0));                      \
+        view.setUint8(4, -1);                               \
+        console.log(view.getUint8(4));                      \
+        let ints = new Int32Array(1);                       \
+        ints.fill(4294967295);                              \
+        console.log(ints[0]);                               \
+    '])));
+
+    it('Typed arrays - element-wise loop', () => expect('8\r\n1\r\n').to.equals(new Run().test([
+        'let a = new Float32Array(20);                      \
+        let b = new Float32Array(20);                       \
+        let c = new Float32Array(20);                       \
+        for (let i = 0; i < a.length; i++) { a[i] = i; b[i] = 2; } \
+        for (let i = 0; i < a.length; i++) c[i] = a[i] * b[i]; \
+        console.log(c[4]);                                  \
+        console.log(c.indexOf(2));                          \
+    '])));
+
+    it('Math.random', () => expect('true\r\ntrue\r\n').to.equals(new Run().test([
+        'const r = Math.random();                           \
+        console.log(r >= 0 && r < 1);                       \
+        console.log(r !== Math.random());                   \
+    '])));
+
+    it('Math.seed and Math.fillRandom', () => expect('true\r\ntrue\r\ntrue\r\ntrue\r\n').to.equals(new Run().test([
+        'Math.seed(42);                                     \
+        const a = Math.random();                            \
+        const b = Math.random();                            \
+        Math.seed(42);                                      \
+        console.log(a === Math.random());                   \
+        console.log(b === Math.random());                   \
+        Math.seed(7);                                       \
+        const v = Math.fillRandom(new Float64Array(4));     \
+        Math.seed(7);                                       \
+        console.log(v[0] === Math.random());                \
+        console.log(v[3] >= 0 && v[3] < 1);                 \
+    '], undefined, '/// <reference path="../cpplib/core.d.ts" />\n')));
+
+    it('Map and Set', () => expect('2\r\nb\r\n1\r\n2\r\n').to.equals(new Run().test([
+        'const m = new Map<number, string>();               \
+        m.set(1, "a");                                      \
+        m.set(2, "b");                                      \
+        m.set(1, "c");                                      \
+        console.log(m.size);                                \
+        console.log(m.get(2));                              \
+        m.delete(2);                                        \
+        console.log(m.size);                                \
+        const s: Set<string> = new Set();                   \
+        s.add("x");                                         \
+        s.add("y");                                         \
+        s.add("x");                                         \
+        console.log(s.size);                                \
+    '])));
+
+    it('Set - entries added inside for-of', () => expect('1\r\n2\r\n3\r\n4\r\n5\r\n5\r\n').to.equals(new Run().test([
+        'const s: Set<number> = new Set();                  \
+        s.add(1);                                           \
+        for (const x of s) {                                \
+            if (x < 5) {                                    \
+                s.add(x + 1);                               \
+            }                                               \
+            console.log(x);                                 \
+        }                                                   \
+        console.log(s.size);                                \
+    '])));
+
     it('Object', () => expect('1\r\n2\r\n3\r\n10\r\n').to.equals(new Run().test([
         'let list = {v1: 1, v2: 2, v3: 3};         \
         console.log(list["v1"]);                   \
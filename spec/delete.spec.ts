@@ -20,4 +20,16 @@ describe('Delete', () => {
         }                                           \
     '])).to.equals('obj2\r\nvalue\r\n'));
 
+    it('Array holes', () => expect(new Run().test([
+        'let a = [1, 2, 3];                         \
+        a[1000000] = 4;                             \
+        delete a[1];                                \
+        console.log(a.length);                      \
+        for (let i in a) {                          \
+            console.log(i);                         \
+        }                                           \
+        console.log(a[1]);                          \
+        console.log(a[2000000]);                    \
+    '])).to.equals('1000001\r\n0\r\n2\r\n1000000\r\nundefined\r\nundefined\r\n'));
+
 });
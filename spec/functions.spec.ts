@@ -230,4 +230,106 @@ describe('Functions', () => {
         console.log(b);                                                         \
     '])).to.equals('1\r\n2\r\n1\r\nundefined\r\n'));
 
+    it('call through any',  () => expect(new Run().test([
+        'let f: any = (x: number) => x * 3;                                     \
+        console.log(f(2));                                                      \
+    '])).to.equals('6\r\n'));
+
+    it('async/await and timers',  () => expect(new Run().test([
+        'async function twice(x: number): Promise<number> {                     \
+            const y = await Promise.resolve(x);                                 \
+            return y * 2;                                                       \
+        }                                                                       \
+        setTimeout(() => console.log("timeout"), 0);                            \
+        twice(2).then(v => console.log(v));                                     \
+        console.log("sync");                                                    \
+    '])).to.equals('sync\r\n4\r\ntimeout\r\n'));
+
+    it('async functions without await or return',  () => expect(new Run().test([
+        'async function log(x: number) {                                        \
+            console.log(x);                                                     \
+        }                                                                       \
+        async function run() {                                                  \
+            await log(1);                                                       \
+            console.log(2);                                                     \
+        }                                                                       \
+        run().then(() => console.log(3));                                       \
+    '])).to.equals('1\r\n2\r\n3\r\n'));
+
+    it('captured locals - synchronous and escaping lambdas',  () => expect(new Run().test([
+        'function counter() {                                                   \
+            let count = 0;                                                      \
+            return () => ++count;                                               \
+        }                                                                       \
+        let sum = 0;                                                            \
+        [1, 2, 3].forEach(x => { sum += x; });                                  \
+        const scaled = [1, 2, 3].map(x => x * sum);                             \
+        const next = counter();                                                 \
+        next();                                                                 \
+        console.log(sum);                                                       \
+        console.log(scaled[2]);                                                 \
+        console.log(next());                                                    \
+    '])).to.equals('6\r\n18\r\n2\r\n'));
+
+    it('captured locals - async lambdas outlive the frame',  () => expect(new Run().test([
+        'function start() {                                                     \
+            let sum = 0;                                                        \
+            let n = 0;                                                          \
+            [1, 2, 3].forEach(async x => { await Promise.resolve(0); sum += x; });  \
+            (async () => { await Promise.resolve(0); n++; })();                 \
+            setTimeout(() => console.log(sum + n), 0);                          \
+        }                                                                       \
+        start();                                                                \
+    '])).to.equals('7\r\n'));
+
+    it('read-only parameters and moved pushes',  () => expect(new Run().test([
+        'function greet(name: string, suffix: string): string {                 \
+            const text: string = "Hello " + name;                               \
+            return text + suffix;                                               \
+        }                                                                       \
+        function collect(n: number): string[] {                                 \
+            const items: string[] = [];                                         \
+            for (let i = 0; i < n; i++) {                                       \
+                const item: string = greet("x", "!");                           \
+                items.push(item);                                               \
+            }                                                                   \
+            return items;                                                       \
+        }                                                                       \
+        console.log(greet("World", "!"));                                       \
+        console.log(collect(2).length);                                         \
+    '])).to.equals('Hello World!\r\n2\r\n'));
+
+    it('read-only parameters keep the value the caller passed',  () => expect(new Run().test([
+        'let current: string = "old";                                           \
+        function change() {                                                     \
+            current = "new";                                                    \
+        }                                                                       \
+        function show(value: string): string {                                  \
+            change();                                                           \
+            return value;                                                       \
+        }                                                                       \
+        function replace(value: string): string {                               \
+            current = "newer";                                                  \
+            return value;                                                       \
+        }                                                                       \
+        console.log(show(current));                                             \
+        console.log(replace(current));                                          \
+    '])).to.equals('old\r\nnew\r\n'));
+
+    it('read-only parameters - library calls and member reads',  () => expect(new Run().test([
+        'function describe(point: any, name: string): string {                  \
+            console.log(point.x + Math.max(point.y, 1));                        \
+            return name.toUpperCase() + name.length;                            \
+        }                                                                       \
+        console.log(describe({ x: 1, y: 2 }, "p"));                             \
+    '])).to.equals('3\r\nP1\r\n'));
+
+    it('read-only parameters - emitted as const reference',  () => expect(new Run().emitSource(
+        'function describe(point: any, name: string): string {                  \
+            console.log(point.x + Math.max(point.y, 1));                        \
+            return name.toUpperCase() + name.length;                            \
+        }                                                                       \
+        describe({ x: 1, y: 2 }, "p");                                          \
+    ')).to.match(/describe\(const (js::)?any &point, const (js::)?string &name\)/));
+
 });
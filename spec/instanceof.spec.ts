@@ -14,4 +14,14 @@ describe('InstanceOf', () => {
         console.log(ok2 ? "true" : "false");        \
     '], { jslib: true })).to.equals('true\r\ntrue\r\ntrue\r\n'));
 
+    it('InstanceOf: class hierarchy', () => expect(new Run().test([
+        'class Animal { }                           \
+        class Dog extends Animal { }                \
+        class Cat extends Animal { }                \
+        const a: Animal = new Dog();                \
+        console.log(a instanceof Dog ? "true" : "false"); \
+        console.log(a instanceof Cat ? "true" : "false"); \
+        console.log(a instanceof Animal ? "true" : "false"); \
+    '])).to.equals('true\r\nfalse\r\ntrue\r\n'));
+
 });
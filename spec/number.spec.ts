@@ -56,4 +56,46 @@ describe('Numbers', () => {
          a += 1;                                \
          console.log(a);                        \
     '])).to.equals('false\r\nNaN\r\nNaN\r\n'));
+
+    it('Number to string and back', () => expect(new Run().test([
+        'console.log(0.1 + 0.2);                \
+         console.log(1e21);                     \
+         console.log(0.0000001);                \
+         console.log((255).toString(16));       \
+         console.log(parseInt("42px"));         \
+         console.log(parseFloat("abc"));        \
+    '])).to.equals('0.30000000000000004\r\n1e+21\r\n1e-7\r\nff\r\n42\r\nNaN\r\n'));
+
+    it('Int32 bitwise and integer loop counters', () => expect(new Run().test([
+        'function f(a: number[]) {              \
+            let s = 0;                          \
+            for (let i = 0; i < a.length; i++) {\
+                s += a[i] * i / 2;              \
+            }                                   \
+            for (let j = 3; j >= 0; j--) {      \
+                s += j % 2;                     \
+            }                                   \
+            return s;                           \
+         }                                      \
+         console.log(f([1, 2, 3]));             \
+         console.log(4294967295 | 0);           \
+         console.log(3000000000 >> 1);          \
+         console.log(-1 >>> 0);                 \
+         let r = 7.5;                           \
+         console.log(r % 2);                    \
+    '])).to.equals('6\r\n-1\r\n-647483648\r\n4294967295\r\n1.5\r\n'));
+
+    it('Integer loop counter copied into a local', () => expect(new Run().test([
+        'for (let i = 0; i < 2; i++) {          \
+            const j = i;                        \
+            console.log(j - 1);                 \
+         }                                      \
+    '])).to.equals('-1\r\n0\r\n'));
+
+    it('Remainder with a literal on the left', () => expect(new Run().test([
+        'let x = 1.5;                           \
+         console.log(5 % x);                    \
+         let y: any = 1.5;                      \
+         console.log(5 % y);                    \
+    '])).to.equals('0.5\r\n0.5\r\n'));
 });
@@ -46,4 +46,32 @@ describe('Objects', () => {
         console.log(mergedOptions.comparisonFunction);                      \
         console.log(mergedOptions.b1);                                      \
     '])));
+
+    it('object - constant keys with different shapes', () => expect('3\r\n7\r\n3\r\n').to.equals(new Run().test([
+        'function sum(o: any) {                                             \
+            return o.x + o.y;                                               \
+        }                                                                   \
+                                                                            \
+        console.log(sum({ x: 1, y: 2 }));                                   \
+        console.log(sum({ y: 3, x: 4 }));                                   \
+        let o: any = { x: 1, y: 2, z: 3 };                                  \
+        delete o.z;                                                         \
+        console.log(sum(o));                                                \
+    '])));
+
+    it('object - JSON round trip', () => expect('2\r\n{"a":[1,2.5],"b":{"c":"x"}}\r\n').to.equals(new Run().test([
+        'const o = JSON.parse(\'{ "a": [1, 2.5], "b": { "c": "x" } }\');     \
+        console.log(o.a.length);                                            \
+        console.log(JSON.stringify(o));                                     \
+    '])));
+
+    it('object - keys in insertion order', () => expect('b,a,c\r\nb,c,d\r\n3\r\n').to.equals(new Run().test([
+        'let o: any = { b: 1, a: 2 };                                       \
+        o.c = 3;                                                            \
+        console.log(Object.keys(o).join(","));                              \
+        delete o.a;                                                         \
+        o.d = 4;                                                            \
+        console.log(Object.keys(o).join(","));                              \
+        console.log(Object.values(Object.assign({}, o)).length);            \
+    '])));
 });
@@ -165,4 +165,21 @@ describe('Arithmetic Operators', () => {
         console.log(b);                             \
     '])));
 
+    it('Element writes (compound, increment, nested, method)', () => expect('2\r\n2\r\n1\r\n1\r\n').to.equals(new Run().test([
+        'let counts = [0, 0];                       \
+        for (let i = 0; i < 2; i++) {               \
+            counts[1] += 1;                         \
+        }                                           \
+        counts[0]++;                                \
+        counts[0]++;                                \
+        let grid = [[0, 0], [0, 0]];                \
+        grid[1][0] = 1;                             \
+        let lists: number[][] = [[]];               \
+        lists[0].push(7);                           \
+        console.log(counts[1]);                     \
+        console.log(counts[0]);                     \
+        console.log(grid[1][0]);                    \
+        console.log(lists[0].length);               \
+    '])));
+
 });
@@ -0,0 +1,34 @@
+import { Run } from '../src/compiler';
+import { expect } from 'chai';
+import { describe, it } from 'mocha';
+
+describe('Parallel array methods', () => {
+
+    const declarations = '/// <reference path="../cpplib/core.d.ts" />\n';
+
+    it('every method over several chunks', () => expect(new Run().test([
+        'const a: number[] = [];                    \
+        for (let i = 0; i < 3000; i++) {            \
+            a.push(i);                              \
+        }                                           \
+        const doubled = a.parallelMap(x => x * 2);  \
+        console.log(doubled[2999]);                 \
+        const even = a.parallelMap(x => x % 2 === 0); \
+        console.log(even.length);                   \
+        console.log(even[2998]);                    \
+        console.log(even[2999]);                    \
+        const big = a.parallelFilter(x => x >= 1000); \
+        console.log(big.length);                    \
+        console.log(big[0]);                        \
+        const seen = new Float64Array(3000);        \
+        a.parallelForEach((x, i) => { seen[i] = x + 1; }); \
+        console.log(seen[2999]);                    \
+        console.log(a.parallelReduce((s, x) => s + x, 0)); \
+        console.log(a.parallelEvery(x => x >= 0));  \
+        console.log(a.parallelEvery(x => x < 2999)); \
+        console.log(a.parallelSome(x => x > 2998)); \
+        console.log(a.parallelSome(x => x < 0));    \
+    '], undefined, declarations)).to.equals(
+        '5998\r\n3000\r\ntrue\r\nfalse\r\n2000\r\n1000\r\n3000\r\n4498500\r\ntrue\r\nfalse\r\ntrue\r\nfalse\r\n'));
+
+});
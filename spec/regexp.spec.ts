@@ -46,4 +46,12 @@ describe('RegExp', () => {
         console.log(b);                                     \
     '])));
 
+    it('RegExp exec, replace and split', () => expect('20\r\n20-10, 40-30\r\n2\r\n').to.equals(new Run().test([
+        'const s = \'10-20, 30-40\';                        \
+        const m = /(\\d+)-(\\d+)/.exec(s);                  \
+        console.log(m[2]);                                  \
+        console.log(s.replace(/(\\d+)-(\\d+)/g, \'$2-$1\')); \
+        console.log(s.split(/,\\s*/).length);               \
+    '])));
+
 });
@@ -9,4 +9,30 @@ describe('Strings', () => {
         console.log(s[1]);                                     \
     '])).to.equals('B\r\n'));
 
+    it('slices of long strings', () => expect(new Run().test([
+        'var s = "0123456789abcdefghijklmnopqrstuvwxyz";       \
+        var t = s.substring(1, 30);                            \
+        s += "!";                                              \
+        console.log(t.slice(0, 3));                            \
+        console.log(s.slice(-3));                              \
+    '])).to.equals('123\r\nyz!\r\n'));
+
+    it('concatenation in loop', () => expect(new Run().test([
+        'var s = "";                                           \
+        for (var i = 0; i < 3; i++) {                          \
+            s += "[" + i + "]";                                \
+            s = s + "-";                                       \
+        }                                                      \
+        console.log(`${s}:${s.length}`);                       \
+    '])).to.equals('[0]-[1]-[2]-:12\r\n'));
+
+    it('concatenation with itself', () => expect(new Run().test([
+        'let s: string = "ab";                                  \
+        s += "," + s;                                          \
+        console.log(s);                                        \
+        let t: string = "ab";                                  \
+        t = t + "-" + t;                                       \
+        console.log(t);                                        \
+    '])).to.equals('ab,ab\r\nab-ab\r\n'));
+
 });
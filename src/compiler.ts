@@ -1,5 +1,7 @@
 import * as ts from 'typescript';
 import * as fs from 'fs-extra';
+import * as crypto from 'crypto';
+import { Worker, MessageChannel, MessagePort, receiveMessageOnPort, isMainThread, workerData } from 'worker_threads';
 import { spawn } from 'cross-spawn';
 import { Emitter } from './emitter';
 import { Helpers } from './helpers';
@@ -48,10 +50,15 @@ const underlineStyleSequence = '\u001b[4m';
 const gutterStyleSequence = '\u001b[7m';
 const resetEscapeSequence = '\u001b[0m';
 
+// emission keys of the last build, stored next to the output
+const cacheFileName = '.tsc-cxx-cache.json';
+const cacheVersion = 1;
+
 export class Run {
 
     private formatHost: ts.FormatDiagnosticsHost;
     private versions: Map<string, number> = new Map<string, number>();
+    private emitterVersionValue: string;
 
     public constructor() {
         this.formatHost = <ts.FormatDiagnosticsHost>{
@@ -69,7 +76,12 @@ export class Run {
                 continue;
             }
 
-            options[item.substring(1)] = true;
+            const separator = item.indexOf('=');
+            if (separator === -1) {
+                options[item.substring(1)] = true;
+            } else {
+                options[item.substring(1, separator)] = item.substring(separator + 1);
+            }
         }
 
         return options;
@@ -228,6 +240,9 @@ export class Run {
             rootFolder += '/';
         }
 
+        const cache = this.loadCache(outDir);
+        const contentHashes = new Map<string, string>();
+        const staleFiles: ts.SourceFile[] = [];
         sourceFiles.filter(s => !s.fileName.endsWith('.d.ts') && sources.some(sf => s.fileName.endsWith(sf))).forEach(s => {
             // track version
             const paths = sources.filter(sf => s.fileName.endsWith(sf));
@@ -257,47 +272,249 @@ export class Run {
                 this.versions[s.fileName] = fileVersion;
             }
 
-            if (!cmdLineOptions.suppressOutput) {
-                console.log(
-                    ForegroundColorEscapeSequences.Cyan
-                    + 'Processing File: '
-                    + resetEscapeSequence
-                    + ForegroundColorEscapeSequences.White
-                    + s.fileName
-                    + resetEscapeSequence);
+            const outputs = this.outputFileNames(s.fileName, rootFolder);
+            const key = this.emissionKey(program, s, cmdLineOptions, contentHashes);
+            if (cache.entries[s.fileName] === key
+                && fs.existsSync(outDir + outputs.header)
+                && fs.existsSync(outDir + outputs.cpp)) {
+                if (!cmdLineOptions.suppressOutput) {
+                    console.log(
+                        'File: '
+                        + ForegroundColorEscapeSequences.White
+                        + s.fileName
+                        + resetEscapeSequence
+                        + ' and its dependencies are unchanged. '
+                        + ForegroundColorEscapeSequences.Red
+                        + 'Skipped.'
+                        + resetEscapeSequence);
+                }
+                return;
+            }
+
+            cache.entries[s.fileName] = key;
+            staleFiles.push(s);
+        });
+
+        const jobs = Math.min(parseInt(cmdLineOptions.jobs, 10) || 1, staleFiles.length);
+        if (jobs > 1) {
+            this.emitInWorkers(staleFiles.map(s => s.fileName), sources, options, cmdLineOptions, outDir, rootFolder, jobs);
+        } else {
+            staleFiles.forEach(s => this.emitFile(program, s, options, cmdLineOptions, outDir, rootFolder));
+        }
+
+        fs.writeFileSync(outDir + cacheFileName, JSON.stringify(cache));
+
+        if (!cmdLineOptions.suppressOutput) {
+            console.log(ForegroundColorEscapeSequences.Pink + 'Binary files have been generated...' + resetEscapeSequence);
+        }
+    }
+
+    public emitFile(
+        program: ts.Program, s: ts.SourceFile, options: ts.CompilerOptions, cmdLineOptions: any, outDir: string, rootFolder: string) {
+        if (!cmdLineOptions.suppressOutput) {
+            console.log(
+                ForegroundColorEscapeSequences.Cyan
+                + 'Processing File: '
+                + resetEscapeSequence
+                + ForegroundColorEscapeSequences.White
+                + s.fileName
+                + resetEscapeSequence);
+        }
+
+        const emitterHeader = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, program.getCurrentDirectory());
+        emitterHeader.HeaderMode = true;
+        emitterHeader.processNode(s);
+        const emitterSource = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, program.getCurrentDirectory());
+        emitterSource.SourceMode = true;
+        emitterSource.processNode(s);
+
+        const outputs = this.outputFileNames(s.fileName, rootFolder);
+
+        if (!cmdLineOptions.suppressOutput) {
+            console.log(
+                ForegroundColorEscapeSequences.Cyan
+                + 'Writing to file: '
+                + resetEscapeSequence
+                + ForegroundColorEscapeSequences.White
+                + outDir + outputs.cpp
+                + resetEscapeSequence);
+        }
+
+        this.writeFileIfChanged(outDir + outputs.header, emitterHeader.writer.getText());
+        this.writeFileIfChanged(outDir + outputs.cpp, emitterSource.writer.getText());
+    }
+
+    private outputFileNames(fileName: string, rootFolder: string) {
+        let fileNameNoExt = fileName.endsWith('.ts') ? fileName.substr(0, fileName.length - 3) : fileName;
+        if (fileNameNoExt.startsWith(rootFolder)) {
+            fileNameNoExt = fileNameNoExt.substring(rootFolder.length);
+        }
+
+        return {
+            header: Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'h')),
+            cpp: Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'cpp'))
+        };
+    }
+
+    // an unchanged output keeps its mtime, so the C++ build does not recompile it
+    private writeFileIfChanged(fileName: string, text: string) {
+        if (fs.existsSync(fileName) && fs.readFileSync(fileName).toString() === text) {
+            return;
+        }
+
+        fs.writeFileSync(fileName, text);
+    }
+
+    private loadCache(outDir: string): { version: number, entries: any } {
+        try {
+            const cache = JSON.parse(fs.readFileSync(outDir + cacheFileName).toString());
+            if (cache && cache.version === cacheVersion && cache.entries) {
+                return cache;
+            }
+        } catch (e) {
+            // no cache yet or unreadable, everything is emitted
+        }
+
+        return { version: cacheVersion, entries: {} };
+    }
+
+    private hash(text: string): string {
+        return crypto.createHash('sha1').update(text).digest('hex');
+    }
+
+    private emitterVersion(): string {
+        if (!this.emitterVersionValue) {
+            this.emitterVersionValue = this.hash(
+                ['./emitter', './preprocessor', './resolvers', './helpers', './codewriter']
+                    .map(m => fs.readFileSync(require.resolve(m)).toString())
+                    .join('\n'));
+        }
+
+        return this.emitterVersionValue;
+    }
+
+    // emitted code depends on the file, on everything it imports (transitively) and on the emitter.
+    // Script files (no import/export) share one global scope, so they depend on all other script files
+    private emissionKey(program: ts.Program, sourceFile: ts.SourceFile, cmdLineOptions: any, contentHashes: Map<string, string>) {
+        const contentHash = (file: ts.SourceFile) => {
+            let value = contentHashes.get(file.fileName);
+            if (!value) {
+                value = this.hash(file.text);
+                contentHashes.set(file.fileName, value);
+            }
+
+            return value;
+        };
+
+        const dependencies = new Set<ts.SourceFile>();
+        const visit = (file: ts.SourceFile) => {
+            if (!file || dependencies.has(file) || program.isSourceFileDefaultLibrary(file)) {
+                return;
             }
 
-            const emitterHeader = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, program.getCurrentDirectory());
-            emitterHeader.HeaderMode = true;
-            emitterHeader.processNode(s);
-            const emitterSource = new Emitter(program.getTypeChecker(), options, cmdLineOptions, false, program.getCurrentDirectory());
-            emitterSource.SourceMode = true;
-            emitterSource.processNode(s);
+            dependencies.add(file);
+            const resolvedModules = (<any>file).resolvedModules;
+            if (resolvedModules) {
+                resolvedModules.forEach((resolvedModule: ts.ResolvedModuleFull) => {
+                    if (resolvedModule && resolvedModule.resolvedFileName) {
+                        visit(program.getSourceFile(resolvedModule.resolvedFileName));
+                    }
+                });
+            }
 
-            let fileNameNoExt = s.fileName.endsWith('.ts') ? s.fileName.substr(0, s.fileName.length - 3) : s.fileName;
-            if (fileNameNoExt.startsWith(rootFolder)) {
-                fileNameNoExt = fileNameNoExt.substring(rootFolder.length);
+            if (!ts.isExternalModule(file)) {
+                program.getSourceFiles().filter(other => !ts.isExternalModule(other)).forEach(visit);
             }
+        };
+
+        visit(sourceFile);
+
+        const emissionOptions = Object.assign({}, cmdLineOptions);
+        delete emissionOptions.outDir;
+        delete emissionOptions.jobs;
+        delete emissionOptions.suppressOutput;
+        delete emissionOptions.watch;
+
+        const parts = Array.from(dependencies).map(file => file.fileName + ':' + contentHash(file)).sort();
+        parts.unshift(this.emitterVersion(), JSON.stringify(emissionOptions), sourceFile.fileName);
+        return this.hash(parts.join('\n'));
+    }
+
+    // the type checker can't be shared between threads: each worker builds its own program from the same roots and
+    // emits every n-th stale file. The driver stays synchronous, it blocks on a shared counter and then collects the
+    // workers' reports
+    private emitInWorkers(
+        files: string[], sources: string[], options: ts.CompilerOptions, cmdLineOptions: any,
+        outDir: string, rootFolder: string, jobs: number) {
+        const status = new Int32Array(new SharedArrayBuffer(4));
+        const ports: MessagePort[] = [];
+        for (let i = 0; i < jobs; i++) {
+            const channel = new MessageChannel();
+            ports.push(channel.port1);
+            const data = {
+                __tscCxxEmit: true,
+                files: files.filter((f, index) => index % jobs === i),
+                sources,
+                options,
+                cmdLineOptions,
+                outDir,
+                rootFolder,
+                status: status.buffer,
+                port: channel.port2
+            };
+
+            // a worker which fails to load reports and counts itself done as well, the driver never waits forever
+            const script = `
+                const { workerData } = require('worker_threads');
+                try {
+                    ${__filename.endsWith('.ts') ? `require('ts-node/register');` : ''}
+                    require(${JSON.stringify(__filename)});
+                } catch (e) {
+                    workerData.port.postMessage({ fileName: '', error: e.stack || String(e) });
+                    const status = new Int32Array(workerData.status);
+                    Atomics.add(status, 0, 1);
+                    Atomics.notify(status, 0);
+                }`;
+            new Worker(script, { eval: true, workerData: data, transferList: [channel.port2] }).unref();
+        }
+
+        for (let done = Atomics.load(status, 0); done < jobs; done = Atomics.load(status, 0)) {
+            Atomics.wait(status, 0, done);
+        }
 
-            const fileNameHeader = Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'h'));
-            const fileNameCpp = Helpers.correctFileNameForCxx(fileNameNoExt.concat('.', 'cpp'));
-
-            if (!cmdLineOptions.suppressOutput) {
-                console.log(
-                    ForegroundColorEscapeSequences.Cyan
-                    + 'Writing to file: '
-                    + resetEscapeSequence
-                    + ForegroundColorEscapeSequences.White
-                    + outDir + fileNameCpp
-                    + resetEscapeSequence);
+        const errors: string[] = [];
+        ports.forEach(port => {
+            for (let received = receiveMessageOnPort(port); received; received = receiveMessageOnPort(port)) {
+                if (received.message.error) {
+                    errors.push(received.message.fileName + ': ' + received.message.error);
+                }
             }
 
-            fs.writeFileSync(outDir + fileNameHeader, emitterHeader.writer.getText());
-            fs.writeFileSync(outDir + fileNameCpp, emitterSource.writer.getText());
+            port.close();
         });
 
-        if (!cmdLineOptions.suppressOutput) {
-            console.log(ForegroundColorEscapeSequences.Pink + 'Binary files have been generated...' + resetEscapeSequence);
+        if (errors.length) {
+            throw new Error(errors.join('\n'));
+        }
+    }
+
+    public emitWorker(data: any): void {
+        const status = new Int32Array(data.status);
+        try {
+            const program = ts.createProgram(data.sources, data.options || {});
+            data.files.forEach((fileName: string) => {
+                try {
+                    this.emitFile(
+                        program, program.getSourceFile(fileName), data.options, data.cmdLineOptions, data.outDir, data.rootFolder);
+                } catch (e) {
+                    data.port.postMessage({ fileName, error: e.stack || String(e) });
+                }
+            });
+        } catch (e) {
+            data.port.postMessage({ fileName: '', error: e.stack || String(e) });
+        } finally {
+            Atomics.add(status, 0, 1);
+            Atomics.notify(status, 0);
         }
     }
 
@@ -328,19 +545,19 @@ export class Run {
             sources.forEach((s: string, index: number) => {
                 if (fs.existsSync(s)) {
                     s = fs.readFileSync(s).toString();
-                    if (header) {
-                        if (fs.existsSync(header)) {
-                            s = fs.readFileSync(header).toString() + s;
-                        } else {
-                            s = header + s;
-                        }
+                }
+                if (header) {
+                    if (fs.existsSync(header)) {
+                        s = fs.readFileSync(header).toString() + s;
+                    } else {
+                        s = header + s;
                     }
-                    if (footer) {
-                        if (fs.existsSync(footer)) {
-                            s = s + fs.readFileSync(footer).toString();
-                        } else {
-                            s = s + footer;
-                        }
+                }
+                if (footer) {
+                    if (fs.existsSync(footer)) {
+                        s = s + fs.readFileSync(footer).toString();
+                    } else {
+                        s = s + footer;
                     }
                 }
 
@@ -406,4 +623,22 @@ export class Run {
 
         return actualOutput;
     }
+
+    public emitSource(source: string, cmdLineOptions?: any): string {
+        const fileName = 'test/emit_test.ts';
+        fs.writeFileSync(fileName, source);
+        try {
+            const program = ts.createProgram([fileName], {});
+            const emitter = new Emitter(program.getTypeChecker(), {}, cmdLineOptions || {}, false, program.getCurrentDirectory());
+            emitter.SourceMode = true;
+            emitter.processNode(program.getSourceFile(fileName));
+            return emitter.writer.getText();
+        } finally {
+            fs.unlinkSync(fileName);
+        }
+    }
+}
+
+if (!isMainThread && workerData && workerData.__tscCxxEmit) {
+    new Run().emitWorker(workerData);
 }
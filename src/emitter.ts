@@ -13,6 +13,12 @@ export class Emitter {
     private opsMap: Map<number, string> = new Map<number, string>();
     private embeddedCPPTypes: Array<string>;
     private isWritingMain = false;
+    private synchronousCallbackMethods = [
+        'forEach', 'map', 'filter', 'reduce', 'reduceRight', 'some', 'every', 'find', 'findIndex', 'sort', 'flatMap'];
+    private synchronousCallbackOwners = [
+        'Array', 'ReadonlyArray', 'Map', 'ReadonlyMap', 'Set', 'ReadonlySet',
+        'Int8Array', 'Uint8Array', 'Uint8ClampedArray', 'Int16Array', 'Uint16Array',
+        'Int32Array', 'Uint32Array', 'Float32Array', 'Float64Array'];
 
     public constructor(
         typeChecker: ts.TypeChecker, private options: ts.CompilerOptions,
@@ -29,9 +35,9 @@ export class Emitter {
         this.opsMap[ts.SyntaxKind.PercentToken] = '%';
         this.opsMap[ts.SyntaxKind.AsteriskAsteriskToken] = '__Math.pow';
         this.opsMap[ts.SyntaxKind.SlashToken] = '/';
-        this.opsMap[ts.SyntaxKind.AmpersandToken] = '__std::bit_and()';
-        this.opsMap[ts.SyntaxKind.BarToken] = '__std::bit_or()';
-        this.opsMap[ts.SyntaxKind.CaretToken] = '__std::bit_xor()';
+        this.opsMap[ts.SyntaxKind.AmpersandToken] = '__bitwise::bit_and';
+        this.opsMap[ts.SyntaxKind.BarToken] = '__bitwise::bit_or';
+        this.opsMap[ts.SyntaxKind.CaretToken] = '__bitwise::bit_xor';
         this.opsMap[ts.SyntaxKind.LessThanLessThanToken] = '__bitwise::lshift';
         this.opsMap[ts.SyntaxKind.GreaterThanGreaterThanToken] = '__bitwise::rshift';
         this.opsMap[ts.SyntaxKind.GreaterThanGreaterThanGreaterThanToken] = '__bitwise::rshift_nosign';
@@ -57,7 +63,7 @@ export class Emitter {
         this.opsMap[ts.SyntaxKind.GreaterThanGreaterThanEqualsToken] = '>>=';
         this.opsMap[ts.SyntaxKind.GreaterThanGreaterThanGreaterThanEqualsToken] = '__StrictNotEqualsAssign';
 
-        this.opsMap[ts.SyntaxKind.TildeToken] = '__std::bit_not()';
+        this.opsMap[ts.SyntaxKind.TildeToken] = '__bitwise::bit_not';
         this.opsMap[ts.SyntaxKind.ExclamationToken] = '!';
         this.opsMap[ts.SyntaxKind.PlusPlusToken] = '++';
         this.opsMap[ts.SyntaxKind.MinusMinusToken] = '--';
@@ -350,6 +356,301 @@ export class Emitter {
         return requireCaptureResult;
     }
 
+    private isFunctionLikeNode(node: ts.Node): boolean {
+        return node.kind === ts.SyntaxKind.FunctionDeclaration
+            || node.kind === ts.SyntaxKind.FunctionExpression
+            || node.kind === ts.SyntaxKind.ArrowFunction
+            || node.kind === ts.SyntaxKind.MethodDeclaration
+            || node.kind === ts.SyntaxKind.Constructor
+            || node.kind === ts.SyntaxKind.GetAccessor
+            || node.kind === ts.SyntaxKind.SetAccessor
+            || node.kind === ts.SyntaxKind.ClassDeclaration
+            || node.kind === ts.SyntaxKind.ClassExpression;
+    }
+
+    // lambda which can't outlive its frame: invoked in place or passed to a synchronous callback of a library collection
+    private isNonEscapingFunction(node: ts.Node): boolean {
+        if (node.kind !== ts.SyntaxKind.ArrowFunction && node.kind !== ts.SyntaxKind.FunctionExpression) {
+            return false;
+        }
+
+        // coroutines resume after the frame that started them has returned
+        if (this.isAsync(node) || (<ts.FunctionExpression>node).asteriskToken) {
+            return false;
+        }
+
+        let expression = node;
+        while (expression.parent && expression.parent.kind === ts.SyntaxKind.ParenthesizedExpression) {
+            expression = expression.parent;
+        }
+
+        if (!expression.parent || expression.parent.kind !== ts.SyntaxKind.CallExpression) {
+            return false;
+        }
+
+        const callExpression = <ts.CallExpression>expression.parent;
+        if (callExpression.expression === expression) {
+            return true;
+        }
+
+        if (callExpression.expression.kind !== ts.SyntaxKind.PropertyAccessExpression
+            || !callExpression.arguments.some(a => a === expression)) {
+            return false;
+        }
+
+        const method = <ts.PropertyAccessExpression>callExpression.expression;
+        if (this.synchronousCallbackMethods.indexOf(method.name.text) < 0) {
+            return false;
+        }
+
+        const symbol = this.resolver.getSymbolAtLocation(method.name);
+        const declaration = symbol && (symbol.valueDeclaration || symbol.declarations && symbol.declarations[0]);
+        const owner = declaration && declaration.parent;
+        return !!owner
+            && owner.kind === ts.SyntaxKind.InterfaceDeclaration
+            && this.synchronousCallbackOwners.indexOf((<ts.InterfaceDeclaration>owner).name.text) >= 0;
+    }
+
+    // only captures by lambdas which may outlive the frame need the variable boxed into shared<T>
+    private isCapturedByEscapingFunction(location: ts.Node, declaration: ts.Node): boolean {
+        let owner = declaration && declaration.parent;
+        while (owner && !this.isFunctionLikeNode(owner)) {
+            owner = owner.parent;
+        }
+
+        for (let current = location.parent; current && current !== owner; current = current.parent) {
+            if (this.isFunctionLikeNode(current) && !this.isNonEscapingFunction(current)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    private forEachReference(location: ts.Node, symbol: ts.Symbol, visit: (node: ts.Identifier, insideFunction: boolean) => void) {
+        const check = (child: ts.Node, insideFunction: boolean) => {
+            if (child.kind === ts.SyntaxKind.Identifier && this.resolver.getSymbolAtLocation(child) === symbol) {
+                visit(<ts.Identifier>child, insideFunction);
+                return;
+            }
+
+            const isFunction = this.isFunctionLikeNode(child);
+            ts.forEachChild(child, c => check(c, insideFunction || isFunction));
+        };
+
+        ts.forEachChild(location, c => check(c, false));
+    }
+
+    // a string, any or array parameter of a plain function which is only read (returned, copied, compared, its members
+    // read, passed to a library call) is taken by const reference. The reference is bound to the caller's variable, so
+    // the body may only make library calls and write its own locals, anything else could reassign that variable.
+    // Coroutines keep the copy (the frame outlives the caller's argument); so do functions used as values, as
+    // js::function unpacks its arguments into by value parameters
+    private isReadOnlyParameter(node: ts.Node, parameter: ts.ParameterDeclaration): boolean {
+        const type = parameter.type;
+        if (node.kind !== ts.SyntaxKind.FunctionDeclaration
+            || !(<ts.FunctionDeclaration>node).body
+            || !(<ts.FunctionDeclaration>node).name
+            || this.isAsync(node)
+            || (<ts.FunctionDeclaration>node).asteriskToken
+            || parameter.dotDotDotToken
+            || parameter.initializer
+            || parameter.questionToken
+            || parameter.name.kind !== ts.SyntaxKind.Identifier
+            || !type
+            || type.kind !== ts.SyntaxKind.StringKeyword
+                && type.kind !== ts.SyntaxKind.AnyKeyword
+                && type.kind !== ts.SyntaxKind.ArrayType) {
+            return false;
+        }
+
+        const functionSymbol = this.resolver.getSymbolAtLocation((<ts.FunctionDeclaration>node).name);
+        if (!functionSymbol || !functionSymbol.declarations || functionSymbol.declarations.length !== 1) {
+            return false;
+        }
+
+        if (this.mayChangeCallerState(<ts.FunctionDeclaration>node)) {
+            return false;
+        }
+
+        let safe = true;
+        this.forEachReference(node.getSourceFile(), functionSymbol, reference => {
+            safe = safe
+                && (reference.parent === node
+                    || reference.parent.kind === ts.SyntaxKind.CallExpression
+                        && (<ts.CallExpression>reference.parent).expression === reference);
+        });
+
+        const isString = type.kind === ts.SyntaxKind.StringKeyword;
+        const symbol = this.resolver.getSymbolAtLocation(parameter.name);
+        this.forEachReference((<ts.FunctionDeclaration>node).body, symbol, (reference, insideFunction) => {
+            const parent = reference.parent;
+            let read = false;
+            switch (parent.kind) {
+                case ts.SyntaxKind.CallExpression:
+                    // only library calls are left, see mayChangeCallerState
+                    read = (<ts.CallExpression>parent).arguments.some(a => a === reference);
+                    break;
+                case ts.SyntaxKind.PropertyAccessExpression:
+                    // p.x, and p.method() only on a string, whose methods change nothing
+                    const member = <ts.PropertyAccessExpression>parent;
+                    const isMethodCall = member.parent.kind === ts.SyntaxKind.CallExpression
+                        && (<ts.CallExpression>member.parent).expression === member;
+                    read = member.expression === reference && !this.isElementWrite(member) && (!isMethodCall || isString);
+                    break;
+                case ts.SyntaxKind.ElementAccessExpression:
+                    const element = <ts.ElementAccessExpression>parent;
+                    read = element.argumentExpression === reference || !this.isElementWrite(element);
+                    break;
+                case ts.SyntaxKind.ReturnStatement:
+                    read = true;
+                    break;
+                case ts.SyntaxKind.VariableDeclaration:
+                    read = (<ts.VariableDeclaration>parent).initializer === reference;
+                    break;
+                case ts.SyntaxKind.BinaryExpression:
+                    const binary = <ts.BinaryExpression>parent;
+                    const operator = binary.operatorToken.kind;
+                    const otherIsString = () =>
+                        this.resolver.isStringType(this.resolver.getOrResolveTypeOf(binary.left === reference ? binary.right : binary.left));
+                    read = operator === ts.SyntaxKind.EqualsToken && binary.right === reference
+                        || isString && operator === ts.SyntaxKind.PlusToken && binary.right === reference && otherIsString()
+                        || isString
+                            && (operator === ts.SyntaxKind.EqualsEqualsEqualsToken || operator === ts.SyntaxKind.ExclamationEqualsEqualsToken)
+                            && otherIsString();
+                    break;
+            }
+
+            safe = safe && read && !insideFunction;
+        });
+
+        return safe;
+    }
+
+    // console.log(...), Math.max(...), JSON.stringify(...) and methods of strings: library calls which run no code
+    // of the program but their callback arguments, and those are part of the body being checked
+    private isLibraryCall(node: ts.CallExpression): boolean {
+        if (node.expression.kind !== ts.SyntaxKind.PropertyAccessExpression) {
+            return false;
+        }
+
+        const receiver = (<ts.PropertyAccessExpression>node.expression).expression;
+        if (receiver.kind === ts.SyntaxKind.Identifier && ['console', 'Math', 'JSON'].indexOf((<ts.Identifier>receiver).text) >= 0) {
+            const symbol = this.resolver.getSymbolAtLocation(receiver);
+            const declaration = symbol && symbol.valueDeclaration;
+            return !declaration || declaration.getSourceFile().isDeclarationFile;
+        }
+
+        return this.resolver.isStringType(this.resolver.getOrResolveTypeOf(receiver));
+    }
+
+    // the body calls into the program, or writes to anything but a variable declared in the function itself
+    private mayChangeCallerState(node: ts.FunctionDeclaration): boolean {
+        const isLocal = (target: ts.Expression) => {
+            while (target.kind === ts.SyntaxKind.ParenthesizedExpression) {
+                target = (<ts.ParenthesizedExpression>target).expression;
+            }
+
+            if (target.kind !== ts.SyntaxKind.Identifier) {
+                return false;
+            }
+
+            const symbol = this.resolver.getSymbolAtLocation(target);
+            const declaration = symbol && symbol.valueDeclaration;
+            return declaration && declaration.pos >= node.pos && declaration.end <= node.end;
+        };
+
+        let changes = false;
+        const check = (child: ts.Node) => {
+            switch (child.kind) {
+                case ts.SyntaxKind.CallExpression:
+                    changes = changes || !this.isLibraryCall(<ts.CallExpression>child);
+                    break;
+                case ts.SyntaxKind.NewExpression:
+                case ts.SyntaxKind.TaggedTemplateExpression:
+                case ts.SyntaxKind.DeleteExpression:
+                    changes = true;
+                    break;
+                case ts.SyntaxKind.BinaryExpression:
+                    const binary = <ts.BinaryExpression>child;
+                    changes = changes
+                        || binary.operatorToken.kind >= ts.SyntaxKind.FirstAssignment
+                            && binary.operatorToken.kind <= ts.SyntaxKind.LastAssignment
+                            && !isLocal(binary.left);
+                    break;
+                case ts.SyntaxKind.PrefixUnaryExpression:
+                case ts.SyntaxKind.PostfixUnaryExpression:
+                    const unary = <ts.PrefixUnaryExpression>child;
+                    changes = changes
+                        || (unary.operator === ts.SyntaxKind.PlusPlusToken || unary.operator === ts.SyntaxKind.MinusMinusToken)
+                            && !isLocal(unary.operand);
+                    break;
+            }
+
+            if (!changes) {
+                ts.forEachChild(child, check);
+            }
+        };
+
+        ts.forEachChild(node.body, check);
+        return changes;
+    }
+
+    // the argument of 'push' is moved into the array when it is a local declared in the same block which isn't
+    // mentioned by any later statement of it, nor captured by a lambda
+    private isMovableLastUse(node: ts.Expression): boolean {
+        const call = <ts.CallExpression>node.parent;
+        if (node.kind !== ts.SyntaxKind.Identifier
+            || call.kind !== ts.SyntaxKind.CallExpression
+            || call.expression.kind !== ts.SyntaxKind.PropertyAccessExpression
+            || (<ts.PropertyAccessExpression>call.expression).name.text !== 'push'
+            || !this.resolver.isArrayType(this.resolver.getOrResolveTypeOf((<ts.PropertyAccessExpression>call.expression).expression))
+            || !call.parent
+            || call.parent.kind !== ts.SyntaxKind.ExpressionStatement) {
+            return false;
+        }
+
+        const symbol = this.resolver.getSymbolAtLocation(node);
+        const declaration = symbol && symbol.valueDeclaration;
+        if (!declaration
+            || declaration.kind !== ts.SyntaxKind.VariableDeclaration
+            || (<any>declaration).__requireCapture
+            || (<any>declaration).__counter_type
+            || declaration.parent.parent.kind !== ts.SyntaxKind.VariableStatement) {
+            return false;
+        }
+
+        const block = declaration.parent.parent.parent;
+        const statement = call.parent;
+        if (block !== statement.parent || block.kind !== ts.SyntaxKind.Block) {
+            return false;
+        }
+
+        // globals are visible to every function
+        let owner = block.parent;
+        while (owner && !this.isFunctionLikeNode(owner)) {
+            owner = owner.parent;
+        }
+
+        if (!owner) {
+            return false;
+        }
+
+        let safe = true;
+        let after = false;
+        for (const current of (<ts.Block>block).statements) {
+            if (current === statement) {
+                this.forEachReference(statement, symbol, reference => safe = safe && reference === node);
+                after = true;
+                continue;
+            }
+
+            this.forEachReference(current, symbol, (reference, insideFunction) => safe = safe && !after && !insideFunction);
+        }
+
+        return safe;
+    }
+
     private markRequiredCapture(location: ts.Node): void {
         this.childrenVisitorNoScope(location, (node: ts.Node) => {
             if (node.kind === ts.SyntaxKind.Identifier
@@ -361,7 +662,8 @@ export class Emitter {
                 if (data) {
                     const isLocal = data[0];
                     const resolvedSymbol = data[1];
-                    if (isLocal !== undefined && !isLocal) {
+                    if (isLocal !== undefined && !isLocal
+                        && this.isCapturedByEscapingFunction(node, (<any>resolvedSymbol).valueDeclaration)) {
                         (<any>resolvedSymbol).valueDeclaration.__requireCapture = true;
                     }
                 }
@@ -1271,6 +1573,7 @@ export class Emitter {
         this.processClassForwardDeclarationInternal(node);
 
         let next = false;
+        const bases: ts.ExpressionWithTypeArguments[] = [];
         if (node.heritageClauses) {
             let baseClass;
             node.heritageClauses.forEach(heritageClause => {
@@ -1296,6 +1599,7 @@ export class Emitter {
                         this.writer.writeString(identifier.text);
                         this.processTemplateArguments(type, true);
 
+                        bases.push(type);
                         next = true;
                     } else {
                         /* TODO: finish xxx.yyy<zzz> */
@@ -1324,6 +1628,8 @@ export class Emitter {
         this.processTemplateParameters(<ts.ClassDeclaration>node);
         this.writer.writeStringNewLine('>::shared_from_this;');
 
+        this.processClassInfo(node, bases);
+
         /*
         if (!node.heritageClauses) {
             // to make base class polymorphic
@@ -1367,6 +1673,33 @@ export class Emitter {
         }
     }
 
+    // class id and ancestors for instanceof and downcasts, see js::class_info
+    private processClassInfo(node: ts.ClassDeclaration | ts.InterfaceDeclaration, bases: ts.ExpressionWithTypeArguments[]) {
+        this.writer.writeString('using _class_type = ');
+        this.processIdentifier(node.name);
+        this.processTemplateParameters(<ts.ClassDeclaration>node);
+        this.writer.writeStringNewLine(';');
+
+        this.writer.writeString('static const js::class_info &_class() { static const js::class_info info{js::class_id<_class_type>(), {');
+        if (bases.length === 0) {
+            this.writer.writeString('&object::_class()');
+        }
+
+        bases.forEach((type, index) => {
+            if (index > 0) {
+                this.writer.writeString(', ');
+            }
+
+            this.writer.writeString('&');
+            this.writer.writeString((<ts.Identifier>type.expression).text);
+            this.processTemplateArguments(type, true);
+            this.writer.writeString('::_class()');
+        });
+
+        this.writer.writeStringNewLine('}}; return info; }');
+        this.writer.writeStringNewLine('virtual const js::class_info &_instance_class() const override { return _class(); }');
+    }
+
     private processPropertyDeclaration(node: ts.PropertyDeclaration | ts.PropertySignature | ts.ParameterDeclaration,
         implementationMode?: boolean): void {
         if (!implementationMode) {
@@ -1646,7 +1979,10 @@ export class Emitter {
             const effectiveType = firstType || this.resolver.getOrResolveTypeOfAsTypeNode(firstInitializer);
             const useAuto = autoAllowed && !!(firstInitializer);
             this.processPredefineType(effectiveType);
-            if (!forceCaptureRequired) {
+            const counterType = (<any>declarationList.declarations[0]).__counter_type;
+            if (counterType) {
+                this.writer.writeString(counterType);
+            } else if (!forceCaptureRequired) {
                 this.processType(effectiveType, useAuto);
             } else {
                 if (useAuto) {
@@ -2233,8 +2569,11 @@ export class Emitter {
             this.processModifiers(node.modifiers);
         }
 
+        const isAsync = this.isAsync(node);
         const writeReturnType = () => {
-            if (node.type) {
+            if (isAsync && !node.type) {
+                this.writer.writeString(noReturn ? 'std::shared_ptr<Promise<void>>' : 'std::shared_ptr<Promise<any>>');
+            } else if (node.type) {
                 if (this.isTemplateType(node.type)) {
                     this.writer.writeString('RET');
                 } else {
@@ -2315,7 +2654,7 @@ export class Emitter {
                 }
 
                 // lambda or noname function
-                const byReference = (<any>node).__lambda_by_reference ? '&' : '=';
+                const byReference = (<any>node).__lambda_by_reference || this.isNonEscapingFunction(node) ? '&' : '=';
                 this.writer.writeString(`[${byReference}]`);
             }
         }
@@ -2336,14 +2675,19 @@ export class Emitter {
             const effectiveType = element.type
                 || this.resolver.getOrResolveTypeOfAsTypeNode(element.initializer);
             if (element.dotDotDotToken) {
-                this.writer.writeString('Args...');
+                this.writer.writeString('Args... ');
             } else if (this.isTemplateType(effectiveType)) {
-                this.writer.writeString('P' + index);
+                this.writer.writeString('P' + index + ' ');
+            } else if (this.isReadOnlyParameter(node, element)) {
+                (<any>element).__read_only_parameter = true;
+                this.writer.writeString('const ');
+                this.processType(effectiveType, isArrowFunction);
+                this.writer.writeString(' &');
             } else {
                 this.processType(effectiveType, isArrowFunction);
+                this.writer.writeString(' ');
             }
 
-            this.writer.writeString(' ');
             this.processExpression(element.name);
 
             // extra symbol to change parameter name
@@ -2374,7 +2718,14 @@ export class Emitter {
         });
 
         if (isArrowFunction || isFunctionExpression) {
-            this.writer.writeStringNewLine(') mutable');
+            this.writer.writeString(') mutable');
+            if (isAsync) {
+                // coroutines can't deduce the return type
+                this.writer.writeString(' -> ');
+                writeReturnType();
+            }
+
+            this.writer.writeStringNewLine();
         } else {
             this.writer.writeStringNewLine(')');
         }
@@ -2465,13 +2816,20 @@ export class Emitter {
             });
 
             // add default return if no body
-            if (noReturnStatement && node && node.type && node.type.kind !== ts.SyntaxKind.VoidKeyword) {
+            if (noReturnStatement && node && node.type && node.type.kind !== ts.SyntaxKind.VoidKeyword && !isAsync) {
                 this.writer.writeString('return ');
                 writeReturnType();
                 this.writer.writeString('()');
                 this.writer.EndOfStatement();
             }
 
+            // an async body without await or return would be a plain function falling off its end
+            if (isAsync) {
+                this.writer.writeString('co_return');
+                this.writeAsyncDefaultValue(node);
+                this.writer.EndOfStatement();
+            }
+
             this.writer.EndBlock();
         }
     }
@@ -2592,6 +2950,31 @@ export class Emitter {
         }
     }
 
+    private isMapOrSetConstructor(typeInfo: ts.Type) {
+        return typeInfo && typeInfo.symbol
+            && (typeInfo.symbol.name === 'MapConstructor' || typeInfo.symbol.name === 'SetConstructor');
+    }
+
+    // new Map() takes its key and value types from the declaration it initializes
+    private processInferredTemplateArguments(node: ts.NewExpression) {
+        const type = <ts.TypeReferenceNode>this.resolver.typeToTypeNode(this.resolver.getOrResolveTypeOf(node));
+        if (!type || type.kind !== ts.SyntaxKind.TypeReference || !type.typeArguments) {
+            return;
+        }
+
+        this.writer.writeString('<');
+        let next = false;
+        type.typeArguments.forEach(element => {
+            if (next) {
+                this.writer.writeString(', ');
+            }
+
+            this.processType(element);
+            next = true;
+        });
+        this.writer.writeString('>');
+    }
+
     private processArrowFunction(node: ts.ArrowFunction): void {
         if (node.body.kind !== ts.SyntaxKind.Block) {
             // create body
@@ -2626,6 +3009,34 @@ export class Emitter {
         return node.modifiers && node.modifiers.some(m => m.kind === ts.SyntaxKind.StaticKeyword);
     }
 
+    // async functions are emitted as coroutines returning std::shared_ptr<Promise<T>>
+    private isAsync(node: ts.Node) {
+        return node && node.modifiers && node.modifiers.some(m => m.kind === ts.SyntaxKind.AsyncKeyword);
+    }
+
+    // ' T()' for the co_return that ends an async function resolving to T, nothing for Promise<void>
+    private writeAsyncDefaultValue(node: ts.FunctionLikeDeclaration) {
+        let valueType: ts.TypeNode;
+        if (node.type) {
+            const typeArguments = node.type.kind === ts.SyntaxKind.TypeReference && (<ts.TypeReferenceNode>node.type).typeArguments;
+            valueType = typeArguments && typeArguments[0];
+            if (valueType && valueType.kind === ts.SyntaxKind.VoidKeyword) {
+                return;
+            }
+        } else if (!this.hasReturnWithValue(node)) {
+            return;
+        }
+
+        this.writer.writeString(' ');
+        if (valueType) {
+            this.processType(valueType);
+        } else {
+            this.writer.writeString('any');
+        }
+
+        this.writer.writeString('()');
+    }
+
     private isAbstract(node: ts.Node) {
         return node.modifiers && node.modifiers.some(m => m.kind === ts.SyntaxKind.AbstractKeyword);
     }
@@ -2661,7 +3072,8 @@ export class Emitter {
             functionReturn = null;
         }
 
-        this.writer.writeString('return');
+        const isAsync = this.isAsync(functionDeclaration);
+        this.writer.writeString(isAsync ? 'co_return' : 'return');
         if (node.expression) {
             this.writer.writeString(' ');
 
@@ -2695,6 +3107,8 @@ export class Emitter {
                 this.writer.writeString(')');
             }
             */
+        } else if (isAsync) {
+            this.writeAsyncDefaultValue(functionDeclaration);
         } else {
             if (functionReturn && functionReturn.kind !== ts.SyntaxKind.VoidKeyword) {
                 this.writer.writeString(' ');
@@ -2736,6 +3150,15 @@ export class Emitter {
     }
 
     private processForStatement(node: ts.ForStatement): void {
+        if (this.processTypedArrayLoop(node)) {
+            return;
+        }
+
+        const counterType = this.inferLoopCounterType(node);
+        if (counterType) {
+            (<any>(<ts.VariableDeclarationList>node.initializer).declarations[0]).__counter_type = counterType;
+        }
+
         this.writer.writeString('for (');
         const initVar = <any>node.initializer;
         this.processExpression(initVar);
@@ -2747,6 +3170,280 @@ export class Emitter {
         this.processStatement(node.statement);
     }
 
+    private integerLiteralValue(expression: ts.Expression): number {
+        if (expression.kind === ts.SyntaxKind.PrefixUnaryExpression
+            && (<ts.PrefixUnaryExpression>expression).operator === ts.SyntaxKind.MinusToken) {
+            const value = this.integerLiteralValue((<ts.PrefixUnaryExpression>expression).operand);
+            return value === undefined ? undefined : -value;
+        }
+
+        if (expression.kind !== ts.SyntaxKind.NumericLiteral || !/^[0-9]+$/.test((<ts.NumericLiteral>expression).text)) {
+            return undefined;
+        }
+
+        return parseInt((<ts.NumericLiteral>expression).text, 10);
+    }
+
+    // a 'let' counter starting at a non-negative integer, stepping by an integer constant towards a '.length' or an
+    // integer constant bound, never written in the body and never captured, can't leave the int32 range and is never
+    // negative inside the body. It is declared as size_t (length bounds) or std::int32_t instead of js::number
+    private inferLoopCounterType(node: ts.ForStatement): string {
+        const initializer = node.initializer;
+        if (!initializer
+            || initializer.kind !== ts.SyntaxKind.VariableDeclarationList
+            || !(initializer.flags & ts.NodeFlags.Let)
+            || (<ts.VariableDeclarationList>initializer).declarations.length !== 1) {
+            return undefined;
+        }
+
+        const declaration = (<ts.VariableDeclarationList>initializer).declarations[0];
+        if (declaration.name.kind !== ts.SyntaxKind.Identifier
+            || !declaration.initializer
+            || declaration.type && declaration.type.kind !== ts.SyntaxKind.NumberKeyword
+            || (<any>declaration).__requireCapture) {
+            return undefined;
+        }
+
+        const start = this.integerLiteralValue(declaration.initializer);
+        if (start === undefined || start < 0 || start > 0x7fff0000) {
+            return undefined;
+        }
+
+        const symbol = this.resolver.getSymbolAtLocation(declaration.name);
+        const isCounter = (expression: ts.Node) =>
+            expression
+            && expression.kind === ts.SyntaxKind.Identifier
+            && this.resolver.getSymbolAtLocation(expression) === symbol;
+
+        let step: number;
+        const incrementor = node.incrementor;
+        if (incrementor
+            && (incrementor.kind === ts.SyntaxKind.PostfixUnaryExpression || incrementor.kind === ts.SyntaxKind.PrefixUnaryExpression)
+            && isCounter((<ts.PostfixUnaryExpression>incrementor).operand)) {
+            const operator = (<ts.PostfixUnaryExpression>incrementor).operator;
+            step = operator === ts.SyntaxKind.PlusPlusToken ? 1 : operator === ts.SyntaxKind.MinusMinusToken ? -1 : undefined;
+        } else if (incrementor
+            && incrementor.kind === ts.SyntaxKind.BinaryExpression
+            && isCounter((<ts.BinaryExpression>incrementor).left)) {
+            const operator = (<ts.BinaryExpression>incrementor).operatorToken.kind;
+            const amount = this.integerLiteralValue((<ts.BinaryExpression>incrementor).right);
+            if (amount !== undefined && amount > 0 && amount <= 0xffff) {
+                step = operator === ts.SyntaxKind.PlusEqualsToken
+                    ? amount
+                    : operator === ts.SyntaxKind.MinusEqualsToken ? -amount : undefined;
+            }
+        }
+
+        const condition = <ts.BinaryExpression>node.condition;
+        if (!step || !condition || condition.kind !== ts.SyntaxKind.BinaryExpression) {
+            return undefined;
+        }
+
+        const operatorKind = condition.operatorToken.kind;
+        const bound = isCounter(condition.left) ? condition.right : isCounter(condition.right) ? condition.left : undefined;
+        const lessThan = operatorKind === ts.SyntaxKind.LessThanToken || operatorKind === ts.SyntaxKind.LessThanEqualsToken;
+        const greaterThan = operatorKind === ts.SyntaxKind.GreaterThanToken || operatorKind === ts.SyntaxKind.GreaterThanEqualsToken;
+        const ascending = bound === condition.right ? lessThan : greaterThan;
+        const descending = bound === condition.right ? greaterThan : lessThan;
+        if (!bound || !(ascending && step > 0 || descending && step < 0)) {
+            return undefined;
+        }
+
+        let counterType: string;
+        if (bound.kind === ts.SyntaxKind.PropertyAccessExpression
+            && (<ts.PropertyAccessExpression>bound).name.text === 'length'
+            && this.resolver.isArrayOrStringType(this.resolver.getOrResolveTypeOf((<ts.PropertyAccessExpression>bound).expression))) {
+            if (!ascending) {
+                return undefined;
+            }
+
+            counterType = 'size_t';
+        } else {
+            const limit = this.integerLiteralValue(bound);
+            if (limit === undefined || limit < 0 || limit > 0x7fff0000) {
+                return undefined;
+            }
+
+            counterType = 'std::int32_t';
+        }
+
+        let unsafe = false;
+        const visit = (child: ts.Node, insideFunction: boolean) => {
+            if (unsafe) {
+                return;
+            }
+
+            if (isCounter(child)) {
+                const parent = child.parent;
+                const written =
+                    (parent.kind === ts.SyntaxKind.PrefixUnaryExpression || parent.kind === ts.SyntaxKind.PostfixUnaryExpression)
+                        && ((<ts.PrefixUnaryExpression>parent).operator === ts.SyntaxKind.PlusPlusToken
+                            || (<ts.PrefixUnaryExpression>parent).operator === ts.SyntaxKind.MinusMinusToken)
+                    || parent.kind === ts.SyntaxKind.BinaryExpression
+                        && (<ts.BinaryExpression>parent).left === child
+                        && (<ts.BinaryExpression>parent).operatorToken.kind >= ts.SyntaxKind.FirstAssignment
+                        && (<ts.BinaryExpression>parent).operatorToken.kind <= ts.SyntaxKind.LastAssignment
+                    || parent.kind === ts.SyntaxKind.ArrayLiteralExpression
+                    || parent.kind === ts.SyntaxKind.ShorthandPropertyAssignment;
+                unsafe = written || insideFunction;
+                return;
+            }
+
+            const isFunction = this.isFunctionLikeNode(child);
+            ts.forEachChild(child, c => visit(c, insideFunction || isFunction));
+        };
+
+        visit(condition, false);
+        visit(node.statement, false);
+        return unsafe ? undefined : counterType;
+    }
+
+    // reads of an inferred counter stay integral where C++ gives the JS result anyway: indexing and ordering
+    // comparisons; anywhere else the value is widened to js::number
+    private isIntegralCounterUse(node: ts.Identifier): boolean {
+        const parent = node.parent;
+        if (!parent) {
+            return true;
+        }
+
+        switch (parent.kind) {
+            case ts.SyntaxKind.VariableDeclaration:
+                // the counter's own declaration; const j = i gets js::number(i), or j - 1 would wrap
+                return (<ts.VariableDeclaration>parent).name === node;
+            case ts.SyntaxKind.PrefixUnaryExpression:
+            case ts.SyntaxKind.PostfixUnaryExpression:
+                return (<ts.PrefixUnaryExpression>parent).operator === ts.SyntaxKind.PlusPlusToken
+                    || (<ts.PrefixUnaryExpression>parent).operator === ts.SyntaxKind.MinusMinusToken;
+            case ts.SyntaxKind.ElementAccessExpression:
+                return (<ts.ElementAccessExpression>parent).argumentExpression === node;
+            case ts.SyntaxKind.BinaryExpression:
+                const binary = <ts.BinaryExpression>parent;
+                const operator = binary.operatorToken.kind;
+                if (binary.left === node && (operator === ts.SyntaxKind.PlusEqualsToken || operator === ts.SyntaxKind.MinusEqualsToken)) {
+                    return true;
+                }
+
+                // the other side must not be a signed C++ integer, size_t would compare it as unsigned
+                const other = binary.left === node ? binary.right : binary.left;
+                const otherSymbol = other.kind === ts.SyntaxKind.Identifier && this.resolver.getSymbolAtLocation(other);
+                return (operator === ts.SyntaxKind.LessThanToken
+                        || operator === ts.SyntaxKind.LessThanEqualsToken
+                        || operator === ts.SyntaxKind.GreaterThanToken
+                        || operator === ts.SyntaxKind.GreaterThanEqualsToken)
+                    && (other.kind === ts.SyntaxKind.NumericLiteral
+                        || other.kind === ts.SyntaxKind.PropertyAccessExpression
+                            && (<ts.PropertyAccessExpression>other).name.text === 'length'
+                            && this.resolver.isArrayOrStringType(
+                                this.resolver.getOrResolveTypeOf((<ts.PropertyAccessExpression>other).expression))
+                        || otherSymbol && otherSymbol.valueDeclaration && !!(<any>otherSymbol.valueDeclaration).__counter_type);
+        }
+
+        return false;
+    }
+
+    // for (let i = 0; i < a.length; i++) c[i] = a[i] * b[i]; over float typed arrays is one vectorized call.
+    // '+' and '*' only: JS rounds every operation, a fused multiply-add would not
+    private processTypedArrayLoop(node: ts.ForStatement): boolean {
+        const initializer = node.initializer;
+        if (!initializer
+            || initializer.kind !== ts.SyntaxKind.VariableDeclarationList
+            || !(initializer.flags & ts.NodeFlags.Let)
+            || (<ts.VariableDeclarationList>initializer).declarations.length !== 1) {
+            return false;
+        }
+
+        const declaration = (<ts.VariableDeclarationList>initializer).declarations[0];
+        if (declaration.name.kind !== ts.SyntaxKind.Identifier
+            || !declaration.initializer
+            || declaration.initializer.kind !== ts.SyntaxKind.NumericLiteral
+            || (<ts.NumericLiteral>declaration.initializer).text !== '0') {
+            return false;
+        }
+
+        const index = (<ts.Identifier>declaration.name).text;
+        const isIndex = (expression: ts.Node) =>
+            expression && expression.kind === ts.SyntaxKind.Identifier && (<ts.Identifier>expression).text === index;
+
+        const condition = <ts.BinaryExpression>node.condition;
+        if (!condition
+            || condition.kind !== ts.SyntaxKind.BinaryExpression
+            || condition.operatorToken.kind !== ts.SyntaxKind.LessThanToken
+            || !isIndex(condition.left)
+            || condition.right.kind !== ts.SyntaxKind.PropertyAccessExpression
+            || (<ts.PropertyAccessExpression>condition.right).name.text !== 'length'
+            || (<ts.PropertyAccessExpression>condition.right).expression.kind !== ts.SyntaxKind.Identifier) {
+            return false;
+        }
+
+        const incrementor = node.incrementor;
+        const isIncrement = incrementor
+            && (incrementor.kind === ts.SyntaxKind.PostfixUnaryExpression || incrementor.kind === ts.SyntaxKind.PrefixUnaryExpression)
+            && (<ts.PostfixUnaryExpression>incrementor).operator === ts.SyntaxKind.PlusPlusToken
+            && isIndex((<ts.PostfixUnaryExpression>incrementor).operand);
+        if (!isIncrement) {
+            return false;
+        }
+
+        let statement = node.statement;
+        if (statement.kind === ts.SyntaxKind.Block && (<ts.Block>statement).statements.length === 1) {
+            statement = (<ts.Block>statement).statements[0];
+        }
+
+        if (statement.kind !== ts.SyntaxKind.ExpressionStatement) {
+            return false;
+        }
+
+        const assignment = <ts.BinaryExpression>(<ts.ExpressionStatement>statement).expression;
+        if (assignment.kind !== ts.SyntaxKind.BinaryExpression
+            || assignment.operatorToken.kind !== ts.SyntaxKind.EqualsToken
+            || assignment.right.kind !== ts.SyntaxKind.BinaryExpression) {
+            return false;
+        }
+
+        const operation = <ts.BinaryExpression>assignment.right;
+        const kernel = operation.operatorToken.kind === ts.SyntaxKind.PlusToken
+            ? 'vector_add'
+            : operation.operatorToken.kind === ts.SyntaxKind.AsteriskToken
+                ? 'vector_mul'
+                : undefined;
+        if (!kernel) {
+            return false;
+        }
+
+        const floatArrayOf = (expression: ts.Expression) => {
+            if (expression.kind !== ts.SyntaxKind.ElementAccessExpression
+                || !isIndex((<ts.ElementAccessExpression>expression).argumentExpression)
+                || (<ts.ElementAccessExpression>expression).expression.kind !== ts.SyntaxKind.Identifier) {
+                return undefined;
+            }
+
+            const array = <ts.Identifier>(<ts.ElementAccessExpression>expression).expression;
+            const type = this.resolver.getOrResolveTypeOf(array);
+            const name = type && type.symbol && type.symbol.name;
+            return name === 'Float32Array' || name === 'Float64Array' ? { array, name } : undefined;
+        };
+
+        const out = floatArrayOf(assignment.left);
+        const left = floatArrayOf(operation.left);
+        const right = floatArrayOf(operation.right);
+        if (!out || !left || !right
+            || out.name !== left.name
+            || left.name !== right.name
+            || left.array.text !== (<ts.Identifier>(<ts.PropertyAccessExpression>condition.right).expression).text) {
+            return false;
+        }
+
+        this.writer.writeString(kernel + '(');
+        this.processExpression(out.array);
+        this.writer.writeString(', ');
+        this.processExpression(left.array);
+        this.writer.writeString(', ');
+        this.processExpression(right.array);
+        this.writer.writeString(')');
+        this.writer.EndOfStatement();
+        return true;
+    }
+
     private processForInStatement(node: ts.ForInStatement): void {
         this.processForInStatementNoScope(node);
     }
@@ -3022,9 +3719,18 @@ export class Emitter {
     }
 
     private processTemplateExpression(node: ts.TemplateExpression): void {
-        this.processStringLiteral(node.head);
+        this.writer.writeString('utils::concat(');
+        let next = false;
+        if (node.head.text) {
+            this.processStringLiteral(node.head);
+            next = true;
+        }
+
         node.templateSpans.forEach(element => {
-            this.writer.writeString(' + ');
+            if (next) {
+                this.writer.writeString(', ');
+            }
+
             if (element.expression.kind === ts.SyntaxKind.BinaryExpression) {
                 this.writer.writeString('(');
             }
@@ -3035,15 +3741,25 @@ export class Emitter {
                 this.writer.writeString(')');
             }
 
-            this.writer.writeString(' + ');
-            this.processStringLiteral(element.literal);
+            next = true;
+            if (element.literal.text) {
+                this.writer.writeString(', ');
+                this.processStringLiteral(element.literal);
+            }
         });
+
+        this.writer.writeString(')');
     }
 
+    // each literal is compiled once, on its first evaluation, and shared by every RegExp made from it
     private processRegularExpressionLiteral(node: ts.RegularExpressionLiteral): void {
-        this.writer.writeString('(new RegExp(');
-        this.processStringLiteral(<ts.LiteralLikeNode>{ text: node.text.substring(1, node.text.length - 2) });
-        this.writer.writeString('))');
+        const end = node.text.lastIndexOf('/');
+        const escape = (text: string) => text.replace(/\\/g, '\\\\').replace(/"/g, '\\"');
+        this.writer.writeString('REGEXP("');
+        this.writer.writeString(escape(node.text.substring(1, end)));
+        this.writer.writeString('", "');
+        this.writer.writeString(node.text.substring(end + 1));
+        this.writer.writeString('")');
     }
 
     private processObjectLiteralExpression(node: ts.ObjectLiteralExpression): void {
@@ -3216,13 +3932,8 @@ export class Emitter {
             this.processExpression(node.expression);
             this.writer.writeString(')');
         } else {
-            let isWriting = false;
+            const isWriting = this.isElementWrite(node);
             let dereference = true;
-            if (node.parent.kind === ts.SyntaxKind.BinaryExpression) {
-                const binaryExpression = <ts.BinaryExpression>node.parent;
-                isWriting = binaryExpression.operatorToken.kind === ts.SyntaxKind.EqualsToken
-                    && binaryExpression.left === node;
-            }
 
             dereference = type
                 && type.kind !== ts.SyntaxKind.TypeLiteral
@@ -3254,11 +3965,53 @@ export class Emitter {
             }
 
             this.writer.writeString('[');
-            this.processExpression(node.argumentExpression);
+            if (node.argumentExpression.kind === ts.SyntaxKind.StringLiteral
+                && (type && type.kind === ts.SyntaxKind.ObjectKeyword
+                    || this.resolver.isAnyLikeType(this.resolver.getOrResolveTypeOf(node.expression)))) {
+                // constant key, cached per call site
+                const text = (<ts.StringLiteral>node.argumentExpression).text.replace(/\n/g, '\\\n');
+                this.writer.writeString(text ? `PROP("${text}")` : 'string_empty');
+            } else {
+                this.processExpression(node.argumentExpression);
+            }
+
             this.writer.writeString(']');
         }
     }
 
+    // an element access which needs the mutable operator[]: the target of an assignment, compound assignment or
+    // ++/--, the object of a member access (methods and fields of the element are not const) or of an element write
+    private isElementWrite(node: ts.Expression): boolean {
+        let current: ts.Node = node;
+        while (current.parent && current.parent.kind === ts.SyntaxKind.ParenthesizedExpression) {
+            current = current.parent;
+        }
+
+        const parent = current.parent;
+        if (!parent) {
+            return false;
+        }
+
+        switch (parent.kind) {
+            case ts.SyntaxKind.BinaryExpression:
+                const operator = (<ts.BinaryExpression>parent).operatorToken.kind;
+                return (<ts.BinaryExpression>parent).left === current
+                    && operator >= ts.SyntaxKind.FirstAssignment
+                    && operator <= ts.SyntaxKind.LastAssignment;
+            case ts.SyntaxKind.PrefixUnaryExpression:
+            case ts.SyntaxKind.PostfixUnaryExpression:
+                const unary = (<ts.PrefixUnaryExpression>parent).operator;
+                return unary === ts.SyntaxKind.PlusPlusToken || unary === ts.SyntaxKind.MinusMinusToken;
+            case ts.SyntaxKind.PropertyAccessExpression:
+                return (<ts.PropertyAccessExpression>parent).expression === current;
+            case ts.SyntaxKind.ElementAccessExpression:
+                return (<ts.ElementAccessExpression>parent).expression === current
+                    && this.isElementWrite(<ts.ElementAccessExpression>parent);
+        }
+
+        return false;
+    }
+
     private processParenthesizedExpression(node: ts.ParenthesizedExpression) {
         this.writer.writeString('(');
         this.processExpression(node.expression);
@@ -3363,6 +4116,10 @@ export class Emitter {
             return;
         }
 
+        if (this.processStringAppendExpression(node)) {
+            return;
+        }
+
         const wrapIntoRoundBrackets =
             opCode === ts.SyntaxKind.AmpersandAmpersandToken
             || opCode === ts.SyntaxKind.BarBarToken;
@@ -3436,6 +4193,90 @@ export class Emitter {
         }
     }
 
+    private processStringAppendExpression(node: ts.BinaryExpression): boolean {
+        const opCode = node.operatorToken.kind;
+        if (opCode !== ts.SyntaxKind.PlusEqualsToken && opCode !== ts.SyntaxKind.EqualsToken) {
+            return false;
+        }
+
+        if (!this.resolver.isStringType(this.resolver.getOrResolveTypeOf(node.left))) {
+            return false;
+        }
+
+        const parts: ts.Expression[] = [];
+        let current = node.right;
+        while (current.kind === ts.SyntaxKind.BinaryExpression
+            && (<ts.BinaryExpression>current).operatorToken.kind === ts.SyntaxKind.PlusToken) {
+            parts.unshift((<ts.BinaryExpression>current).right);
+            current = (<ts.BinaryExpression>current).left;
+        }
+
+        parts.unshift(current);
+
+        // s = s + a + ... is the same as s += a + ...
+        if (opCode === ts.SyntaxKind.EqualsToken) {
+            if (node.left.kind !== ts.SyntaxKind.Identifier
+                || parts[0].kind !== ts.SyntaxKind.Identifier
+                || (<ts.Identifier>parts[0]).text !== (<ts.Identifier>node.left).text) {
+                return false;
+            }
+
+            parts.shift();
+        } else if (!this.resolver.isStringType(this.resolver.getOrResolveTypeOf(parts[0]))) {
+            // a + b could be a numeric sum
+            return false;
+        }
+
+        if (parts.length < 2 && opCode === ts.SyntaxKind.PlusEqualsToken) {
+            return false;
+        }
+
+        // append reads its arguments while the target grows: s += "," + s keeps the plain expression
+        const target = node.left.getText();
+        const mentionsTarget = (child: ts.Node): boolean => child.getText() === target || !!ts.forEachChild(child, mentionsTarget);
+        if (parts.some(mentionsTarget)) {
+            return false;
+        }
+
+        this.writer.writeString('utils::append(');
+        this.processExpression(node.left);
+        parts.forEach(element => {
+            this.writer.writeString(', ');
+            this.processExpression(element);
+        });
+
+        this.writer.writeString(')');
+        return true;
+    }
+
+    // a.filter(...).map(...).reduce(...) is emitted as one fused pass: a->lazy()->filter(...)->map(...)->reduce(...)
+    private isArrayPipelineStage(node: ts.Node): boolean {
+        if (node.kind !== ts.SyntaxKind.CallExpression
+            || (<ts.CallExpression>node).expression.kind !== ts.SyntaxKind.PropertyAccessExpression) {
+            return false;
+        }
+
+        const propertyAccess = <ts.PropertyAccessExpression>(<ts.CallExpression>node).expression;
+        const name = propertyAccess.name.text;
+        return (name === 'filter' || name === 'map')
+            && this.resolver.isArrayType(this.resolver.getOrResolveTypeOf(propertyAccess.expression));
+    }
+
+    private isArrayPipelineContinued(node: ts.CallExpression): boolean {
+        const parent = node.parent;
+        if (!parent
+            || parent.kind !== ts.SyntaxKind.PropertyAccessExpression
+            || (<ts.PropertyAccessExpression>parent).expression !== node
+            || !parent.parent
+            || parent.parent.kind !== ts.SyntaxKind.CallExpression
+            || (<ts.CallExpression>parent.parent).expression !== parent) {
+            return false;
+        }
+
+        const name = (<ts.PropertyAccessExpression>parent).name.text;
+        return ['filter', 'map', 'forEach', 'reduce', 'every', 'some'].indexOf(name) >= 0;
+    }
+
     private processDeleteExpression(node: ts.DeleteExpression): void {
         if (node.expression.kind === ts.SyntaxKind.PropertyAccessExpression) {
             const propertyAccess = <ts.PropertyAccessExpression>node.expression;
@@ -3473,7 +4314,7 @@ export class Emitter {
         const isArray = isNew && typeOfExpression && typeOfExpression.symbol && typeOfExpression.symbol.name === 'ArrayConstructor';
 
         if (node.kind === ts.SyntaxKind.NewExpression && !isArray) {
-            this.writer.writeString('std::make_shared<');
+            this.writer.writeString('js::make<');
         }
 
         if (isArray) {
@@ -3481,7 +4322,11 @@ export class Emitter {
         } else {
 
             this.processExpression(node.expression);
-            this.processTemplateArguments(node);
+            if (isNew && !node.typeArguments && this.isMapOrSetConstructor(<ts.Type>typeOfExpression)) {
+                this.processInferredTemplateArguments(node);
+            } else {
+                this.processTemplateArguments(node);
+            }
         }
 
         if (node.kind === ts.SyntaxKind.NewExpression && !isArray) {
@@ -3498,12 +4343,26 @@ export class Emitter {
                     this.writer.writeString(', ');
                 }
 
-                this.processExpression(element);
+                if (this.isMovableLastUse(element)) {
+                    this.writer.writeString('std::move(');
+                    this.processExpression(element);
+                    this.writer.writeString(')');
+                } else {
+                    this.processExpression(element);
+                }
+
                 next = true;
             });
         }
 
         this.writer.writeString(')');
+
+        // the chain result escapes, store it
+        if (this.isArrayPipelineStage(node)
+            && this.isArrayPipelineStage((<ts.PropertyAccessExpression>node.expression).expression)
+            && !this.isArrayPipelineContinued(<ts.CallExpression>node)) {
+            this.writer.writeString('->toArray()');
+        }
     }
 
     private processThisExpression(node: ts.ThisExpression): void {
@@ -3588,9 +4447,9 @@ export class Emitter {
     }
 
     private processAwaitExpression(node: ts.AwaitExpression): void {
-        this.writer.writeString('std::async([=]() { ');
+        this.writer.writeString('(co_await ');
         this.processExpression(node.expression);
-        this.writer.writeString('; })');
+        this.writer.writeString(')');
     }
 
     private processIdentifier(node: ts.Identifier): void {
@@ -3615,9 +4474,35 @@ export class Emitter {
             }
         }
 
+        const identifierDeclaration = node.parent && node.parent.kind !== ts.SyntaxKind.VariableDeclaration
+            && this.resolver.getSymbolAtLocation(node);
+        if (identifierDeclaration
+            && identifierDeclaration.valueDeclaration
+            && (<any>identifierDeclaration.valueDeclaration).__counter_type
+            && !this.isIntegralCounterUse(node)) {
+            this.writer.writeString('js::number(');
+            this.writer.writeString(node.text);
+            this.writer.writeString(')');
+            return;
+        }
+
+        // members of the runtime types are not const-qualified; a read-only parameter is only read through them
+        const parentAccess = <ts.PropertyAccessExpression | ts.ElementAccessExpression>node.parent;
+        if (identifierDeclaration
+            && identifierDeclaration.valueDeclaration
+            && (<any>identifierDeclaration.valueDeclaration).__read_only_parameter
+            && (parentAccess.kind === ts.SyntaxKind.PropertyAccessExpression || parentAccess.kind === ts.SyntaxKind.ElementAccessExpression)
+            && parentAccess.expression === node) {
+            this.writer.writeString('mutable_(');
+            this.writer.writeString(node.text);
+            this.writer.writeString(')');
+            return;
+        }
+
         // fix issue with 'continue'
         if (node.text === 'continue'
-            || node.text === 'catch') {
+            || node.text === 'catch'
+            || node.text === 'delete') {
             this.writer.writeString('_');
         }
 
@@ -3661,6 +4546,24 @@ export class Emitter {
                 this.writer.writeString(')');
             }
         } else {
+            // Promise is a class template, its statics need an argument list
+            if (node.expression.kind === ts.SyntaxKind.Identifier
+                && (<ts.Identifier>node.expression).text === 'Promise'
+                && typeInfo && typeInfo.symbol && typeInfo.symbol.name === 'PromiseConstructor') {
+                this.writer.writeString('Promise<>::');
+                this.processExpression(<ts.Identifier>node.name);
+                return;
+            }
+
+            // Date is a struct, its statics are called on the type
+            if (node.expression.kind === ts.SyntaxKind.Identifier
+                && (<ts.Identifier>node.expression).text === 'Date'
+                && typeInfo && typeInfo.symbol && typeInfo.symbol.name === 'DateConstructor') {
+                this.writer.writeString('Date::');
+                this.processExpression(<ts.Identifier>node.name);
+                return;
+            }
+
             if (node.expression.kind === ts.SyntaxKind.NewExpression
                 || node.expression.kind === ts.SyntaxKind.ArrayLiteralExpression) {
                 this.writer.writeString('(');
@@ -3674,10 +4577,17 @@ export class Emitter {
                 this.writer.writeString(')');
             }
 
+            if (this.isArrayPipelineStage(node.parent)
+                && (<ts.CallExpression>node.parent).expression === node
+                && !this.isArrayPipelineStage(node.expression)
+                && this.isArrayPipelineContinued(<ts.CallExpression>node.parent)) {
+                this.writer.writeString('->lazy()');
+            }
+
             if (this.resolver.isAnyLikeType(typeInfo)) {
-                this.writer.writeString('["');
+                this.writer.writeString('[PROP("');
                 this.processExpression(<ts.Identifier>node.name);
-                this.writer.writeString('"]');
+                this.writer.writeString('")]');
                 return;
             } else if (this.resolver.isStaticAccess(typeInfo)
                 || node.expression.kind === ts.SyntaxKind.SuperKeyword
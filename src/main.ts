@@ -22,5 +22,6 @@ function print() {
 
     Options:
      -varAsLet                                          Use all 'var' variables as 'let'.
+     -jobs=N                                            Emit changed files on N worker threads.
      `);
 }